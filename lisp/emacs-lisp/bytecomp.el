@@ -247,6 +247,20 @@ When this option is true, if you load the compiled file and then move it,
 the functions you loaded will not be able to run.")
 ;;;###autoload(put 'byte-compile-dynamic 'safe-local-variable 'booleanp)
 
+(defvar byte-compile-binary nil
+  "If non-nil, write the compiled file in binary form.
+`load' evaluates such a file without parsing it, and reads the bodies
+of the functions it defines only when they are first called.  See
+`write-binary-compiled-file'.
+
+To enable this option, make it a file-local variable
+in the source file you want it to apply to.
+For example, add  -*-byte-compile-binary: t;-*- on the first line.
+
+When this option is true, if you load the compiled file and then move it,
+the functions you loaded will not be able to run.")
+;;;###autoload(put 'byte-compile-binary 'safe-local-variable 'booleanp)
+
 (defvar byte-compile-disable-print-circle nil
   "If non-nil, disable `print-circle' on printing a byte-compiled code.")
 (make-obsolete-variable 'byte-compile-disable-print-circle nil "24.1")
@@ -1843,7 +1857,7 @@ The value is non-nil if there were no errors, nil if errors."
   (let ((byte-compile-current-file filename)
         (byte-compile-current-group nil)
 	(set-auto-coding-for-load t)
-	target-file input-buffer output-buffer
+	target-file input-buffer output-buffer binary
 	byte-compile-dest-file)
     (setq target-file (byte-compile-dest-file filename))
     (setq byte-compile-dest-file target-file)
@@ -1918,6 +1932,7 @@ The value is non-nil if there were no errors, nil if errors."
 	  nil
 	(when byte-compile-verbose
 	  (message "Compiling %s...done" filename))
+	(setq binary (buffer-local-value 'byte-compile-binary input-buffer))
 	(kill-buffer input-buffer)
 	(with-current-buffer output-buffer
 	  (goto-char (point-max))
@@ -1942,6 +1957,8 @@ The value is non-nil if there were no errors, nil if errors."
 		  (unless (= temp-modes desired-modes)
 		    (set-file-modes tempfile desired-modes))
 		  (write-region (point-min) (point-max) tempfile nil 1)
+		  (when binary
+		    (write-binary-compiled-file tempfile))
 		  ;; This has the intentional side effect that any
 		  ;; hard-links to target-file continue to
 		  ;; point to the old file (this makes it possible
@@ -27,6 +27,7 @@
 ;;; Code:
 
 (require 'cl-lib)
+(require 'json)
 
 (defgroup profiler nil
   "Emacs profiler."
@@ -41,6 +42,11 @@
   :type 'integer
   :group 'profiler)
 
+(defcustom profiler-allocation-interval 65536
+  "Default sampling interval of the allocation profiler in bytes."
+  :type 'integer
+  :group 'profiler)
+
 
 ;;; Utilities
 
@@ -161,7 +167,9 @@ function name of a function itself."
                                 (:constructor profiler-make-profile))
   (tag 'profiler-profile)
   (version profiler-version)
-  ;; - `type' has a value indicating the kind of profile (`memory' or `cpu').
+  ;; - `type' has a value indicating the kind of profile (`memory', `cpu',
+  ;;   `allocation', or `live' for the live objects of the allocation
+  ;;   profiler).
   ;; - `log' indicates the profile log.
   ;; - `timestamp' has a value giving the time when the profile was obtained.
   ;; - `diff-p' indicates if this profile represents a diff between two profiles.
@@ -204,14 +212,212 @@ function name of a function itself."
     (goto-char (point-min))
     (read (current-buffer))))
 
+
+;;; Exporting
+
+;; Profiles can be exported for tools that draw flame graphs or
+;; otherwise analyze them: in the "collapsed stack" format of the
+;; FlameGraph scripts, which has one line per backtrace with its
+;; functions from the outermost one on, separated by semicolons,
+;; followed by its count; and in the protocol buffer format of pprof.
+;; Backtraces with a count that is not positive, which only occur in
+;; diffs, are left out of both.
+
+(defun profiler-export-entry-name (entry)
+  "Return the name of ENTRY in an exported profile."
+  (replace-regexp-in-string "[;\n]" "_" (profiler-format-entry entry)))
+
+(defun profiler-log-to-collapsed (log)
+  "Return the backtraces of LOG in the collapsed stack format."
+  (let (lines)
+    (maphash (lambda (backtrace count)
+               (let (names)
+                 (when (> count 0)
+                   ;; Backtraces start with the innermost function.
+                   (mapc (lambda (entry)
+                           (when entry
+                             (push (profiler-export-entry-name entry) names)))
+                         backtrace)
+                   (when names
+                     (push (format "%s %d\n" (mapconcat #'identity names ";")
+                                   count)
+                           lines)))))
+             log)
+    (apply #'concat (sort lines #'string<))))
+
+(defun profiler-pprof-varint (n)
+  "Return the protocol buffer encoding of the natural number N."
+  (let (bytes)
+    (while (>= n 128)
+      (push (logior 128 (logand n 127)) bytes)
+      (setq n (ash n -7)))
+    (apply #'unibyte-string (nreverse (cons n bytes)))))
+
+(defun profiler-pprof-field (field value)
+  "Return the protocol buffer encoding of FIELD with VALUE.
+VALUE is a natural number, or a unibyte string for a length-delimited
+field, which is also how packed repeated fields and nested messages
+are encoded."
+  (if (stringp value)
+      (concat (profiler-pprof-varint (logior (ash field 3) 2))
+              (profiler-pprof-varint (length value))
+              value)
+    (concat (profiler-pprof-varint (ash field 3))
+            (profiler-pprof-varint value))))
+
+(defun profiler-log-to-pprof (log type &optional period)
+  "Return the backtraces of LOG as a profile in the pprof format.
+TYPE is `cpu' or `memory', like the type of a profile.  For a CPU
+profile, PERIOD is the sampling interval in nanoseconds, which
+defaults to `profiler-sampling-interval'.  The value is a unibyte
+string, which pprof reads as it is or compressed with gzip."
+  (let ((strings (make-hash-table :test 'equal))
+        (string-table nil)
+        (functions (make-hash-table :test 'equal))
+        (function-table nil)
+        (samples nil)
+        (period (or period profiler-sampling-interval)))
+    (cl-flet* ((string-index (string)
+                 (or (gethash string strings)
+                     (progn
+                       (push (profiler-pprof-field
+                              6 (encode-coding-string string 'utf-8))
+                             string-table)
+                       (puthash string (hash-table-count strings) strings))))
+               (value-type (type unit)
+                 (concat (profiler-pprof-field 1 (string-index type))
+                         (profiler-pprof-field 2 (string-index unit))))
+               ;; Each function has one location, with the same id.
+               (function-id (entry)
+                 (let ((name (profiler-export-entry-name entry)))
+                   (or (gethash name functions)
+                       (let ((id (1+ (hash-table-count functions)))
+                             (index (string-index name)))
+                         (push (concat
+                                (profiler-pprof-field
+                                 4 (concat (profiler-pprof-field 1 id)
+                                           (profiler-pprof-field
+                                            4 (profiler-pprof-field 1 id))))
+                                (profiler-pprof-field
+                                 5 (concat (profiler-pprof-field 1 id)
+                                           (profiler-pprof-field 2 index)
+                                           (profiler-pprof-field 3 index))))
+                               function-table)
+                         (puthash name id functions))))))
+      ;; The first string must be the empty one.
+      (string-index "")
+      (let ((header
+             (if (eq type 'cpu)
+                 (concat (profiler-pprof-field 1 (value-type "samples" "count"))
+                         (profiler-pprof-field
+                          1 (value-type "cpu" "nanoseconds"))
+                         (profiler-pprof-field
+                          11 (value-type "cpu" "nanoseconds"))
+                         (profiler-pprof-field 12 period))
+               (profiler-pprof-field 1 (value-type "space" "bytes")))))
+        (maphash
+         (lambda (backtrace count)
+           (let ((ids (delq nil (mapcar (lambda (entry)
+                                          (and entry (function-id entry)))
+                                        backtrace))))
+             (when (and ids (> count 0))
+               ;; Locations also start with the innermost function.
+               (push (profiler-pprof-field
+                      2 (concat
+                         (profiler-pprof-field
+                          1 (mapconcat #'profiler-pprof-varint ids ""))
+                         (profiler-pprof-field
+                          2 (mapconcat #'profiler-pprof-varint
+                                       (if (eq type 'cpu)
+                                           (list count (* count period))
+                                         (list count))
+                                       ""))))
+                     samples))))
+         log)
+        (apply #'concat header
+               (nconc samples (nreverse function-table)
+                      (nreverse string-table)))))))
+
+(defun profiler-export-profile (profile filename format)
+  "Write PROFILE into file FILENAME in FORMAT for other tools.
+FORMAT is `pprof' or `collapsed'; see `profiler-log-to-pprof' and
+`profiler-log-to-collapsed'."
+  (let ((log (profiler-profile-log profile)))
+    (with-temp-buffer
+      (cl-ecase format
+        (pprof
+         (set-buffer-multibyte nil)
+         (insert (profiler-log-to-pprof log (profiler-profile-type profile)))
+         (let ((coding-system-for-write 'binary))
+           (write-region nil nil filename)))
+        (collapsed
+         (insert (profiler-log-to-collapsed log))
+         (let ((coding-system-for-write 'utf-8-unix))
+           (write-region nil nil filename)))))))
+
+;;; Timing spans
+
+;; The spans of `profiler-spans-log', which time the calls of hook
+;; functions, timers and process filters and sentinels, are exported
+;; in the trace event format of Chrome, which chrome://tracing and
+;; Perfetto read.  They draw each span under those that contain it.
+
+(defun profiler-span-name (object)
+  "Return the name of OBJECT, a function, hook, timer or process."
+  (cond ((processp object) (process-name object))
+        ((timerp object) (profiler-span-name (timer--function object)))
+        (t (profiler-format-entry object))))
+
+(defun profiler-spans-to-trace-events (spans)
+  "Return SPANS as a JSON string in the Chrome trace event format.
+SPANS is a list like the value of `profiler-spans-log'.  Each span is a
+complete event named after its function, in the category of its kind,
+with the hook, timer or process it ran for in its arguments."
+  (let ((pid (emacs-pid)))
+    (json-encode
+     `((traceEvents
+        . ,(vconcat
+            (mapcar
+             (pcase-lambda (`(,kind ,context ,function ,start ,duration
+                                    ,depth))
+               `((name . ,(profiler-span-name function))
+                 (cat . ,(symbol-name kind))
+                 (ph . "X")
+                 ;; Times are in microseconds.
+                 (ts . ,(/ start 1000.0))
+                 (dur . ,(/ duration 1000.0))
+                 (pid . ,pid)
+                 (tid . 1)
+                 (args (,kind . ,(profiler-span-name context))
+                       (depth . ,depth))))
+             spans)))
+       (displayTimeUnit . "ms")))))
+
+(defun profiler-spans-export (filename)
+  "Write the spans recorded since the last call into file FILENAME.
+The file is in the Chrome trace event format; see
+`profiler-spans-to-trace-events'."
+  (interactive
+   (list (read-file-name "Export spans: " default-directory)))
+  (with-temp-buffer
+    (insert (profiler-spans-to-trace-events (profiler-spans-log)))
+    (let ((coding-system-for-write 'utf-8-unix))
+      (write-region nil nil filename))))
+
+
 (defun profiler-running-p (&optional mode)
   "Return non-nil if the profiler is running.
-Optional argument MODE means only check for the specified mode (cpu or mem)."
+Optional argument MODE means only check for the specified mode (cpu,
+mem, alloc or spans)."
   (cond ((eq mode 'cpu) (and (fboundp 'profiler-cpu-running-p)
                              (profiler-cpu-running-p)))
         ((eq mode 'mem) (profiler-memory-running-p))
+        ((eq mode 'alloc) (profiler-allocation-running-p))
+        ((eq mode 'spans) (profiler-spans-running-p))
         (t (or (profiler-running-p 'cpu)
-               (profiler-running-p 'mem)))))
+               (profiler-running-p 'mem)
+               (profiler-running-p 'alloc)
+               (profiler-running-p 'spans)))))
 
 (defun profiler-cpu-profile ()
   "Return CPU profile."
@@ -229,6 +435,21 @@ Optional argument MODE means only check for the specified mode (cpu or mem)."
      :timestamp (current-time)
      :log (profiler-memory-log))))
 
+(defun profiler-allocation-profile ()
+  "Return allocation profile."
+  (when (profiler-allocation-running-p)
+    (profiler-make-profile
+     :type 'allocation
+     :timestamp (current-time)
+     :log (profiler-allocation-log))))
+
+(defun profiler-allocation-live-profile ()
+  "Return a profile of the live objects sampled by the allocation profiler."
+  (profiler-make-profile
+   :type 'live
+   :timestamp (current-time)
+   :log (profiler-allocation-live-log)))
+
 
 ;;; Calltrees
 
@@ -502,7 +723,8 @@ RET: expand or collapse"))
 	(count-percent (profiler-calltree-count-percent tree)))
     (profiler-format (cl-ecase (profiler-profile-type profiler-report-profile)
 		       (cpu profiler-report-cpu-line-format)
-		       (memory profiler-report-memory-line-format))
+		       ((memory allocation live)
+			profiler-report-memory-line-format))
 		     name-part
 		     (if diff-p
 			 (list (if (> count 0)
@@ -579,6 +801,8 @@ RET: expand or collapse"))
          :help "Compare current profile with another"]
         ["Write Profile..." profiler-report-write-profile :active t
          :help "Write current profile to a file"]
+        ["Export Profile..." profiler-report-export-profile :active t
+         :help "Write current profile to a file for other tools"]
         "--"
         ["Start Profiler" profiler-start :active (not (profiler-running-p))
          :help "Start profiling"]
@@ -591,7 +815,9 @@ RET: expand or collapse"))
 
 (defun profiler-report-make-buffer-name (profile)
   (format "*%s-Profiler-Report %s*"
-          (cl-ecase (profiler-profile-type profile) (cpu 'CPU) (memory 'Memory))
+          (cl-ecase (profiler-profile-type profile)
+            (cpu 'CPU) (memory 'Memory) (allocation 'Allocation)
+            (live 'Live-Allocation))
           (format-time-string "%Y-%m-%d %T" (profiler-profile-timestamp profile))))
 
 (defun profiler-report-setup-buffer-1 (profile)
@@ -731,7 +957,7 @@ below entry at point."
 	     (profiler-report-header-line-format
 	      profiler-report-cpu-line-format
 	      "Function" (list "CPU samples" "%")))
-	    (memory
+	    ((memory allocation live)
 	     (profiler-report-header-line-format
 	      profiler-report-memory-line-format
 	      "Function" (list "Bytes" "%")))))
@@ -800,20 +1026,39 @@ below entry at point."
                           filename
                           confirm))
 
+(defun profiler-report-export-profile (filename format)
+  "Write the current profile into file FILENAME in FORMAT.
+See `profiler-export-profile'."
+  (interactive
+   (list (read-file-name "Export profile: " default-directory)
+         (intern (completing-read "Format (default pprof): "
+                                  '("pprof" "collapsed")
+                                  nil t nil nil "pprof"))))
+  (profiler-export-profile profiler-report-profile filename format))
+
 
 ;;; Profiler commands
 
 ;;;###autoload
 (defun profiler-start (mode)
   "Start/restart profilers.
-MODE can be one of `cpu', `mem', or `cpu+mem'.
+MODE can be one of `cpu', `mem', `cpu+mem', `alloc' or `spans'.
 If MODE is `cpu' or `cpu+mem', time-based profiler will be started.
-Also, if MODE is `mem' or `cpu+mem', then memory profiler will be started."
+Also, if MODE is `mem' or `cpu+mem', then memory profiler will be started.
+If MODE is `alloc', the allocation profiler will be started, which
+samples the Lisp objects allocated; see `profiler-allocation-start'.
+If MODE is `spans', the calls of hook functions, timers and process
+filters and sentinels are timed; see `profiler-spans-export'."
   (interactive
-   (list (if (not (fboundp 'profiler-cpu-start)) 'mem
-           (intern (completing-read "Mode (default cpu): "
-                                    '("cpu" "mem" "cpu+mem")
-                                    nil t nil nil "cpu")))))
+   (list (intern (completing-read (if (fboundp 'profiler-cpu-start)
+                                      "Mode (default cpu): "
+                                    "Mode (default mem): ")
+                                  (if (fboundp 'profiler-cpu-start)
+                                      '("cpu" "mem" "cpu+mem" "alloc" "spans")
+                                    '("mem" "alloc" "spans"))
+                                  nil t nil nil
+                                  (if (fboundp 'profiler-cpu-start)
+                                      "cpu" "mem")))))
   (cl-ecase mode
     (cpu
      (profiler-cpu-start profiler-sampling-interval)
@@ -824,17 +1069,27 @@ Also, if MODE is `mem' or `cpu+mem', then memory profiler will be started."
     (cpu+mem
      (profiler-cpu-start profiler-sampling-interval)
      (profiler-memory-start)
-     (message "CPU and memory profiler started"))))
+     (message "CPU and memory profiler started"))
+    (alloc
+     (profiler-allocation-start profiler-allocation-interval)
+     (message "Allocation profiler started"))
+    (spans
+     (profiler-spans-start)
+     (message "Span recording started"))))
 
 (defun profiler-stop ()
   "Stop started profilers.  Profiler logs will be kept."
   (interactive)
   (let ((cpu (if (fboundp 'profiler-cpu-stop) (profiler-cpu-stop)))
-        (mem (profiler-memory-stop)))
+        (mem (profiler-memory-stop))
+        (alloc (profiler-allocation-stop))
+        (spans (profiler-spans-stop)))
     (message "%s profiler stopped"
              (cond ((and mem cpu) "CPU and memory")
                    (mem "Memory")
                    (cpu "CPU")
+                   (alloc "Allocation")
+                   (spans "Span")
                    (t "No")))))
 
 (defun profiler-reset ()
@@ -843,6 +1098,8 @@ Also, if MODE is `mem' or `cpu+mem', then memory profiler will be started."
   (when (fboundp 'profiler-cpu-log)
     (ignore (profiler-cpu-log)))
   (ignore (profiler-memory-log))
+  (ignore (profiler-allocation-log))
+  (ignore (profiler-spans-log))
   t)
 
 (defun profiler-report-cpu ()
@@ -855,11 +1112,23 @@ Also, if MODE is `mem' or `cpu+mem', then memory profiler will be started."
     (when profile
       (profiler-report-profile-other-window profile))))
 
+(defun profiler-report-allocation ()
+  (let ((profile (profiler-allocation-profile)))
+    (when profile
+      (profiler-report-profile-other-window profile))))
+
 (defun profiler-report ()
   "Report profiling results."
   (interactive)
   (profiler-report-cpu)
-  (profiler-report-memory))
+  (profiler-report-memory)
+  (profiler-report-allocation))
+
+(defun profiler-report-live ()
+  "Report the objects sampled by the allocation profiler that are live.
+These are the objects that survived the last garbage collection."
+  (interactive)
+  (profiler-report-profile-other-window (profiler-allocation-live-profile)))
 
 ;;;###autoload
 (defun profiler-find-profile (filename)
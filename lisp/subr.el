@@ -2616,7 +2616,13 @@ to `accept-change-group' or `cancel-change-group'."
   (dolist (elt handle)
     (with-current-buffer (car elt)
       (if (eq buffer-undo-list t)
-	  (setq buffer-undo-list nil)))))
+	  (setq buffer-undo-list nil))
+      ;; Keep the changes of the group from being combined with the
+      ;; record that the handle saved, which `cancel-change-group'
+      ;; would then not revert (bug#33341).  This must not be an
+      ;; `undo-boundary', so push an element that undoes nothing.
+      (when (consp buffer-undo-list)
+        (push (list 'apply 'ignore nil) buffer-undo-list)))))
 
 (defun accept-change-group (handle)
   "Finish a change group made with `prepare-change-group' (which see).
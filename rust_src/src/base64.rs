@@ -19,7 +19,7 @@ use crate::{
     threads::ThreadState,
 };
 
-fn base64_encode_1(bytes: &[u8], line_break: bool, multibyte: bool) -> Result<String, ()> {
+pub fn base64_encode_1(bytes: &[u8], line_break: bool, multibyte: bool) -> Result<String, ()> {
     let config = base64_crate::STANDARD;
 
     let mut encoded_string = if multibyte {
@@ -71,7 +71,7 @@ fn line_wrap<L: LineEnding>(string: &mut String, line_len: usize, line_ending: &
 
 /// Base64-decode the data in ENCODED. If MULTIBYTE, the decoded result should be in multibyte
 /// form. It returns the decoded data and the number of bytes in the original decoded string.
-fn base64_decode_1(encoded: &[u8], multibyte: bool) -> Result<(Vec<u8>, usize), ()> {
+pub fn base64_decode_1(encoded: &[u8], multibyte: bool) -> Result<(Vec<u8>, usize), ()> {
     // Input string is allowed to have emmbed newlines, delete before decoding.
     let mut buf: Vec<u8> = Vec::with_capacity(encoded.len());
     buf.extend(encoded.iter().filter(|b| !b"\n\t\r\x0b\x0c".contains(b)));
@@ -12,10 +12,12 @@ use crate::{
     lisp::LispObject,
     multibyte::LispStringRef,
     remacs_sys::EmacsInt,
-    remacs_sys::{extract_data_from_object, make_uninit_string},
+    remacs_sys::{
+        extract_data_from_object, make_uninit_string, other_threads_p, THREAD_UNLOCKED_MIN_BYTES,
+    },
     remacs_sys::{Qmd5, Qnil, Qsha1, Qsha224, Qsha256, Qsha384, Qsha512},
     symbols::{symbol_name, LispSymbolRef},
-    threads::ThreadState,
+    threads::{without_global_lock, ThreadState},
 };
 
 #[derive(Clone, Copy)]
@@ -117,17 +119,29 @@ pub fn secure_hash(
     _secure_hash(hash_alg(algorithm), object, start, end, Qnil, Qnil, binary)
 }
 
-fn _secure_hash(
-    algorithm: HashAlg,
+type HashFn = fn(&[u8], &mut [u8]);
+
+fn hash_function(algorithm: HashAlg) -> (usize, HashFn) {
+    match algorithm {
+        HashAlg::MD5 => (MD5_DIGEST_LEN, md5_buffer as HashFn),
+        HashAlg::SHA1 => (SHA1_DIGEST_LEN, sha1_buffer as HashFn),
+        HashAlg::SHA224 => (SHA224_DIGEST_LEN, sha224_buffer as HashFn),
+        HashAlg::SHA256 => (SHA256_DIGEST_LEN, sha256_buffer as HashFn),
+        HashAlg::SHA384 => (SHA384_DIGEST_LEN, sha384_buffer as HashFn),
+        HashAlg::SHA512 => (SHA512_DIGEST_LEN, sha512_buffer as HashFn),
+    }
+}
+
+/// Return the bytes of OBJECT that are hashed, as for `secure-hash'.
+/// The slice points into OBJECT's data, so it is only valid until the
+/// next garbage collection or buffer change.
+fn hash_input<'a>(
     object: LispObject,
     start: LispObject,
     end: LispObject,
     coding_system: LispObject,
     noerror: LispObject,
-    binary: LispObject,
-) -> LispObject {
-    type HashFn = fn(&[u8], &mut [u8]);
-
+) -> &'a [u8] {
     let spec = list!(object, start, end, coding_system, noerror);
     let mut start_byte: ptrdiff_t = 0;
     let mut end_byte: ptrdiff_t = 0;
@@ -137,21 +151,42 @@ fn _secure_hash(
         error!("secure_hash: failed to extract data from object, aborting!");
     }
 
-    let input_slice = unsafe {
+    unsafe {
         slice::from_raw_parts(
             input.offset(start_byte) as *mut u8,
             (end_byte - start_byte) as usize,
         )
-    };
+    }
+}
 
-    let (digest_size, hash_func) = match algorithm {
-        HashAlg::MD5 => (MD5_DIGEST_LEN, md5_buffer as HashFn),
-        HashAlg::SHA1 => (SHA1_DIGEST_LEN, sha1_buffer as HashFn),
-        HashAlg::SHA224 => (SHA224_DIGEST_LEN, sha224_buffer as HashFn),
-        HashAlg::SHA256 => (SHA256_DIGEST_LEN, sha256_buffer as HashFn),
-        HashAlg::SHA384 => (SHA384_DIGEST_LEN, sha384_buffer as HashFn),
-        HashAlg::SHA512 => (SHA512_DIGEST_LEN, sha512_buffer as HashFn),
-    };
+/// Return a function that computes the hex digest of OBJECT with
+/// ALGORITHM, as `secure-hash' does.  It hashes a copy of OBJECT's
+/// bytes and touches no Lisp data, so it can be called in any thread.
+pub fn hex_digest_task(
+    algorithm: LispSymbolRef,
+    object: LispObject,
+) -> impl FnOnce() -> Vec<u8> + Send {
+    let (digest_size, hash_func) = hash_function(hash_alg(algorithm));
+    let input = hash_input(object, Qnil, Qnil, Qnil, Qnil).to_vec();
+    move || {
+        let mut output = vec![0; digest_size * 2];
+        hash_func(&input, &mut output);
+        hexify_digest_string(&mut output, digest_size);
+        output
+    }
+}
+
+fn _secure_hash(
+    algorithm: HashAlg,
+    object: LispObject,
+    start: LispObject,
+    end: LispObject,
+    coding_system: LispObject,
+    noerror: LispObject,
+    binary: LispObject,
+) -> LispObject {
+    let input_slice = hash_input(object, start, end, coding_system, noerror);
+    let (digest_size, hash_func) = hash_function(algorithm);
 
     let buffer_size = if binary.is_nil() {
         (digest_size * 2) as EmacsInt
@@ -160,7 +195,19 @@ fn _secure_hash(
     };
     let digest = unsafe { make_uninit_string(buffer_size as EmacsInt) };
     let mut digest_str: LispStringRef = digest.into();
-    hash_func(input_slice, digest_str.as_mut_slice());
+    if input_slice.len() >= THREAD_UNLOCKED_MIN_BYTES as usize && unsafe { other_threads_p() } {
+        // The input and the digest may move while other threads run,
+        // so hash a copy into a private buffer.
+        let input = input_slice.to_vec();
+        let output = without_global_lock(move || {
+            let mut output = vec![0; digest_size];
+            hash_func(&input, &mut output);
+            output
+        });
+        digest_str.as_mut_slice()[..digest_size].copy_from_slice(&output);
+    } else {
+        hash_func(input_slice, digest_str.as_mut_slice());
+    }
     if binary.is_nil() {
         hexify_digest_string(digest_str.as_mut_slice(), digest_size);
     }
@@ -25,6 +25,7 @@ use crate::{
         Qdirectory_files, Qdirectory_files_and_attributes, Qfile_attributes, Qfile_missing, Qnil,
         Qt,
     },
+    threads::without_global_lock,
     time::make_lisp_time,
 };
 
@@ -245,9 +246,17 @@ fn read_dir(dname: &str, fnames: &mut Vec<String>, match_re: Option<LispObject>)
         fnames.push(dotdot);
     }
 
-    for fname in fs::read_dir(dir_p)? {
-        let fname = fname?;
-        let f_enc = match fname.file_name().into_string() {
+    // Reading a large or remote directory can block for a while, so
+    // let other threads run meanwhile, and decode and match the names
+    // afterwards.
+    let names = without_global_lock(|| {
+        fs::read_dir(dir_p)?
+            .map(|entry| entry.map(|entry| entry.file_name()))
+            .collect::<io::Result<Vec<_>>>()
+    })?;
+
+    for name in names {
+        let f_enc = match name.into_string() {
             Ok(file_name) => file_name,
             Err(err) => {
                 return Err(io::Error::new(
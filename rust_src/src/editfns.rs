@@ -16,7 +16,7 @@ use crate::{
     fns::copy_sequence,
     indent::invalidate_current_column,
     lisp::LispObject,
-    marker::{marker_position_lisp, point_marker, set_point_from_marker},
+    marker::{marker_position_lisp, set_point_from_marker},
     multibyte::MAX_MULTIBYTE_LENGTH,
     multibyte::{multibyte_char_at, Codepoint, LispStringRef},
     numbers::{check_range, LispNumber},
@@ -25,11 +25,11 @@ use crate::{
         buffer_overflow, build_string, chars_in_text, current_message, del_range, del_range_1,
         downcase, find_before_next_newline, find_newline, get_char_property_and_overlay, globals,
         insert_1_both, insert_from_buffer, insert_from_string_1, make_buffer_string,
-        make_buffer_string_both, make_save_obj_obj_obj_obj, make_string_from_bytes, maybe_quit,
-        message1, message3, record_unwind_current_buffer, save_excursion_restore,
-        save_restriction_restore, save_restriction_save, scan_newline_from_point,
-        set_buffer_internal_1, set_point, set_point_both, signal_after_change, styled_format,
-        update_buffer_properties, update_compositions, CHECK_BORDER, STRING_BYTES,
+        make_buffer_string_both, make_string_from_bytes, maybe_quit, message1, message3,
+        record_unwind_current_buffer, record_unwind_protect_excursion, save_restriction_restore,
+        save_restriction_save, scan_newline_from_point, set_buffer_internal_1, set_point,
+        set_point_both, signal_after_change, styled_format, update_buffer_properties,
+        update_compositions, CHECK_BORDER, STRING_BYTES,
     },
     remacs_sys::{
         Fadd_text_properties, Fget_pos_property, Fnext_single_char_property_change,
@@ -42,7 +42,6 @@ use crate::{
     threads::{c_specpdl_index, ThreadState},
     time::{lisp_time_struct, time_overflow, LispTime},
     util::clip_to_bounds,
-    windows::{selected_window, LispWindowRef},
 };
 
 /// Return value of point, as an integer.
@@ -1088,28 +1087,6 @@ pub fn buffer_substring_no_properties(beg: LispObject, end: LispObject) -> LispO
     unsafe { make_buffer_string(beg, end, false) }
 }
 
-// Save current buffer state for `save-excursion' special form.
-// We (ab)use Lisp_Misc_Save_Value to allow explicit free and so
-// offload some work from GC.
-#[no_mangle]
-pub extern "C" fn save_excursion_save() -> LispObject {
-    let window: LispWindowRef = selected_window().into();
-
-    unsafe {
-        make_save_obj_obj_obj_obj(
-            point_marker().into(),
-            Qnil,
-            // Selected window if current buffer is shown in it, nil otherwise.
-            if window.contents.eq(current_buffer()) {
-                window.into()
-            } else {
-                Qnil
-            },
-            Qnil,
-        )
-    }
-}
-
 /// Save point, and current buffer; execute BODY; restore those things.
 /// Executes BODY just like `progn'.
 /// The values of point and the current buffer are restored
@@ -1127,7 +1104,7 @@ pub extern "C" fn save_excursion_save() -> LispObject {
 pub fn save_excursion(args: LispObject) -> LispObject {
     let count = c_specpdl_index();
 
-    unsafe { record_unwind_protect(Some(save_excursion_restore), save_excursion_save()) };
+    unsafe { record_unwind_protect_excursion() };
 
     unbind_to(count, progn(args))
 }
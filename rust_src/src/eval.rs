@@ -1,6 +1,6 @@
 //! Generic Lisp eval functions
 
-use std::{ptr, unreachable};
+use std::{ptr, slice, unreachable};
 
 use libc::c_void;
 
@@ -23,6 +23,7 @@ use crate::{
         backtrace_debug_on_exit, build_string, call_debugger, check_cons_list, do_debug_on_call,
         do_one_unbind, eval_sub, funcall_lambda, funcall_subr, globals, grow_specpdl,
         internal_catch, internal_lisp_condition_case, list2, maybe_gc, maybe_quit,
+        profiler_span_begin, profiler_span_end, profiler_span_kind, profiler_spans_running,
         record_in_backtrace, record_unwind_save_match_data, signal_or_quit, specbind, COMPILEDP,
         MODULE_FUNCTIONP,
     },
@@ -1013,6 +1014,28 @@ pub extern "C" fn run_hook(hook: LispObject) {
     run_hook_with_args(&mut [hook]);
 }
 
+/// Call FUNC on ARGS, where ARGS[0] is a function on the hook HOOK,
+/// in a timing span if spans are being recorded.
+fn run_hook_function(
+    hook: LispObject,
+    args: &mut [LispObject],
+    func: fn(&mut [LispObject]) -> LispObject,
+) -> LispObject {
+    if unsafe { !profiler_spans_running } {
+        return func(args);
+    }
+
+    let count = c_specpdl_index();
+    unsafe {
+        record_unwind_protect_int(
+            Some(profiler_span_end),
+            profiler_span_begin(profiler_span_kind::SPAN_HOOK, hook, args[0]),
+        );
+    }
+    let ret = func(args);
+    unbind_to(count, ret)
+}
+
 /// ARGS[0] should be a hook symbol.
 /// Call each of the functions in the hook value, passing each of them
 /// as arguments all the rest of ARGS (all NARGS - 1 elements).
@@ -1035,7 +1058,7 @@ fn run_hook_with_args_internal(
         Qnil
     } else if !val.is_cons() || FUNCTIONP(val) {
         args[0] = val;
-        func(args)
+        run_hook_function(sym, args, func)
     } else {
         for item in val.iter_cars(LispConsEndChecks::off, LispConsCircularChecks::off) {
             if ret.is_not_nil() {
@@ -1052,7 +1075,7 @@ fn run_hook_with_args_internal(
 
                 if !global_vals.is_cons() || car(global_vals).eq(Qlambda) {
                     args[0] = global_vals;
-                    ret = func(args);
+                    ret = run_hook_function(sym, args, func);
                 } else {
                     for gval in
                         global_vals.iter_cars(LispConsEndChecks::off, LispConsCircularChecks::off)
@@ -1065,13 +1088,13 @@ fn run_hook_with_args_internal(
                         // In a global value, t should not occur. If it does, we
                         // must ignore it to avoid an endless loop.
                         if !args[0].eq(Qt) {
-                            ret = func(args);
+                            ret = run_hook_function(sym, args, func);
                         }
                     }
                 }
             } else {
                 args[0] = item;
-                ret = func(args);
+                ret = run_hook_function(sym, args, func);
             }
         }
 
@@ -1140,9 +1163,32 @@ fn resolve_fun(fun: LispObject) -> Result<LispFun, LispFunError> {
 /// Return the value that function returns.
 /// Thus, (funcall \\='cons \\='x \\='y) returns (x . y).
 /// usage: (funcall FUNCTION &rest ARGUMENTS)
-#[allow(unused_assignments)]
 #[lisp_fn(min = "1")]
 pub fn funcall(args: &mut [LispObject]) -> LispObject {
+    funcall_internal(args, None)
+}
+
+/// Call ARGS[0] like `funcall', but call DEFINITION instead of
+/// looking up the definition of ARGS[0].  DEFINITION must be what
+/// `indirect-function' returns for ARGS[0], and must be a subr, a
+/// byte-code object or a lambda expression.  Bcall uses this for the
+/// definitions it caches.
+#[no_mangle]
+pub unsafe extern "C" fn funcall_with_definition(
+    nargs: libc::ptrdiff_t,
+    args: *mut LispObject,
+    definition: LispObject,
+) -> LispObject {
+    let args = slice::from_raw_parts_mut(args, nargs as usize);
+    let definition = match definition.as_subr() {
+        Some(f) => LispFun::SubrFun(f),
+        None => LispFun::LambdaFun(definition),
+    };
+    funcall_internal(args, Some(definition))
+}
+
+#[allow(unused_assignments)]
+fn funcall_internal(args: &mut [LispObject], definition: Option<LispFun>) -> LispObject {
     unsafe { maybe_quit() };
 
     // Increment the lisp eval depth
@@ -1186,7 +1232,12 @@ pub fn funcall(args: &mut [LispObject]) -> LispObject {
 
     let mut val = Qnil;
 
-    match resolve_fun(fun) {
+    let definition = match definition {
+        Some(f) => Ok(f),
+        None => resolve_fun(fun),
+    };
+
+    match definition {
         Ok(LispFun::SubrFun(mut f)) => {
             val = unsafe { funcall_subr(f.as_mut(), numargs, fun_args) };
         }
@@ -73,6 +73,14 @@ impl LispHashTableRef {
         self.index
     }
 
+    pub fn set_old_index(&mut self, old_index: LispObject) {
+        self.old_index = old_index;
+    }
+
+    pub fn get_old_index(self) -> LispObject {
+        self.old_index
+    }
+
     pub fn get_key_and_value(self) -> LispObject {
         self.key_and_value
     }
@@ -243,6 +251,10 @@ pub fn copy_hash_table(mut table: LispHashTableRef) -> LispHashTableRef {
     new_table.set_hash(hash);
     new_table.set_next(next);
     new_table.set_index(index);
+    if new_table.get_old_index().is_not_nil() {
+        let old_index = copy_sequence(new_table.get_old_index());
+        new_table.set_old_index(old_index);
+    }
 
     if new_table.get_weak().is_not_nil() {
         new_table.set_next_weak(table.get_next_weak());
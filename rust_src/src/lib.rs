@@ -124,10 +124,12 @@ mod terminal;
 mod textprop;
 mod threads;
 mod time;
+mod timsort;
 mod util;
 mod vectors;
 mod window_configuration;
 mod windows;
+mod workers;
 mod xdisp;
 mod xfaces;
 mod xml;
@@ -8,6 +8,7 @@ use libc::c_void;
 use remacs_macros::lisp_fn;
 
 use crate::{
+    fns::vconcat,
     hashtable::LispHashTableRef,
     lisp::{LispObject, LispStructuralEqual},
     numbers::MOST_POSITIVE_FIXNUM,
@@ -15,6 +16,7 @@ use crate::{
     remacs_sys::{Fcons, CHECK_IMPURE},
     remacs_sys::{Qcircular_list, Qconsp, Qlistp, Qnil, Qplistp},
     symbols::LispSymbolRef,
+    timsort::sort_slice,
 };
 
 // Cons support (LispType == 6 | 3)
@@ -845,24 +847,25 @@ pub fn safe_length(list: LispObject) -> usize {
         .count()
 }
 
-// Used by sort() in vectors.rs.
-
+// Used by sort() in vectors.rs.  The elements are sorted in a vector,
+// and put back into the conses of LIST in their new order.
 pub fn sort_list(list: LispObject, pred: LispObject) -> LispObject {
-    let length = safe_length(list) as EmacsInt;
-    if length < 2 {
+    if safe_length(list) < 2 {
         return list;
     }
 
-    let item = nthcdr(length / 2 - 1, list);
-    let back = cdr(item);
-    setcdr(item.into(), Qnil);
-
-    let front = sort_list(list, pred);
-    let back = sort_list(back, pred);
-    merge(front, back, pred)
+    let vector = vconcat(&mut [list]);
+    let mut elements = vector.force_vector();
+    sort_slice(elements.as_mut_slice(), pred);
+    for (tail, &elt) in list
+        .iter_tails(LispConsEndChecks::off, LispConsCircularChecks::off)
+        .zip(elements.as_slice())
+    {
+        setcar(tail, elt);
+    }
+    list
 }
 
-// also needed by vectors.rs
 pub fn inorder(pred: LispObject, a: LispObject, b: LispObject) -> bool {
     call!(pred, b, a).is_nil()
 }
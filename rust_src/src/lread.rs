@@ -21,9 +21,9 @@ use crate::{
     remacs_sys,
     remacs_sys::infile,
     remacs_sys::{
-        block_input, build_string, getc_unlocked, maybe_quit, oblookup_last_bucket_number,
-        read_filtered_event, read_internal_start, readevalloop, specbind, staticpro,
-        symbol_redirect, unblock_input,
+        block_input, build_string, getc_unlocked, maybe_quit, obarray_unintern,
+        oblookup_last_bucket_number, read_filtered_event, read_internal_start, readevalloop,
+        specbind, staticpro, symbol_redirect, unblock_input,
     },
     remacs_sys::{globals, EmacsInt},
     remacs_sys::{Qeval_buffer_list, Qnil, Qread_char, Qstandard_output, Qsymbolp},
@@ -187,6 +187,13 @@ pub unsafe extern "C" fn readbyte_from_stdio() -> i32 {
         return file.buf[file.lookahead as usize].into();
     }
 
+    // Then the contents that `load' read into memory, if any are left.
+    if file.pos < file.size {
+        let c = *file.contents.offset(file.pos);
+        file.pos += 1;
+        return c.into();
+    }
+
     let instream = file.stream;
 
     block_input();
@@ -423,6 +430,8 @@ pub fn unintern(name: LispSymbolOrString, obarray: Option<LispObarrayRef>) -> bo
         return false;
     }
 
+    unsafe { obarray_unintern(LispObject::from(&obarray), tem) };
+
     let mut temp: LispSymbolRef = tem.into();
     temp.set_uninterned();
 
@@ -25,7 +25,7 @@ use crate::{
     remacs_sys::{
         get_symbol_declared_special, get_symbol_redirect, make_lisp_symbol,
         set_symbol_declared_special, set_symbol_redirect, swap_in_symval_forwarding,
-        symbol_interned, symbol_redirect, symbol_trapped_write,
+        symbol_function_epoch, symbol_interned, symbol_redirect, symbol_trapped_write,
     },
     remacs_sys::{Qcyclic_variable_indirection, Qnil, Qsymbolp, Qunbound},
     threads::ThreadState,
@@ -56,6 +56,8 @@ impl LispSymbolRef {
 
     pub fn set_function(&mut self, function: LispObject) {
         let s = unsafe { self.u.s.as_mut() };
+        // Invalidate the definitions cached by Bcall.
+        unsafe { symbol_function_epoch = symbol_function_epoch.wrapping_add(1) };
         s.function = function;
     }
 
@@ -256,6 +258,8 @@ impl LispSymbolRef {
                 | specbind_tag::SPECPDL_UNWIND_PTR
                 | specbind_tag::SPECPDL_UNWIND_INT
                 | specbind_tag::SPECPDL_UNWIND_VOID
+                | specbind_tag::SPECPDL_UNWIND_EXCURSION
+                | specbind_tag::SPECPDL_UNWIND_BUFFER
                 | specbind_tag::SPECPDL_BACKTRACE
                 | specbind_tag::SPECPDL_LET_LOCAL => {}
                 _ => panic!("Incorrect specpdl kind"),
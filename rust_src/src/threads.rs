@@ -7,7 +7,8 @@ use crate::{
     lisp::{ExternalPtr, LispObject},
     remacs_sys::Qthreadp,
     remacs_sys::{
-        current_thread as current_thread_pointer, pvec_type, thread_state, Lisp_Type, SPECPDL_INDEX,
+        current_thread as current_thread_pointer, pvec_type, thread_call_unlocked, thread_state,
+        Lisp_Type, SPECPDL_INDEX,
     },
     vectors::LispVectorlikeRef,
 };
@@ -65,6 +66,34 @@ impl LispObject {
     }
 }
 
+/// Return the value of F, called without holding the global lock so
+/// that other threads can run Lisp meanwhile.  F must not touch Lisp
+/// objects, buffers, or anything else those threads may use; see
+/// `thread_call_unlocked'.
+pub fn without_global_lock<T, F: FnOnce() -> T>(f: F) -> T {
+    struct Call<F, T> {
+        f: Option<F>,
+        result: Option<T>,
+    }
+
+    unsafe extern "C" fn call<F: FnOnce() -> T, T>(arg: *mut libc::c_void) {
+        let call = &mut *(arg as *mut Call<F, T>);
+        call.result = call.f.take().map(|f| f());
+    }
+
+    let mut state = Call {
+        f: Some(f),
+        result: None,
+    };
+    unsafe {
+        thread_call_unlocked(
+            Some(call::<F, T>),
+            &mut state as *mut Call<F, T> as *mut libc::c_void,
+        )
+    };
+    state.result.unwrap()
+}
+
 // FIXME: The right thing to do is start indexing thread.m_specpdl as
 // an array instead of depending on C style pointer math.
 pub fn c_specpdl_index() -> libc::ptrdiff_t {
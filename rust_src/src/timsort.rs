@@ -0,0 +1,300 @@
+//! A stable merge sort for `sort', after Tim Peters' timsort.
+//!
+//! The slice is split into runs that are already in order, short runs
+//! are extended with a binary insertion sort, and the runs are merged
+//! pairwise while their lengths keep the pending merges balanced.  The
+//! predicate is called once per comparison, and not at all when it is
+//! one of the builtin orderings we can compare directly.
+
+use std::ffi::CStr;
+
+use crate::{
+    data::indirect_function,
+    lisp::LispObject,
+    math::{arithcompare, ArithComparison},
+    remacs_sys::{Fmake_vector, Qnil},
+    strings::string_lessp,
+    vectors::LispVectorRef,
+};
+
+/// Runs shorter than this are extended with a binary insertion sort.
+const MIN_MERGE: usize = 32;
+
+/// The lengths of the pending runs grow at least as fast as the
+/// Fibonacci numbers, so there are never more of them than this.
+const MAX_PENDING: usize = 85;
+
+/// How to decide whether one element sorts before another.
+enum Comparator {
+    Less,
+    Greater,
+    StringLess,
+    Predicate(LispObject),
+}
+
+impl Comparator {
+    fn new(predicate: LispObject) -> Self {
+        // A subr with one of these names can only be the builtin, so
+        // comparing directly gives the same answers as calling it.
+        if let Some(subr) = indirect_function(predicate).as_subr() {
+            match unsafe { CStr::from_ptr(subr.symbol_name()) }.to_bytes() {
+                b"<" => return Comparator::Less,
+                b">" => return Comparator::Greater,
+                b"string-lessp" => return Comparator::StringLess,
+                _ => {}
+            }
+        }
+        Comparator::Predicate(predicate)
+    }
+
+    /// Return true if A sorts before B.
+    fn less(&self, a: LispObject, b: LispObject) -> bool {
+        match *self {
+            Comparator::Less => arithcompare(a, b, ArithComparison::Less),
+            Comparator::Greater => arithcompare(a, b, ArithComparison::Grtr),
+            Comparator::StringLess => string_lessp(a, b),
+            Comparator::Predicate(predicate) => call!(predicate, a, b).is_not_nil(),
+        }
+    }
+}
+
+/// Return the length that runs shorter than it are extended to, for a
+/// slice of LEN elements.  This is chosen so that LEN divided by it is
+/// a power of two, or a bit less than one, which keeps the merges
+/// balanced.
+fn min_run_length(mut len: usize) -> usize {
+    let mut rest = 0;
+    while len >= MIN_MERGE {
+        rest |= len & 1;
+        len >>= 1;
+    }
+    len + rest
+}
+
+struct MergeState {
+    cmp: Comparator,
+    /// The length of the slice being sorted.
+    len: usize,
+    /// Space for the run being merged, or nil until a merge needs it.
+    /// This is a Lisp vector, so that the garbage collector sees the
+    /// elements that are out of the slice while the predicate runs.
+    tmp: LispObject,
+    /// The start and length of each run that is not yet merged.
+    pending: [(usize, usize); MAX_PENDING],
+    npending: usize,
+}
+
+impl MergeState {
+    fn new(predicate: LispObject, len: usize) -> Self {
+        Self {
+            cmp: Comparator::new(predicate),
+            len,
+            tmp: Qnil,
+            pending: [(0, 0); MAX_PENDING],
+            npending: 0,
+        }
+    }
+
+    fn less(&self, a: LispObject, b: LispObject) -> bool {
+        self.cmp.less(a, b)
+    }
+
+    /// Return the index of the first element of V that KEY sorts before.
+    fn upper_bound(&self, v: &[LispObject], key: LispObject) -> usize {
+        let (mut lo, mut hi) = (0, v.len());
+        while lo < hi {
+            let mid = lo + (hi - lo) / 2;
+            if self.less(key, v[mid]) {
+                hi = mid;
+            } else {
+                lo = mid + 1;
+            }
+        }
+        lo
+    }
+
+    /// Return the index of the first element of V that does not sort
+    /// before KEY.
+    fn lower_bound(&self, v: &[LispObject], key: LispObject) -> usize {
+        let (mut lo, mut hi) = (0, v.len());
+        while lo < hi {
+            let mid = lo + (hi - lo) / 2;
+            if self.less(v[mid], key) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
+        }
+        lo
+    }
+
+    /// Sort V, whose first SORTED elements are already in order, by
+    /// inserting each of the others after the elements that do not
+    /// sort after it.
+    fn binary_insertion_sort(&self, v: &mut [LispObject], sorted: usize) {
+        for i in sorted.max(1)..v.len() {
+            let pivot = v[i];
+            let pos = self.upper_bound(&v[..i], pivot);
+            v.copy_within(pos..i, pos + 1);
+            v[pos] = pivot;
+        }
+    }
+
+    /// Return the number of elements at the start of V that are in
+    /// order, after reversing them if they are in strictly descending
+    /// order.  Reversing a run with equal elements would not be stable.
+    fn count_run(&self, v: &mut [LispObject]) -> usize {
+        let len = v.len();
+        if len < 2 {
+            return len;
+        }
+        let mut end = 2;
+        if self.less(v[1], v[0]) {
+            while end < len && self.less(v[end], v[end - 1]) {
+                end += 1;
+            }
+            v[..end].reverse();
+        } else {
+            while end < len && !self.less(v[end], v[end - 1]) {
+                end += 1;
+            }
+        }
+        end
+    }
+
+    fn scratch(&mut self) -> LispVectorRef {
+        if self.tmp.is_nil() {
+            // Only the shorter of two runs is copied out, and that is
+            // at most half of the slice.
+            self.tmp = unsafe { Fmake_vector((self.len / 2).into(), Qnil) };
+        }
+        self.tmp.force_vector()
+    }
+
+    /// Merge the sorted runs V[..LEN1] and V[LEN1..].
+    fn merge(&mut self, v: &mut [LispObject], len1: usize) {
+        // The elements of the first run that sort no later than the
+        // start of the second, and those of the second that sort no
+        // earlier than the end of the first, are already in place.
+        let skip = self.upper_bound(&v[..len1], v[len1]);
+        let v = &mut v[skip..];
+        let len1 = len1 - skip;
+        if len1 == 0 {
+            return;
+        }
+        let len2 = self.lower_bound(&v[len1..], v[len1 - 1]);
+        let v = &mut v[..len1 + len2];
+
+        let mut tmp = self.scratch();
+        if len1 <= len2 {
+            self.merge_lo(v, len1, tmp.as_mut_slice());
+        } else {
+            self.merge_hi(v, len1, tmp.as_mut_slice());
+        }
+    }
+
+    /// Merge V[..LEN1] and V[LEN1..], moving the first run to TMP and
+    /// filling V from the start.
+    fn merge_lo(&self, v: &mut [LispObject], len1: usize, tmp: &mut [LispObject]) {
+        tmp[..len1].copy_from_slice(&v[..len1]);
+        let (mut i, mut j, mut k) = (0, len1, 0);
+        while i < len1 && j < v.len() {
+            if self.less(v[j], tmp[i]) {
+                v[k] = v[j];
+                j += 1;
+            } else {
+                v[k] = tmp[i];
+                i += 1;
+            }
+            k += 1;
+        }
+        v[k..k + len1 - i].copy_from_slice(&tmp[i..len1]);
+    }
+
+    /// Merge V[..LEN1] and V[LEN1..], moving the second run to TMP and
+    /// filling V from the end.
+    fn merge_hi(&self, v: &mut [LispObject], len1: usize, tmp: &mut [LispObject]) {
+        let len2 = v.len() - len1;
+        tmp[..len2].copy_from_slice(&v[len1..]);
+        let (mut i, mut j, mut k) = (len1, len2, v.len());
+        while i > 0 && j > 0 {
+            k -= 1;
+            if self.less(tmp[j - 1], v[i - 1]) {
+                v[k] = v[i - 1];
+                i -= 1;
+            } else {
+                v[k] = tmp[j - 1];
+                j -= 1;
+            }
+        }
+        v[i..i + j].copy_from_slice(&tmp[..j]);
+    }
+
+    /// Merge the pending runs N and N + 1 of V.
+    fn merge_at(&mut self, v: &mut [LispObject], n: usize) {
+        let (base, len1) = self.pending[n];
+        let (_, len2) = self.pending[n + 1];
+        self.pending[n].1 = len1 + len2;
+        if n + 3 == self.npending {
+            self.pending[n + 1] = self.pending[n + 2];
+        }
+        self.npending -= 1;
+        self.merge(&mut v[base..base + len1 + len2], len1);
+    }
+
+    /// Merge pending runs until each is longer than the next one, and
+    /// than the next two together.
+    fn merge_collapse(&mut self, v: &mut [LispObject]) {
+        while self.npending > 1 {
+            let p = &self.pending;
+            let mut n = self.npending - 2;
+            if (n > 0 && p[n - 1].1 <= p[n].1 + p[n + 1].1)
+                || (n > 1 && p[n - 2].1 <= p[n - 1].1 + p[n].1)
+            {
+                if p[n - 1].1 < p[n + 1].1 {
+                    n -= 1;
+                }
+            } else if p[n].1 > p[n + 1].1 {
+                break;
+            }
+            self.merge_at(v, n);
+        }
+    }
+
+    /// Merge all the pending runs.
+    fn merge_force_collapse(&mut self, v: &mut [LispObject]) {
+        while self.npending > 1 {
+            let p = &self.pending;
+            let mut n = self.npending - 2;
+            if n > 0 && p[n - 1].1 < p[n + 1].1 {
+                n -= 1;
+            }
+            self.merge_at(v, n);
+        }
+    }
+}
+
+/// Sort V stably, in the order PREDICATE defines as for `sort'.
+pub fn sort_slice(v: &mut [LispObject], predicate: LispObject) {
+    let len = v.len();
+    if len < 2 {
+        return;
+    }
+
+    let mut state = MergeState::new(predicate, len);
+    let min_run = min_run_length(len);
+    let mut base = 0;
+    while base < len {
+        let mut run = state.count_run(&mut v[base..]);
+        if run < min_run {
+            let forced = min_run.min(len - base);
+            state.binary_insertion_sort(&mut v[base..base + forced], run);
+            run = forced;
+        }
+        state.pending[state.npending] = (base, run);
+        state.npending += 1;
+        base += run;
+        state.merge_collapse(v);
+    }
+    state.merge_force_collapse(v);
+}
@@ -1,6 +1,5 @@
 //! Functions operating on vector(like)s, and general sequences.
 
-use std::cmp::Ordering;
 use std::fmt;
 use std::fmt::{Debug, Formatter};
 use std::mem;
@@ -17,7 +16,7 @@ use crate::{
     frame::LispFrameRef,
     hashtable::LispHashTableRef,
     lisp::{ExternalPtr, LispObject, LispStructuralEqual, LispSubrRef},
-    lists::{inorder, nth, sort_list},
+    lists::{nth, sort_list},
     multibyte::MAX_CHAR,
     process::LispProcessRef,
     remacs_sys::{
@@ -27,6 +26,7 @@ use crate::{
     },
     remacs_sys::{Qarrayp, Qsequencep, Qvectorp},
     threads::ThreadStateRef,
+    timsort::sort_slice,
     window_configuration::SaveWindowDataRef,
     windows::LispWindowRef,
 };
@@ -664,19 +664,7 @@ pub fn sort(seq: LispObject, predicate: LispObject) -> LispObject {
     if seq.is_cons() {
         sort_list(seq, predicate)
     } else if let Some(mut vec) = seq.as_vectorlike().and_then(LispVectorlikeRef::as_vector) {
-        vec.as_mut_slice().sort_by(|&a, &b| {
-            // XXX: since the `sort' predicate is a two-outcome comparison
-            // Less/!Less, and slice::sort_by() uses Greater/!Greater
-            // (which is not guaranteed anyway), this requires two calls
-            // instead of one in some cases.
-            if !inorder(predicate, a, b) {
-                Ordering::Greater
-            } else if inorder(predicate, b, a) {
-                Ordering::Equal
-            } else {
-                Ordering::Less
-            }
-        });
+        sort_slice(vec.as_mut_slice(), predicate);
         seq
     } else if seq.is_nil() {
         seq
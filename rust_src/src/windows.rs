@@ -22,9 +22,9 @@ use crate::{
     remacs_sys::glyph_row_area::TEXT_AREA,
     remacs_sys::{
         apply_window_adjustment, estimate_mode_line_height, minibuf_level,
-        minibuf_selected_window as current_minibuf_window, noninteractive, record_unwind_protect,
-        run_window_configuration_change_hook as run_window_conf_change_hook,
-        save_excursion_restore, save_excursion_save, select_window,
+        minibuf_selected_window as current_minibuf_window, noninteractive,
+        record_unwind_protect_excursion,
+        run_window_configuration_change_hook as run_window_conf_change_hook, select_window,
         selected_window as current_window, set_buffer_internal, set_window_fringes,
         update_mode_lines, window_list_1, window_menu_bar_p, window_scroll, window_tool_bar_p,
         windows_or_buffers_changed, wset_redisplay,
@@ -1550,7 +1550,7 @@ fn scroll_command(n: Option<InteractiveNumericPrefix>, direction: EmacsInt) {
     // the moment.  But don't screw up if window_scroll gets an error.
     if window_buffer != current_buffer {
         unsafe {
-            record_unwind_protect(Some(save_excursion_restore), save_excursion_save());
+            record_unwind_protect_excursion();
         }
         set_buffer(window_buffer.into());
     }
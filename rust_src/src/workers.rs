@@ -0,0 +1,360 @@
+//! A pool of native threads for work that needs no Lisp.
+//!
+//! Lisp threads share one lock, so only one of them runs at a time.
+//! The functions here instead hand a copy of their input to a pool of
+//! native threads, one per processor, and return a future at once.
+//! The workers see only that copy, never the Lisp heap, so they can
+//! run while Lisp does, and the garbage collector needs to know
+//! nothing about them.
+//!
+//! A worker that finishes a task queues its result and writes a byte
+//! to a pipe.  Emacs watches the pipe like any other input, so the
+//! results are turned into Lisp objects, and the callbacks of their
+//! futures called, in whichever Lisp thread next waits for input.
+
+use std::{
+    io::Read,
+    mem, ptr,
+    sync::{mpsc, Arc, Mutex},
+    thread,
+    time::{Duration, Instant},
+};
+
+use libc::{c_char, c_int, c_void};
+
+use remacs_macros::lisp_fn;
+
+use crate::{
+    alloc::record,
+    base64::{base64_decode_1, base64_encode_1},
+    crypto::hex_digest_task,
+    decompress::create_buffer_decoder,
+    fns::nconc,
+    lisp::LispObject,
+    lists::{assq, delq, LispConsCircularChecks, LispConsEndChecks},
+    multibyte::LispStringRef,
+    remacs_sys::{add_read_fd, emacs_pipe, make_unibyte_string, maybe_quit, pending_funcalls},
+    remacs_sys::{EmacsInt, Qerror, Qnil, Qt},
+    symbols::LispSymbolRef,
+    threads::without_global_lock,
+    vectors::LispVectorlikeSlotsRef,
+};
+
+/// What a task returns: the bytes of a unibyte string, or the message
+/// of the error to signal.
+type TaskResult = Result<Vec<u8>, &'static str>;
+
+type Task = Box<dyn FnOnce() -> TaskResult + Send>;
+
+// The slots of a `worker-future' record, after the task's ID.
+/// nil while the task runs, t once it has a value, or `error'.
+const FUTURE_STATUS: usize = 2;
+/// The task's value, or the message of its error.
+const FUTURE_VALUE: usize = 3;
+/// The functions to call when the task is done, in the order given.
+const FUTURE_CALLBACKS: usize = 4;
+
+struct Pool {
+    tasks: mpsc::Sender<(EmacsInt, Task)>,
+    results: Arc<Mutex<Vec<(EmacsInt, TaskResult)>>>,
+    /// The end of the wakeup pipe that Emacs reads.
+    wakeup: c_int,
+}
+
+// Only touched with the global lock held.
+static mut POOL: Option<Pool> = None;
+static mut NEXT_ID: EmacsInt = 0;
+
+// An alist from the IDs of the tasks still running to their futures.
+declare_GC_protected_static!(pending_futures, Qnil);
+
+/// Run the tasks sent to TASKS, putting their results in RESULTS and
+/// writing a byte to WAKEUP after each one.
+fn work(
+    tasks: Arc<Mutex<mpsc::Receiver<(EmacsInt, Task)>>>,
+    results: Arc<Mutex<Vec<(EmacsInt, TaskResult)>>>,
+    wakeup: c_int,
+) {
+    // Leave Emacs's signals to the threads that handle them.
+    unsafe {
+        let mut blocked = mem::zeroed();
+        libc::sigfillset(&mut blocked);
+        libc::pthread_sigmask(libc::SIG_BLOCK, &blocked, ptr::null_mut());
+    }
+
+    loop {
+        let next = tasks.lock().unwrap().recv();
+        let (id, task) = match next {
+            Ok(next) => next,
+            Err(_) => return,
+        };
+        let result = task();
+        results.lock().unwrap().push((id, result));
+        // If the pipe is full, Emacs has a byte to read already.
+        unsafe { libc::write(wakeup, b"\0".as_ptr() as *const c_void, 1) };
+    }
+}
+
+fn pool() -> &'static Pool {
+    unsafe {
+        if let Some(ref pool) = POOL {
+            return pool;
+        }
+
+        let mut fds: [c_int; 2] = [-1, -1];
+        if emacs_pipe(fds.as_mut_ptr()) != 0 {
+            error!("Cannot create a pipe for the worker threads");
+        }
+        for &fd in &fds {
+            libc::fcntl(
+                fd,
+                libc::F_SETFL,
+                libc::fcntl(fd, libc::F_GETFL) | libc::O_NONBLOCK,
+            );
+        }
+
+        let (sender, receiver) = mpsc::channel();
+        let receiver = Arc::new(Mutex::new(receiver));
+        let results = Arc::new(Mutex::new(Vec::new()));
+        let nthreads = libc::sysconf(libc::_SC_NPROCESSORS_ONLN).max(1);
+        for _ in 0..nthreads {
+            let receiver = Arc::clone(&receiver);
+            let results = Arc::clone(&results);
+            let wakeup = fds[1];
+            if thread::Builder::new()
+                .name("emacs-worker".to_string())
+                .spawn(move || work(receiver, results, wakeup))
+                .is_err()
+            {
+                error!("Cannot start the worker threads");
+            }
+        }
+
+        add_read_fd(fds[0], Some(results_ready), ptr::null_mut());
+        POOL = Some(Pool {
+            tasks: sender,
+            results,
+            wakeup: fds[0],
+        });
+        POOL.as_ref().unwrap()
+    }
+}
+
+/// Return a new future for TASK, which is run in the pool.
+fn start(task: Task) -> LispObject {
+    let pool = pool();
+    let id = unsafe {
+        NEXT_ID += 1;
+        NEXT_ID
+    };
+    let future = record(&mut [Qworker_future, id.into(), Qnil, Qnil, Qnil]);
+    unsafe {
+        pending_futures = LispObject::cons(LispObject::cons(id, future), pending_futures);
+    }
+    if pool.tasks.send((id, task)).is_err() {
+        error!("The worker threads have exited");
+    }
+    future
+}
+
+fn future_slots(future: LispObject) -> LispVectorlikeSlotsRef {
+    future
+        .as_vectorlike()
+        .and_then(|v| v.as_record())
+        .filter(|r| r.get(0).eq(Qworker_future))
+        .unwrap_or_else(|| wrong_type!(Qworker_future_p, future))
+}
+
+/// Give the futures of the finished tasks their values, and queue
+/// their callbacks to be called from the next timer check.
+fn collect_results() {
+    let pool = match unsafe { &POOL } {
+        Some(pool) => pool,
+        None => return,
+    };
+
+    // Empty the pipe before taking the results, so that a result queued
+    // meanwhile leaves a byte to wake us again.
+    let mut buf = [0u8; 64];
+    while unsafe { libc::read(pool.wakeup, buf.as_mut_ptr() as *mut c_void, buf.len()) } > 0 {}
+    let done = mem::replace(&mut *pool.results.lock().unwrap(), Vec::new());
+
+    for (id, result) in done {
+        let entry = assq(id.into(), unsafe { pending_futures });
+        let (_, future) = match entry.as_cons() {
+            Some(cons) => cons.into(),
+            None => continue,
+        };
+        unsafe {
+            pending_futures = delq(entry, pending_futures);
+        }
+
+        let mut slots = future_slots(future);
+        let (status, value) = match result {
+            Ok(bytes) => (Qt, unibyte_string(&bytes)),
+            Err(message) => (Qerror, unibyte_string(message.as_bytes())),
+        };
+        slots.set(FUTURE_STATUS, status);
+        slots.set(FUTURE_VALUE, value);
+        let callbacks = slots.get(FUTURE_CALLBACKS);
+        slots.set(FUTURE_CALLBACKS, Qnil);
+        for callback in callbacks.iter_cars(LispConsEndChecks::off, LispConsCircularChecks::off) {
+            defer_call(callback, future);
+        }
+    }
+}
+
+/// Arrange to call CALLBACK with FUTURE from the next timer check.
+fn defer_call(callback: LispObject, future: LispObject) {
+    unsafe {
+        pending_funcalls = nconc(&mut [pending_funcalls, list!(list!(callback, future))]);
+    }
+}
+
+unsafe extern "C" fn results_ready(_fd: c_int, _data: *mut c_void) {
+    collect_results();
+}
+
+fn unibyte_string(bytes: &[u8]) -> LispObject {
+    unsafe { make_unibyte_string(bytes.as_ptr() as *const c_char, bytes.len() as isize) }
+}
+
+/// Return t if OBJECT is a future made by one of the `worker-' functions.
+#[lisp_fn]
+pub fn worker_future_p(object: LispObject) -> bool {
+    object
+        .as_vectorlike()
+        .and_then(|v| v.as_record())
+        .map_or(false, |r| r.get(0).eq(Qworker_future))
+}
+
+/// Return t if the task of FUTURE is done, whether or not it failed.
+#[lisp_fn]
+pub fn worker_future_done_p(future: LispObject) -> bool {
+    collect_results();
+    future_slots(future).get(FUTURE_STATUS).is_not_nil()
+}
+
+/// Wait for the task of FUTURE to finish and return its value.
+/// If the task failed, signal its error.
+/// If TIMEOUT is non-nil, wait at most that many seconds, and return nil
+/// if the task is still running then.  Other Lisp threads run while this
+/// waits, and it can be interrupted with \\[keyboard-quit].
+#[lisp_fn(min = "1")]
+pub fn worker_future_value(future: LispObject, timeout: LispObject) -> LispObject {
+    let slots = future_slots(future);
+    let deadline = if timeout.is_nil() {
+        None
+    } else {
+        // Durations too long to represent mean waiting forever anyway.
+        let secs = timeout.any_to_float_or_error().max(0.0).min(1e9);
+        Some(Instant::now() + Duration::from_secs_f64(secs))
+    };
+
+    loop {
+        collect_results();
+        let status = slots.get(FUTURE_STATUS);
+        if status.eq(Qt) {
+            return slots.get(FUTURE_VALUE);
+        } else if status.eq(Qerror) {
+            xsignal!(Qerror, slots.get(FUTURE_VALUE));
+        }
+
+        let mut wait = Duration::from_millis(100);
+        if let Some(deadline) = deadline {
+            let now = Instant::now();
+            if now >= deadline {
+                return Qnil;
+            }
+            wait = wait.min(deadline - now);
+        }
+        let fd = pool().wakeup;
+        without_global_lock(move || {
+            let mut pollfd = libc::pollfd {
+                fd,
+                events: libc::POLLIN,
+                revents: 0,
+            };
+            unsafe { libc::poll(&mut pollfd, 1, wait.as_millis() as c_int) };
+        });
+        unsafe { maybe_quit() };
+    }
+}
+
+/// Arrange to call CALLBACK with FUTURE as argument when its task is done.
+/// CALLBACK is called when timers are checked next after that, and
+/// `worker-future-value' returns at once there.  Return FUTURE.
+#[lisp_fn]
+pub fn worker_future_then(future: LispObject, callback: LispObject) -> LispObject {
+    collect_results();
+    let mut slots = future_slots(future);
+    if slots.get(FUTURE_STATUS).is_nil() {
+        let callbacks = slots.get(FUTURE_CALLBACKS);
+        slots.set(FUTURE_CALLBACKS, nconc(&mut [callbacks, list!(callback)]));
+    } else {
+        defer_call(callback, future);
+    }
+    future
+}
+
+/// Return a future for the hash of OBJECT with ALGORITHM.
+/// OBJECT and ALGORITHM are as for `secure-hash', and the value is the
+/// hash as a hex string.  OBJECT is copied, so changing it later does
+/// not change the result.
+#[lisp_fn]
+pub fn worker_secure_hash(algorithm: LispSymbolRef, object: LispObject) -> LispObject {
+    let task = hex_digest_task(algorithm, object);
+    start(Box::new(move || Ok(task())))
+}
+
+/// Return a future for the base64 encoding of STRING.
+/// Optional second argument NO-LINE-BREAK means do not break long lines
+/// into shorter lines.  See `base64-encode-string'.
+#[lisp_fn(min = "1")]
+pub fn worker_base64_encode(string: LispStringRef, no_line_break: bool) -> LispObject {
+    let input = string.as_slice().to_vec();
+    let multibyte = string.is_multibyte();
+    start(Box::new(move || {
+        base64_encode_1(&input, !no_line_break, multibyte)
+            .map(String::into_bytes)
+            .map_err(|_| "Multibyte character in data for base64 encoding")
+    }))
+}
+
+/// Return a future for the base64 decoding of STRING.
+/// See `base64-decode-string'.
+#[lisp_fn]
+pub fn worker_base64_decode(string: LispStringRef) -> LispObject {
+    let input = string.as_slice().to_vec();
+    start(Box::new(move || {
+        base64_decode_1(&input, false)
+            .map(|(decoded, _)| decoded)
+            .map_err(|_| "Invalid base64 data")
+    }))
+}
+
+/// Return a future for the decompression of STRING.
+/// STRING must be a unibyte string of gzip- or zlib-compressed data.
+/// See `zlib-decompress-region'.
+#[lisp_fn]
+pub fn worker_zlib_decompress(string: LispStringRef) -> LispObject {
+    if string.is_multibyte() {
+        error!("This function can be called only on unibyte strings");
+    }
+    let input = string.as_slice().to_vec();
+    start(Box::new(move || {
+        if input.is_empty() {
+            return Err("Invalid compressed data");
+        }
+        let mut decompressed = Vec::new();
+        create_buffer_decoder(&input)
+            .read_to_end(&mut decompressed)
+            .map(|_| decompressed)
+            .map_err(|_| "Invalid compressed data")
+    }))
+}
+
+def_lisp_sym!(Qworker_future, "worker-future");
+def_lisp_sym!(Qworker_future_p, "worker-future-p");
+
+include!(concat!(env!("OUT_DIR"), "/workers_exports.rs"));
@@ -820,6 +820,15 @@ malloc_unblock_input (void)
       malloc_probe (size);			\
   } while (0)
 
+/* Tell the allocation profiler that OBJ was allocated, taking SIZE
+   bytes.  */
+
+#define ALLOCATION_PROBE(obj, size)		\
+  do {						\
+    if (profiler_allocation_running)		\
+      allocation_probe (obj, size);		\
+  } while (0)
+
 static void *lmalloc (size_t) ATTRIBUTE_MALLOC_SIZE ((1));
 static void *lrealloc (void *, size_t);
 
@@ -1936,6 +1945,7 @@ allocate_string (void)
   ++total_strings;
   ++strings_consed;
   consing_since_gc += sizeof *s;
+  ALLOCATION_PROBE (make_lisp_ptr (s, Lisp_String), sizeof *s);
 
 #ifdef GC_CHECK_STRING_BYTES
   if (!noninteractive)
@@ -2055,6 +2065,7 @@ allocate_string_data (struct Lisp_String *s,
     }
 
   consing_since_gc += needed;
+  ALLOCATION_PROBE (make_lisp_ptr (s, Lisp_String), needed);
 }
 
 
@@ -2634,6 +2645,7 @@ make_float (double float_value)
   consing_since_gc += sizeof (struct Lisp_Float);
   floats_consed++;
   total_free_floats--;
+  ALLOCATION_PROBE (val, sizeof (struct Lisp_Float));
   return val;
 }
 
@@ -2740,6 +2752,7 @@ DEFUN ("cons", Fcons, Scons, 2, 2, 0,
   consing_since_gc += sizeof (struct Lisp_Cons);
   total_free_conses--;
   cons_cells_consed++;
+  ALLOCATION_PROBE (val, sizeof (struct Lisp_Cons));
   return val;
 }
 
@@ -3127,6 +3140,7 @@ cleanup_vector (struct Lisp_Vector *vector)
 	  /* Attempt to catch subtle bugs like Bug#16140.  */
 	  eassert (valid_font_driver (drv));
 	  drv->close ((struct font *) vector);
+	  font_free_glyph_metrics ((struct font *) vector);
 	}
     }
 
@@ -3285,6 +3299,8 @@ allocate_vectorlike (ptrdiff_t len)
 
       MALLOC_UNBLOCK_INPUT;
 
+      ALLOCATION_PROBE (make_lisp_ptr (p, Lisp_Vectorlike), nbytes);
+
       return ptr_bounds_clip (p, nbytes);
     }
 }
@@ -3530,6 +3546,7 @@ Its value is void, and its function definition and property list are nil.  */)
   consing_since_gc += sizeof (struct Lisp_Symbol);
   symbols_consed++;
   total_free_symbols--;
+  ALLOCATION_PROBE (val, sizeof (struct Lisp_Symbol));
   return val;
 }
 
@@ -3602,6 +3619,7 @@ allocate_misc (enum Lisp_Misc_Type type)
   misc_objects_consed++;
   XMISCANY (val)->type = type;
   XMISCANY (val)->gcmarkbit = 0;
+  ALLOCATION_PROBE (val, sizeof (union Lisp_Misc));
   return val;
 }
 
@@ -5413,8 +5431,10 @@ purecopy_hash_table (struct Lisp_Hash_Table *table)
   pure->hash = purecopy (table->hash);
   pure->next = purecopy (table->next);
   pure->index = purecopy (table->index);
+  pure->old_index = purecopy (table->old_index);
   pure->count = table->count;
   pure->next_free = table->next_free;
+  pure->migrated = table->migrated;
   pure->pure = table->pure;
   pure->rehash_threshold = table->rehash_threshold;
   pure->rehash_size = table->rehash_size;
@@ -5827,6 +5847,8 @@ garbage_collect_1 (void *end)
   mark_terminals ();
   mark_kboards ();
   mark_threads ();
+  mark_allocation_samples ();
+  mark_profiler_spans ();
 
 #ifdef USE_GTK
   xg_mark_data ();
@@ -5867,6 +5889,10 @@ garbage_collect_1 (void *end)
 
   gc_sweep ();
 
+  /* Symbols and functions may have been freed, and their storage
+     reused; forget all definitions cached by Bcall.  */
+  symbol_function_epoch++;
+
   /* Clear the mark bits that we set in certain root slots.  */
   VECTOR_UNMARK (&buffer_defaults);
   VECTOR_UNMARK (&buffer_local_symbols);
@@ -7001,6 +7027,7 @@ gc_sweep (void)
   /* Remove or mark entries in weak hash tables.
      This must be done before any object is unmarked.  */
   sweep_weak_hash_tables ();
+  sweep_allocation_samples ();
 
   sweep_strings ();
   check_string_bytes (!noninteractive);
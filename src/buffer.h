@@ -1173,15 +1173,6 @@ set_buffer_internal (struct buffer *b)
     set_buffer_internal_1 (b);
 }
 
-/* Arrange to go back to the original buffer after the next
-   call to unbind_to if the original buffer is still alive.  */
-
-INLINE void
-record_unwind_current_buffer (void)
-{
-  record_unwind_protect (set_buffer_if_live, Fcurrent_buffer ());
-}
-
 /* Get overlays at POSN into array OVERLAYS with NOVERLAYS elements.
    If NEXTP is non-NULL, return next overlay there.
    See overlay_at arg CHANGE_REQ for meaning of CHRQ arg.  */
@@ -1439,6 +1430,12 @@ struct infile
   /* Lookahead bytes, in reverse order.  Keep these here because it is
      not portable to ungetc more than one byte at a time.  */
   unsigned char buf[MAX_MULTIBYTE_LENGTH - 1];
+
+  /* If non-null, the next SIZE bytes of the stream, read in one go
+     when loading started.  Reading continues from the stream itself
+     once POS reaches SIZE.  */
+  unsigned char *contents;
+  ptrdiff_t pos, size;
 };
 
 /* Defined in buffer.c.  */
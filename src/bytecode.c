@@ -317,6 +317,54 @@ bcall0 (Lisp_Object f)
   Ffuncall (1, &f);
 }
 
+/* The definitions of the functions called by Bcall instructions,
+   indexed by a hash of the address of the instruction.  A call site
+   that keeps calling the same symbol finds the definition here,
+   without following the symbol's function cell and aliases.
+
+   An entry is valid only while symbol_function_epoch has the value it
+   had when the entry was made.  Garbage collection advances the epoch,
+   so the entries need not be marked.  */
+
+struct call_cache_entry
+{
+  Lisp_Object symbol;
+  Lisp_Object definition;
+  EMACS_UINT epoch;
+};
+
+enum { CALL_CACHE_BITS = 10 };
+
+static struct call_cache_entry call_cache[1 << CALL_CACHE_BITS];
+
+/* Return the definition of SYMBOL, which the Bcall instruction ending
+   at PC calls, or nil if the definition should not be cached.  */
+
+static Lisp_Object
+call_cache_lookup (Lisp_Object symbol, const unsigned char *pc)
+{
+  uintptr_t key = (uintptr_t) pc;
+  struct call_cache_entry *entry
+    = &call_cache[(key ^ key >> CALL_CACHE_BITS)
+		  & ((1 << CALL_CACHE_BITS) - 1)];
+
+  if (EQ (entry->symbol, symbol) && entry->epoch == symbol_function_epoch)
+    return entry->definition;
+
+  /* Autoloads and macros are left to Ffuncall.  */
+  Lisp_Object definition = indirect_function (symbol);
+  if (! (SUBRP (definition) || COMPILEDP (definition)
+	 || (CONSP (definition)
+	     && (EQ (XCAR (definition), Qlambda)
+		 || EQ (XCAR (definition), Qclosure)))))
+    return Qnil;
+
+  entry->symbol = symbol;
+  entry->definition = definition;
+  entry->epoch = symbol_function_epoch;
+  return definition;
+}
+
 /* Execute the byte-code in BYTESTR.  VECTOR is the constant vector, and
    MAXDEPTH is the maximum stack depth used (if MAXDEPTH is incorrect,
    emacs may crash!).  If ARGS_TEMPLATE is non-nil, it should be a lisp
@@ -325,6 +373,39 @@ bcall0 (Lisp_Object f)
    ARGS are pushed on the stack according to ARGS_TEMPLATE before
    executing BYTESTR.  */
 
+/* Undo the last N specpdl entries, like unbind_to.  Plain `let'
+   bindings of untrapped variables and `save-current-buffer' are the
+   usual cases, and need nothing but their old value put back; pop
+   those here, and leave anything else to unbind_to.  */
+
+static void
+unbind_n (ptrdiff_t n)
+{
+  union specbinding *stop = specpdl_ptr - n;
+
+  while (specpdl_ptr != stop)
+    {
+      union specbinding *bind = specpdl_ptr - 1;
+      if (bind->kind == SPECPDL_UNWIND_BUFFER)
+	{
+	  specpdl_ptr = bind;
+	  set_buffer_if_live (bind->unwind_buffer.buffer);
+	  continue;
+	}
+      if (bind->kind != SPECPDL_LET)
+	break;
+      struct Lisp_Symbol *sym = XSYMBOL (bind->let.symbol);
+      if (sym->u.s.redirect != SYMBOL_PLAINVAL
+	  || sym->u.s.trapped_write != SYMBOL_UNTRAPPED_WRITE)
+	break;
+      specpdl_ptr = bind;
+      SET_SYMBOL_VAL (sym, bind->let.old_value);
+    }
+
+  if (specpdl_ptr != stop)
+    unbind_to (stop - specpdl, Qnil);
+}
+
 Lisp_Object
 exec_byte_code (Lisp_Object bytestr, Lisp_Object vector, Lisp_Object maxdepth,
 		Lisp_Object args_template, ptrdiff_t nargs, Lisp_Object *args)
@@ -618,7 +699,12 @@ exec_byte_code (Lisp_Object bytestr, Lisp_Object vector, Lisp_Object maxdepth,
 		  }
 	      }
 #endif
-	    TOP = Ffuncall (op + 1, &TOP);
+	    Lisp_Object definition = (SYMBOLP (TOP) && !NILP (TOP)
+				      ? call_cache_lookup (TOP, pc) : Qnil);
+	    if (NILP (definition))
+	      TOP = Ffuncall (op + 1, &TOP);
+	    else
+	      TOP = funcall_with_definition (op + 1, &TOP, definition);
 	    NEXT;
 	  }
 
@@ -638,7 +724,7 @@ exec_byte_code (Lisp_Object bytestr, Lisp_Object vector, Lisp_Object maxdepth,
 	CASE (Bunbind5):
 	  op -= Bunbind;
 	dounbind:
-	  unbind_to (SPECPDL_INDEX () - op, Qnil);
+	  unbind_n (op);
 	  NEXT;
 
 	CASE (Bunbind_all):	/* Obsolete.  Never used.  */
@@ -728,8 +814,7 @@ exec_byte_code (Lisp_Object bytestr, Lisp_Object vector, Lisp_Object maxdepth,
 	  NEXT;
 
 	CASE (Bsave_excursion):
-	  record_unwind_protect (save_excursion_restore,
-				 save_excursion_save ());
+	  record_unwind_protect_excursion ();
 	  NEXT;
 
 	CASE (Bsave_current_buffer): /* Obsolete since ??.  */
@@ -29,6 +29,10 @@ along with GNU Emacs.  If not, see <https://www.gnu.org/licenses/>.  */
 #include <sys/file.h>
 #include <fcntl.h>
 
+#ifdef HAVE_POSIX_SPAWN
+# include <spawn.h>
+#endif
+
 #include "lisp.h"
 
 #ifdef WINDOWSNT
@@ -56,6 +60,18 @@ along with GNU Emacs.  If not, see <https://www.gnu.org/licenses/>.  */
 
 #include "remacs-lib.h"
 
+/* posix_spawn can set the child up as child_setup would only if it
+   can change the child's directory and start a new session.  Darwin
+   has both, but does not let a child run setsid after a vfork, so
+   stay with the path that is known to work there.  */
+#if (defined HAVE_POSIX_SPAWN \
+     && defined HAVE_POSIX_SPAWN_FILE_ACTIONS_ADDCHDIR_NP \
+     && defined POSIX_SPAWN_SETSID && !defined DARWIN_OS)
+# define USABLE_POSIX_SPAWN true
+#else
+# define USABLE_POSIX_SPAWN false
+#endif
+
 /* Pattern used by call-process-region to make temp files.  */
 static Lisp_Object Vtemp_file_name_pattern;
 
@@ -223,6 +239,10 @@ call_process (ptrdiff_t nargs, Lisp_Object *args, int filefd,
   USE_SAFE_ALLOCA;
 
   char **new_argv;
+  /* The child's environment, and whether to start it with
+     posix_spawn.  */
+  char **env;
+  bool spawn;
   /* File to use for stderr in the child.
      t means use same as standard output.  */
   Lisp_Object error_file;
@@ -439,6 +459,10 @@ call_process (ptrdiff_t nargs, Lisp_Object *args, int filefd,
       callproc_fd[CALLPROC_STDERR] = fd_error;
     }
 
+  env = make_environment_block (current_dir);
+  record_unwind_protect_ptr (xfree, env);
+  spawn = spawn_child_p ();
+
   /* Do the unwind-protect now, even though the pid is not known, so
      that no storage allocation is done in the critical section.
      The actual PID will be filled in during the critical section.  */
@@ -448,44 +472,54 @@ call_process (ptrdiff_t nargs, Lisp_Object *args, int filefd,
   block_child_signal (&oldset);
 
 #ifdef WINDOWSNT
-  pid = child_setup (filefd, fd_output, fd_error, new_argv, 0, current_dir);
+  pid = child_setup (filefd, fd_output, fd_error, new_argv, env, 0,
+		     current_dir);
 #else  /* not WINDOWSNT */
 
-  /* vfork, and prevent local vars from being clobbered by the vfork.  */
-  {
-    Lisp_Object volatile buffer_volatile = buffer;
-    Lisp_Object volatile coding_systems_volatile = coding_systems;
-    Lisp_Object volatile current_dir_volatile = current_dir;
-    bool volatile display_p_volatile = display_p;
-    bool volatile sa_must_free_volatile = sa_must_free;
-    int volatile fd_error_volatile = fd_error;
-    int volatile filefd_volatile = filefd;
-    ptrdiff_t volatile count_volatile = count;
-    ptrdiff_t volatile sa_avail_volatile = sa_avail;
-    ptrdiff_t volatile sa_count_volatile = sa_count;
-    char **volatile new_argv_volatile = new_argv;
-    int volatile callproc_fd_volatile[CALLPROC_FDS];
-    for (i = 0; i < CALLPROC_FDS; i++)
-      callproc_fd_volatile[i] = callproc_fd[i];
-
-    pid = vfork ();
-
-    buffer = buffer_volatile;
-    coding_systems = coding_systems_volatile;
-    current_dir = current_dir_volatile;
-    display_p = display_p_volatile;
-    sa_must_free = sa_must_free_volatile;
-    fd_error = fd_error_volatile;
-    filefd = filefd_volatile;
-    count = count_volatile;
-    sa_avail = sa_avail_volatile;
-    sa_count = sa_count_volatile;
-    new_argv = new_argv_volatile;
-
-    for (i = 0; i < CALLPROC_FDS; i++)
-      callproc_fd[i] = callproc_fd_volatile[i];
-    fd_output = callproc_fd[CALLPROC_STDOUT];
-  }
+  pid = (spawn
+	 ? spawn_child (filefd, fd_output, fd_error, new_argv, env,
+			current_dir, &oldset, false)
+	 : -1);
+
+  /* Unless posix_spawn started the child, vfork, and prevent local
+     vars from being clobbered by the vfork.  */
+  if (pid < 0)
+    {
+      Lisp_Object volatile buffer_volatile = buffer;
+      Lisp_Object volatile coding_systems_volatile = coding_systems;
+      Lisp_Object volatile current_dir_volatile = current_dir;
+      bool volatile display_p_volatile = display_p;
+      bool volatile sa_must_free_volatile = sa_must_free;
+      int volatile fd_error_volatile = fd_error;
+      int volatile filefd_volatile = filefd;
+      ptrdiff_t volatile count_volatile = count;
+      ptrdiff_t volatile sa_avail_volatile = sa_avail;
+      ptrdiff_t volatile sa_count_volatile = sa_count;
+      char **volatile new_argv_volatile = new_argv;
+      char **volatile env_volatile = env;
+      int volatile callproc_fd_volatile[CALLPROC_FDS];
+      for (i = 0; i < CALLPROC_FDS; i++)
+	callproc_fd_volatile[i] = callproc_fd[i];
+
+      pid = vfork ();
+
+      buffer = buffer_volatile;
+      coding_systems = coding_systems_volatile;
+      current_dir = current_dir_volatile;
+      display_p = display_p_volatile;
+      sa_must_free = sa_must_free_volatile;
+      fd_error = fd_error_volatile;
+      filefd = filefd_volatile;
+      count = count_volatile;
+      sa_avail = sa_avail_volatile;
+      sa_count = sa_count_volatile;
+      new_argv = new_argv_volatile;
+      env = env_volatile;
+
+      for (i = 0; i < CALLPROC_FDS; i++)
+	callproc_fd[i] = callproc_fd_volatile[i];
+      fd_output = callproc_fd[CALLPROC_STDOUT];
+    }
 
   if (pid == 0)
     {
@@ -519,7 +553,8 @@ call_process (ptrdiff_t nargs, Lisp_Object *args, int filefd,
       signal (SIGPROF, SIG_DFL);
 #endif
 
-      child_setup (filefd, fd_output, fd_error, new_argv, 0, current_dir);
+      child_setup (filefd, fd_output, fd_error, new_argv, env, 0,
+		   current_dir);
     }
 
 #endif /* not WINDOWSNT */
@@ -908,12 +943,268 @@ add_env (char **env, char **new_env, char *string)
   return new_env;
 }
 
+/* The environment that process-environment specifies, as of the last
+   time a subprocess was started.  Each string in the null-terminated
+   ENV_CACHE is a copy of an element of ENV_CACHE_SOURCE, which is a
+   copy of the list itself; the first definition of each variable is
+   kept, and names without values are left out.  Rebuilding this only
+   when process-environment changes saves walking and deduplicating
+   the whole list every time a subprocess starts.  */
+static char **env_cache;
+static ptrdiff_t env_cache_length;
+static Lisp_Object env_cache_source;
+
+/* True if process-environment defines PWD, in which case the child
+   gets PWD set to its current directory.  ENV_CACHE has no PWD entry
+   then.  */
+static bool env_cache_pwd;
+
+/* True if process-environment mentions DISPLAY at all.  */
+static bool env_cache_display;
+
+/* Make ENV_CACHE describe process-environment, unless it does
+   already.  */
+
+static void
+update_environment_cache (void)
+{
+  Lisp_Object tem, cached;
+
+  for (tem = Vprocess_environment, cached = env_cache_source;
+       CONSP (tem) && CONSP (cached);
+       tem = XCDR (tem), cached = XCDR (cached))
+    if (!EQ (XCAR (tem), XCAR (cached)))
+      break;
+  if (env_cache && NILP (tem) && NILP (cached))
+    return;
+
+  ptrdiff_t length = 0, size = 0;
+  for (tem = Vprocess_environment;
+       CONSP (tem) && STRINGP (XCAR (tem));
+       tem = XCDR (tem))
+    {
+      length++;
+      size += SBYTES (XCAR (tem)) + 1;
+    }
+
+  /* Leave room for a placeholder for PWD and the terminating 0, and
+     put the strings after the pointers.  */
+  char **env = xmalloc ((length + 2) * sizeof *env + size);
+  char *data = (char *) (env + length + 2);
+  char **new_env = env;
+  bool pwd = egetenv ("PWD") != NULL;
+  bool display = false;
+
+  /* A PWD definition is made up for each child, so it overrides the
+     ones in process-environment.  */
+  if (pwd)
+    *new_env++ = (char *) "PWD=";
+
+  for (tem = Vprocess_environment;
+       CONSP (tem) && STRINGP (XCAR (tem));
+       tem = XCDR (tem))
+    {
+      char *string = data;
+      data = lispstpcpy (data, XCAR (tem)) + 1;
+      if (strncmp (string, "DISPLAY", 7) == 0
+	  && (string[7] == '\0' || string[7] == '='))
+	display = true;
+      new_env = add_env (env, new_env, string);
+    }
+  *new_env = 0;
+
+  /* Remove the PWD placeholder and variable names without values.  */
+  char **p = env, **q = env + pwd;
+  for (; *q; q++)
+    if (strchr (*q, '='))
+      *p++ = *q;
+  *p = 0;
+
+  xfree (env_cache);
+  env_cache = env;
+  env_cache_length = p - env;
+  env_cache_pwd = pwd;
+  env_cache_display = display;
+
+  Lisp_Object source = Qnil;
+  for (tem = Vprocess_environment; CONSP (tem); tem = XCDR (tem))
+    source = Fcons (XCAR (tem), source);
+  env_cache_source = Fnreverse (source);
+}
+
+/* Return the environment for a child whose current directory is
+   CURRENT_DIR, as a null-terminated vector of strings.  This sets
+   PWD to CURRENT_DIR if process-environment defines PWD, and DISPLAY
+   to the selected frame's display if process-environment does not
+   mention DISPLAY.  Free the result with xfree after the child is
+   started, and before the next call to this function.  */
+
+char **
+make_environment_block (Lisp_Object current_dir)
+{
+  Lisp_Object display = Qnil;
+  char **env, **new_env;
+  ptrdiff_t dirlen = SBYTES (current_dir), size;
+
+  update_environment_cache ();
+
+  /* If not provided yet, use the frame's DISPLAY.  */
+  if (!env_cache_display)
+    {
+      Lisp_Object tmp = Fframe_parameter (selected_frame, Qdisplay);
+      if (!STRINGP (tmp) && CONSP (Vinitial_environment))
+	/* If still not found, Look for DISPLAY in Vinitial_environment.  */
+	tmp = Fgetenv_internal (build_string ("DISPLAY"),
+				Vinitial_environment);
+      if (STRINGP (tmp))
+	display = tmp;
+    }
+
+  /* Leave room for PWD, DISPLAY and the terminating 0, and put their
+     values after the pointers.  */
+  size = ((env_cache_length + 3) * sizeof *env
+	  + sizeof "PWD=" + dirlen
+	  + sizeof "DISPLAY=" + (STRINGP (display) ? SBYTES (display) : 0));
+  env = new_env = xmalloc (size);
+  char *data = (char *) (env + env_cache_length + 3);
+
+  /* If we have a PWD envvar, pass one down,
+     but with corrected value.  */
+  if (env_cache_pwd)
+    {
+      char *temp = stpcpy (data, "PWD=");
+      ptrdiff_t i = dirlen;
+      *new_env++ = data;
+      data = lispstpcpy (temp, current_dir) + 1;
+
+#ifdef DOS_NT
+      /* Get past the drive letter, so that d:/ is left alone.  */
+      if (i > 2 && IS_DEVICE_SEP (temp[1]) && IS_DIRECTORY_SEP (temp[2]))
+	{
+	  temp += 2;
+	  i -= 2;
+	}
+#endif /* DOS_NT */
+
+      /* Strip trailing slashes for PWD, but leave "/" and "//" alone.  */
+      while (i > 2 && IS_DIRECTORY_SEP (temp[i - 1]))
+	temp[--i] = 0;
+    }
+
+  if (STRINGP (display))
+    {
+      *new_env++ = data;
+      lispstpcpy (stpcpy (data, "DISPLAY="), display);
+    }
+
+  memcpy (new_env, env_cache, (env_cache_length + 1) * sizeof *env);
+  return env;
+}
+
+/* Return true if spawn_child can start a child that is set up just as
+   one that child_setup starts.  */
+
+bool
+spawn_child_p (void)
+{
+#if USABLE_POSIX_SPAWN
+  return (process_use_posix_spawn
+	  /* Only a child of ours can restore the limit on open files,
+	     or undo the personality change that dumping needs.  */
+	  && !nofile_limit_lowered ()
+# ifdef HAVE_PERSONALITY_ADDR_NO_RANDOMIZE
+	  && !getenv ("EMACS_HEAP_EXEC")
+# endif
+	  );
+#else
+  return false;
+#endif
+}
+
+/* Start NEW_ARGV[0] with posix_spawn, which unlike vfork never runs
+   any of our code in the child, in a new session with descriptors IN,
+   OUT and ERR as its standard input, output and error, environment
+   ENV, current directory CURRENT_DIR and signal mask OLDSET.  Unless
+   ASYNC, leave SIGINT and SIGQUIT as they are, as call_process does.
+
+   Return the child's process ID, or -1 with errno set if it could not
+   be started; the caller can then fall back on vfork and child_setup,
+   which report failures to exec the way callers expect.  */
+
+pid_t
+spawn_child (int in, int out, int err, char **new_argv, char **env,
+	     Lisp_Object current_dir, sigset_t const *oldset, bool async)
+{
+#if USABLE_POSIX_SPAWN
+  posix_spawn_file_actions_t actions;
+  posix_spawnattr_t attributes;
+  sigset_t sigdefault;
+  pid_t pid;
+  int error;
+
+  error = posix_spawn_file_actions_init (&actions);
+  if (error != 0)
+    {
+      errno = error;
+      return -1;
+    }
+  error = posix_spawnattr_init (&attributes);
+  if (error != 0)
+    {
+      posix_spawn_file_actions_destroy (&actions);
+      errno = error;
+      return -1;
+    }
+
+  /* Emacs ignores SIGPIPE, but the child should not.  Likewise for
+     SIGPROF.  */
+  sigemptyset (&sigdefault);
+  sigaddset (&sigdefault, SIGPIPE);
+#ifdef SIGPROF
+  sigaddset (&sigdefault, SIGPROF);
+#endif
+  if (async)
+    {
+      sigaddset (&sigdefault, SIGINT);
+      sigaddset (&sigdefault, SIGQUIT);
+    }
+
+  /* IN, OUT and ERR are close-on-exec, and the duplicates are not.  */
+  if (! ((error = posix_spawn_file_actions_adddup2 (&actions, in,
+						     STDIN_FILENO))
+	 || (error = posix_spawn_file_actions_adddup2 (&actions, out,
+							STDOUT_FILENO))
+	 || (error = posix_spawn_file_actions_adddup2 (&actions, err,
+							STDERR_FILENO))
+	 || (error = posix_spawn_file_actions_addchdir_np
+	     (&actions, SSDATA (current_dir)))
+	 || (error = posix_spawnattr_setflags (&attributes,
+					       (POSIX_SPAWN_SETSID
+						| POSIX_SPAWN_SETSIGMASK
+						| POSIX_SPAWN_SETSIGDEF)))
+	 || (error = posix_spawnattr_setsigmask (&attributes, oldset))
+	 || (error = posix_spawnattr_setsigdefault (&attributes,
+						    &sigdefault))))
+    error = posix_spawn (&pid, new_argv[0], &actions, &attributes,
+			 new_argv, env);
+
+  posix_spawnattr_destroy (&attributes);
+  posix_spawn_file_actions_destroy (&actions);
+  if (error != 0)
+    {
+      errno = error;
+      return -1;
+    }
+  return pid;
+#else
+  errno = ENOSYS;
+  return -1;
+#endif
+}
+
 #ifndef DOS_NT
 
 /* 'exec' failed inside a child running NAME, with error number ERR.
-   Possibly a vforked child needed to allocate a large vector on the
-   stack; such a child cannot fall back on malloc because that might
-   mess up the allocator's data structures in the parent.
    Report the error and exit the child.  */
 
 static _Noreturn void
@@ -932,7 +1223,7 @@ exec_failed (char const *name, int err)
 #else
 
 /* Do nothing.  There is no need to fail, as DOS_NT platforms do not
-   fork and exec, and handle alloca exhaustion in a different way.  */
+   fork and exec.  */
 
 static void
 exec_failed (char const *name, int err)
@@ -947,7 +1238,9 @@ exec_failed (char const *name, int err)
    Initialize inferior's priority, pgrp, connected dir and environment.
    then exec another program based on new_argv.
 
-   If SET_PGRP, put the subprocess into a separate process group.
+   ENV is the environment to give the subprocess, as made by
+   make_environment_block.  If SET_PGRP, put the subprocess into a
+   separate process group.
 
    CURRENT_DIR is an elisp string giving the path of the current
    directory the subprocess should have.  Since we can't really signal
@@ -959,11 +1252,9 @@ exec_failed (char const *name, int err)
    On MS-DOS, either return an exit status or signal an error.  */
 
 CHILD_SETUP_TYPE
-child_setup (int in, int out, int err, char **new_argv, bool set_pgrp,
-	     Lisp_Object current_dir)
+child_setup (int in, int out, int err, char **new_argv, char **env,
+	     bool set_pgrp, Lisp_Object current_dir)
 {
-  char **env;
-  char *pwd_var;
 #ifdef WINDOWSNT
   int cpid;
   HANDLE handles[3];
@@ -971,122 +1262,6 @@ child_setup (int in, int out, int err, char **new_argv, bool set_pgrp,
   pid_t pid = getpid ();
 #endif /* WINDOWSNT */
 
-  /* Note that use of alloca is always safe here.  It's obvious for systems
-     that do not have true vfork or that have true (stack) alloca.
-     If using vfork and C_ALLOCA (when Emacs used to include
-     src/alloca.c) it is safe because that changes the superior's
-     static variables as if the superior had done alloca and will be
-     cleaned up in the usual way. */
-  {
-    char *temp;
-    ptrdiff_t i;
-
-    i = SBYTES (current_dir);
-    if (MAX_ALLOCA - 5 < i)
-      exec_failed (new_argv[0], ENOMEM);
-    pwd_var = alloca (i + 5);
-    temp = pwd_var + 4;
-    memcpy (pwd_var, "PWD=", 4);
-    lispstpcpy (temp, current_dir);
-
-#ifndef DOS_NT
-    /* We can't signal an Elisp error here; we're in a vfork.  Since
-       the callers check the current directory before forking, this
-       should only return an error if the directory's permissions
-       are changed between the check and this chdir, but we should
-       at least check.  */
-    if (chdir (temp) < 0)
-      _exit (EXIT_CANCELED);
-#else /* DOS_NT */
-    /* Get past the drive letter, so that d:/ is left alone.  */
-    if (i > 2 && IS_DEVICE_SEP (temp[1]) && IS_DIRECTORY_SEP (temp[2]))
-      {
-	temp += 2;
-	i -= 2;
-      }
-#endif /* DOS_NT */
-
-    /* Strip trailing slashes for PWD, but leave "/" and "//" alone.  */
-    while (i > 2 && IS_DIRECTORY_SEP (temp[i - 1]))
-      temp[--i] = 0;
-  }
-
-  /* Set `env' to a vector of the strings in the environment.  */
-  {
-    register Lisp_Object tem;
-    register char **new_env;
-    char **p, **q;
-    register int new_length;
-    Lisp_Object display = Qnil;
-
-    new_length = 0;
-
-    for (tem = Vprocess_environment;
-	 CONSP (tem) && STRINGP (XCAR (tem));
-	 tem = XCDR (tem))
-      {
-	if (strncmp (SSDATA (XCAR (tem)), "DISPLAY", 7) == 0
-	    && (SDATA (XCAR (tem)) [7] == '\0'
-		|| SDATA (XCAR (tem)) [7] == '='))
-	  /* DISPLAY is specified in process-environment.  */
-	  display = Qt;
-	new_length++;
-      }
-
-    /* If not provided yet, use the frame's DISPLAY.  */
-    if (NILP (display))
-      {
-	Lisp_Object tmp = Fframe_parameter (selected_frame, Qdisplay);
-	if (!STRINGP (tmp) && CONSP (Vinitial_environment))
-	  /* If still not found, Look for DISPLAY in Vinitial_environment.  */
-	  tmp = Fgetenv_internal (build_string ("DISPLAY"),
-				  Vinitial_environment);
-	if (STRINGP (tmp))
-	  {
-	    display = tmp;
-	    new_length++;
-	  }
-      }
-
-    /* new_length + 2 to include PWD and terminating 0.  */
-    if (MAX_ALLOCA / sizeof *env - 2 < new_length)
-      exec_failed (new_argv[0], ENOMEM);
-    env = new_env = alloca ((new_length + 2) * sizeof *env);
-    /* If we have a PWD envvar, pass one down,
-       but with corrected value.  */
-    if (egetenv ("PWD"))
-      *new_env++ = pwd_var;
-
-    if (STRINGP (display))
-      {
-	if (MAX_ALLOCA - sizeof "DISPLAY=" < SBYTES (display))
-	  exec_failed (new_argv[0], ENOMEM);
-	char *vdata = alloca (sizeof "DISPLAY=" + SBYTES (display));
-	lispstpcpy (stpcpy (vdata, "DISPLAY="), display);
-	new_env = add_env (env, new_env, vdata);
-      }
-
-    /* Overrides.  */
-    for (tem = Vprocess_environment;
-	 CONSP (tem) && STRINGP (XCAR (tem));
-	 tem = XCDR (tem))
-      new_env = add_env (env, new_env, SSDATA (XCAR (tem)));
-
-    *new_env = 0;
-
-    /* Remove variable names without values.  */
-    p = q = env;
-    while (*p != 0)
-      {
-	while (*q != 0 && strchr (*q, '=') == NULL)
-	  q++;
-	*p = *q++;
-	if (*p != 0)
-	  p++;
-      }
-  }
-
-
 #ifdef WINDOWSNT
   prepare_standard_handles (in, out, err, handles);
   set_process_dir (SSDATA (current_dir));
@@ -1100,6 +1275,14 @@ child_setup (int in, int out, int err, char **new_argv, bool set_pgrp,
 
 #else  /* not WINDOWSNT */
 
+  /* We can't signal an Elisp error here; we're in a vfork.  Since
+     the callers check the current directory before forking, this
+     should only return an error if the directory's permissions
+     are changed between the check and this chdir, but we should
+     at least check.  */
+  if (chdir (SSDATA (current_dir)) < 0)
+    _exit (EXIT_CANCELED);
+
   restore_nofile_limit ();
 
   /* Redirect file descriptors and clear the close-on-exec flag on the
@@ -1398,6 +1581,7 @@ syms_of_callproc (void)
   Vtemp_file_name_pattern = build_string ("emXXXXXX");
 #endif
   staticpro (&Vtemp_file_name_pattern);
+  staticpro (&env_cache_source);
 
   DEFVAR_LISP ("shell-file-name", Vshell_file_name,
 	       doc: /* File name to load inferior shells from.
@@ -1470,5 +1654,13 @@ use.
 See `setenv' and `getenv'.  */);
   Vprocess_environment = Qnil;
 
+  DEFVAR_BOOL ("process-use-posix-spawn", process_use_posix_spawn,
+	       doc: /* Non-nil means start subprocesses with `posix_spawn' if possible.
+`posix_spawn' starts a subprocess without running any Emacs code in
+it, which is cheaper than `vfork' for short-lived subprocesses.  It is
+not used for subprocesses that get a pty, or on systems where it
+cannot change the subprocess's directory or start a new session.  */);
+  process_use_posix_spawn = true;
+
   defsubr (&Sgetenv_internal);
 }
@@ -1144,6 +1144,67 @@ alloc_destination (struct coding_system *coding, ptrdiff_t nbytes,
 #define UTF_8_BOM_2 0xBB
 #define UTF_8_BOM_3 0xBF
 
+/* Word-at-a-time helpers for the UTF-8 and ASCII scanners.  A coding_word is
+   loaded from possibly unaligned memory, and looked at as a vector of
+   bytes.  */
+
+typedef uintptr_t coding_word;
+enum { CODING_WORD_SIZE = sizeof (coding_word) };
+
+/* A word with every byte set to 0x01, resp. 0x80.  */
+#define CODING_WORD_ONES ((coding_word) -1 / UCHAR_MAX)
+#define CODING_WORD_HIGHS (CODING_WORD_ONES << (CHAR_BIT - 1))
+
+static coding_word
+load_coding_word (const unsigned char *p)
+{
+  coding_word w;
+  memcpy (&w, p, sizeof w);
+  return w;
+}
+
+/* Return true if a byte of W is a non-ASCII byte.  */
+
+static bool
+coding_word_nonascii_p (coding_word w)
+{
+  return (w & CODING_WORD_HIGHS) != 0;
+}
+
+/* Return true if a byte of W equals B.  */
+
+static bool
+coding_word_has_byte (coding_word w, unsigned char b)
+{
+  coding_word x = w ^ (CODING_WORD_ONES * b);
+  return ((x - CODING_WORD_ONES) & ~x & CODING_WORD_HIGHS) != 0;
+}
+
+/* Return the number of UTF-8 continuation bytes (10xxxxxx) in W.  */
+
+static int
+coding_word_utf_8_continuations (coding_word w)
+{
+  coding_word t = (w & ~(w << 1) & CODING_WORD_HIGHS) >> (CHAR_BIT - 1);
+  return (t * CODING_WORD_ONES) >> ((CODING_WORD_SIZE - 1) * CHAR_BIT);
+}
+
+/* Return the number of characters in the NBYTES bytes of valid UTF-8
+   at P, i.e. the number of bytes that are not continuation bytes.  */
+
+static ptrdiff_t
+utf_8_chars_in_bytes (const unsigned char *p, ptrdiff_t nbytes)
+{
+  const unsigned char *end = p + nbytes;
+  ptrdiff_t continuations = 0;
+
+  for (; end - p >= CODING_WORD_SIZE; p += CODING_WORD_SIZE)
+    continuations += coding_word_utf_8_continuations (load_coding_word (p));
+  for (; p < end; p++)
+    continuations += UTF_8_EXTRA_OCTET_P (*p);
+  return nbytes - continuations;
+}
+
 /* Unlike the other detect_coding_XXX, this function counts the number
    of characters and checks the EOL format.  */
 
@@ -1320,10 +1381,24 @@ decode_coding_utf_8 (struct coding_system *coding)
 	  break;
 	}
 
-      /* In the simple case, rapidly handle ordinary characters */
-      if (multibytep && ! eol_dos
+      /* In the simple case, rapidly handle ordinary characters.  ASCII
+	 bytes stand for themselves whether the source is unibyte or
+	 multibyte.  */
+      if (! eol_dos
 	  && charbuf < charbuf_end - 6 && src < src_end - 6)
 	{
+	  /* First a word at a time, as long as the words are ASCII.  */
+	  while (charbuf_end - charbuf > CODING_WORD_SIZE + 6
+		 && src_end - src > CODING_WORD_SIZE + 6)
+	    {
+	      int i;
+
+	      if (coding_word_nonascii_p (load_coding_word (src)))
+		break;
+	      for (i = 0; i < CODING_WORD_SIZE; i++)
+		*charbuf++ = *src++;
+	      consumed_chars += CODING_WORD_SIZE;
+	    }
 	  while (charbuf < charbuf_end - 6 && src < src_end - 6)
 	    {
 	      c1 = *src;
@@ -6202,6 +6277,15 @@ check_ascii (struct coding_system *coding)
       || SYMBOLP (eol_type))
     {
       /* We don't have to check EOL format.  */
+      for (; end - src >= CODING_WORD_SIZE; src += CODING_WORD_SIZE)
+	{
+	  coding_word w = load_coding_word (src);
+
+	  if (coding_word_nonascii_p (w))
+	    break;
+	  if (coding_word_has_byte (w, '\n'))
+	    eol_seen |= EOL_SEEN_LF;
+	}
       while (src < end && !( *src & 0x80))
 	{
 	  if (*src++ == '\n')
@@ -6213,8 +6297,23 @@ check_ascii (struct coding_system *coding)
       end--;		    /* We look ahead one byte for "CR LF".  */
       while (src < end)
 	{
-	  int c = *src;
+	  int c;
 
+	  /* Skip a whole word at once if it has no CR to look at.  */
+	  if (end - src >= CODING_WORD_SIZE)
+	    {
+	      coding_word w = load_coding_word (src);
+
+	      if (! coding_word_nonascii_p (w)
+		  && ! coding_word_has_byte (w, '\r'))
+		{
+		  if (coding_word_has_byte (w, '\n'))
+		    eol_seen |= EOL_SEEN_LF;
+		  src += CODING_WORD_SIZE;
+		  continue;
+		}
+	    }
+	  c = *src;
 	  if (c & 0x80)
 	    break;
 	  src++;
@@ -6252,32 +6351,35 @@ check_ascii (struct coding_system *coding)
 }
 
 
-/* Return the number of characters at the source if all the bytes are
-   valid UTF-8 (of Unicode range).  Otherwise, return -1.  By side
-   effects, update coding->eol_seen.  The value of coding->eol_seen is
-   "logical or" of EOL_SEEN_LF, EOL_SEEN_CR, and EOL_SEEN_CRLF, but
-   the value is reliable only when all the source bytes are valid
-   UTF-8.  */
+/* Validate the UTF-8 bytes from SRC up to STOP, looking no further
+   than END (which is the last source byte) for the rest of a multibyte
+   sequence or the LF of CR LF.  Return the EOL_SEEN_XXX bits found,
+   or'ed into EOL_SEEN, or -1 if there is an invalid sequence.  */
 
-static ptrdiff_t
-check_utf_8 (struct coding_system *coding)
+static int
+check_utf_8_range (const unsigned char *src, const unsigned char *stop,
+		   const unsigned char *end, int eol_seen)
 {
-  const unsigned char *src, *end;
-  int eol_seen;
-  ptrdiff_t nchars = coding->head_ascii;
-
-  if (coding->head_ascii < 0)
-    check_ascii (coding);
-  else
-    coding_set_source (coding);
-  src = coding->source + coding->head_ascii;
-  /* We look ahead one byte for CR LF.  */
-  end = coding->source + coding->src_bytes - 1;
-  eol_seen = coding->eol_seen;
-  while (src < end)
+  while (src < stop)
     {
-      int c = *src;
+      int c;
+
+      /* Skip a whole word at once if it is ASCII without CR.  */
+      if (stop - src >= CODING_WORD_SIZE)
+	{
+	  coding_word w = load_coding_word (src);
+
+	  if (! coding_word_nonascii_p (w)
+	      && ! coding_word_has_byte (w, '\r'))
+	    {
+	      if (coding_word_has_byte (w, '\n'))
+		eol_seen |= EOL_SEEN_LF;
+	      src += CODING_WORD_SIZE;
+	      continue;
+	    }
+	}
 
+      c = *src;
       if (UTF_8_1_OCTET_P (*src))
 	{
 	  src++;
@@ -6289,7 +6391,6 @@ check_utf_8 (struct coding_system *coding)
 		    {
 		      eol_seen |= EOL_SEEN_CRLF;
 		      src++;
-		      nchars++;
 		    }
 		  else
 		    eol_seen |= EOL_SEEN_CR;
@@ -6335,21 +6436,201 @@ check_utf_8 (struct coding_system *coding)
 	}
       else
 	return -1;
-      nchars++;
     }
+  return eol_seen;
+}
+
+/* Large sources are checked in chunks of at least this many bytes by
+   up to `coding-decode-threads' threads.  */
+#define UTF_8_CHUNK_MIN_BYTES (1 << 20)
+
+/* The part of a source checked by one thread.  */
+
+struct utf_8_chunk
+{
+  const unsigned char *src, *stop, *end;
+  /* The result of check_utf_8_range, and the number of characters
+     (valid only if the bytes are).  */
+  int eol_seen;
+  ptrdiff_t chars;
+  /* Shared by all the chunks of a source.  */
+  struct utf_8_chunk_job *job;
+};
+
+struct utf_8_chunk_job
+{
+  sys_mutex_t mutex;
+  sys_cond_t done;
+  /* The number of chunks still being checked.  */
+  int pending;
+};
+
+static void
+check_utf_8_chunk (struct utf_8_chunk *chunk)
+{
+  chunk->eol_seen = check_utf_8_range (chunk->src, chunk->stop,
+				       chunk->end, 0);
+  if (chunk->eol_seen >= 0)
+    chunk->chars = utf_8_chars_in_bytes (chunk->src,
+					 chunk->stop - chunk->src);
+}
+
+static void *
+check_utf_8_chunk_thread (void *arg)
+{
+  struct utf_8_chunk *chunk = arg;
+  struct utf_8_chunk_job *job = chunk->job;
+
+  check_utf_8_chunk (chunk);
+  sys_mutex_lock (&job->mutex);
+  if (--job->pending == 0)
+    sys_cond_signal (&job->done);
+  sys_mutex_unlock (&job->mutex);
+  return NULL;
+}
+
+/* Return the number of chunks to split NBYTES bytes into.  */
+
+static int
+utf_8_chunk_count (ptrdiff_t nbytes)
+{
+  EMACS_INT n = min (nbytes / UTF_8_CHUNK_MIN_BYTES, coding_decode_threads);
+  return n < 2 ? 1 : n;
+}
+
+/* Check the UTF-8 bytes from SRC up to STOP (see check_utf_8_range)
+   in NCHUNKS pieces, all but the first in other threads.  Return the
+   EOL_SEEN_XXX bits found, or -1 if the bytes are invalid, and store
+   the number of characters in *CHARS.
+
+   Each piece starts at a byte that can only start a character and
+   does not follow CR, so that no sequence and no CR LF is split
+   between two pieces.  Lisp objects are not touched by the other
+   threads, so this is safe while holding the global lock.  */
+
+static int
+check_utf_8_chunks (const unsigned char *src, const unsigned char *stop,
+		    const unsigned char *end, int nchunks, ptrdiff_t *chars)
+{
+  struct utf_8_chunk_job job;
+  struct utf_8_chunk *chunks;
+  ptrdiff_t size = (stop - src) / nchunks;
+  int i, n, eol_seen = 0;
+  USE_SAFE_ALLOCA;
+
+  SAFE_NALLOCA (chunks, 1, nchunks);
+  for (i = n = 0; i < nchunks && src < stop; i++)
+    {
+      const unsigned char *p = i == nchunks - 1 ? stop : src + size;
+
+      while (p < stop && (UTF_8_EXTRA_OCTET_P (*p) || p[-1] == '\r'))
+	p++;
+      chunks[n].src = src;
+      chunks[n].stop = p;
+      chunks[n].end = end;
+      chunks[n].job = &job;
+      src = p;
+      n++;
+    }
+
+  sys_mutex_init (&job.mutex);
+  sys_cond_init (&job.done);
+  job.pending = n - 1;
+  for (i = 1; i < n; i++)
+    {
+      sys_thread_t thread;
+
+      if (! sys_thread_create (&thread, "utf-8-check",
+			       check_utf_8_chunk_thread, &chunks[i]))
+	{
+	  /* Do it ourselves if there are no threads to be had.  */
+	  check_utf_8_chunk (&chunks[i]);
+	  sys_mutex_lock (&job.mutex);
+	  job.pending--;
+	  sys_mutex_unlock (&job.mutex);
+	}
+    }
+  check_utf_8_chunk (&chunks[0]);
+  sys_mutex_lock (&job.mutex);
+  while (job.pending > 0)
+    sys_cond_wait (&job.done, &job.mutex);
+  sys_mutex_unlock (&job.mutex);
+  sys_cond_destroy (&job.done);
 
-  if (src == end)
+  *chars = 0;
+  for (i = 0; i < n; i++)
     {
-      if (! UTF_8_1_OCTET_P (*src))
+      if (chunks[i].eol_seen < 0)
+	{
+	  eol_seen = -1;
+	  break;
+	}
+      eol_seen |= chunks[i].eol_seen;
+      *chars += chunks[i].chars;
+    }
+  SAFE_FREE ();
+  return eol_seen;
+}
+
+/* Return the number of characters at the source if all the bytes are
+   valid UTF-8 (of Unicode range).  Otherwise, return -1.  By side
+   effects, update coding->eol_seen.  The value of coding->eol_seen is
+   "logical or" of EOL_SEEN_LF, EOL_SEEN_CR, and EOL_SEEN_CRLF, but
+   the value is reliable only when all the source bytes are valid
+   UTF-8.
+
+   The bytes are only validated here; once they are known to be valid
+   UTF-8, the characters are counted a word at a time by
+   utf_8_chars_in_bytes.  A large source is validated and counted in
+   several threads at once by check_utf_8_chunks.  */
+
+static ptrdiff_t
+check_utf_8 (struct coding_system *coding)
+{
+  const unsigned char *src, *end;
+  ptrdiff_t chars UNINIT;
+  int eol_seen, nchunks;
+
+  if (coding->head_ascii < 0)
+    check_ascii (coding);
+  else
+    coding_set_source (coding);
+  src = coding->source + coding->head_ascii;
+  /* We look ahead one byte for CR LF.  */
+  end = coding->source + coding->src_bytes - 1;
+  nchunks = utf_8_chunk_count (end - src);
+  if (nchunks > 1)
+    {
+      eol_seen = check_utf_8_chunks (src, end, end, nchunks, &chars);
+      if (eol_seen < 0)
 	return -1;
-      nchars++;
-      if (*src == '\r')
+      eol_seen |= coding->eol_seen;
+    }
+  else
+    {
+      eol_seen = check_utf_8_range (src, end, end, coding->eol_seen);
+      if (eol_seen < 0)
+	return -1;
+    }
+
+  /* The last byte was not looked at unless it ended a sequence.  */
+  if (src < end && end[-1] == '\r' && *end == '\n')
+    ;
+  else if (src <= end)
+    {
+      if (! UTF_8_1_OCTET_P (*end))
+	return -1;
+      if (*end == '\r')
 	eol_seen |= EOL_SEEN_CR;
-      else if (*src  == '\n')
+      else if (*end  == '\n')
 	eol_seen |= EOL_SEEN_LF;
     }
   coding->eol_seen = eol_seen;
-  return nchars;
+  if (nchunks > 1)
+    return coding->head_ascii + chars + (src <= end);
+  return (coding->head_ascii
+	  + utf_8_chars_in_bytes (coding->source + coding->head_ascii,
+				  coding->src_bytes - coding->head_ascii));
 }
 
 
@@ -8235,6 +8516,55 @@ decode_coding_object (struct coding_system *coding,
 }
 
 
+/* Return true if encoding the NBYTES bytes of text at SRC by CODING
+   would produce the very same bytes, so that the caller can use them
+   as they are instead of calling encode_coding_object.
+   coding->src_multibyte says whether the text is multibyte.
+
+   This is the case for UTF-8 without BOM and EOL conversion when the
+   text has no raw 8-bit bytes: the internal representation of all
+   the other characters is their UTF-8 sequence.  */
+
+bool
+encode_coding_identity_p (struct coding_system *coding,
+			  const unsigned char *src, ptrdiff_t nbytes)
+{
+  Lisp_Object attrs = CODING_ID_ATTRS (coding->id);
+  Lisp_Object eol_type = CODING_ID_EOL_TYPE (coding->id);
+  const unsigned char *end = src + nbytes;
+
+  if (coding->encoder != encode_coding_utf_8
+      || CODING_UTF_8_BOM (coding) == utf_with_bom
+      || ! (inhibit_eol_conversion || VECTORP (eol_type)
+	    || EQ (eol_type, Qunix))
+      || coding->mode & CODING_MODE_SELECTIVE_DISPLAY
+      || CODING_REQUIRE_ANNOTATION (coding)
+      || ! NILP (CODING_ATTR_PRE_WRITE (attrs))
+      || ! NILP (get_translation_table (attrs, 1, NULL)))
+    return false;
+
+  /* In unibyte text every byte is written as is.  */
+  if (! coding->src_multibyte)
+    return true;
+
+  /* Raw 8-bit bytes are the only characters whose internal
+     representation starts with 0xC0 or 0xC1.  */
+  for (; end - src >= CODING_WORD_SIZE; src += CODING_WORD_SIZE)
+    {
+      coding_word w = load_coding_word (src);
+
+      if (coding_word_nonascii_p (w)
+	  && (coding_word_has_byte (w, 0xC0)
+	      || coding_word_has_byte (w, 0xC1)))
+	return false;
+    }
+  for (; src < end; src++)
+    if (CHAR_BYTE8_HEAD_P (*src))
+      return false;
+  return true;
+}
+
+
 void
 encode_coding_object (struct coding_system *coding,
 		      Lisp_Object src_object,
@@ -9427,7 +9757,19 @@ code_convert_string (Lisp_Object string, Lisp_Object coding_system,
     }
 
   if (encodep)
-    encode_coding_object (&coding, string, 0, 0, chars, bytes, dst_object);
+    {
+      coding.src_multibyte = STRING_MULTIBYTE (string);
+      if (EQ (dst_object, Qt)
+	  && encode_coding_identity_p (&coding, SDATA (string), bytes))
+	{
+	  coding.dst_object = make_unibyte_string (SSDATA (string), bytes);
+	  coding.produced = bytes;
+	  coding.produced_char = chars;
+	}
+      else
+	encode_coding_object (&coding, string, 0, 0, chars, bytes,
+			      dst_object);
+    }
   else
     decode_coding_object (&coding, string, 0, 0, chars, bytes, dst_object);
   if (! norecord)
@@ -11173,6 +11515,14 @@ decode text as usual.  */);
 Internal use only.  Remove after the experimental optimizer becomes stable.  */);
   disable_ascii_optimization = 0;
 
+  DEFVAR_INT ("coding-decode-threads", coding_decode_threads,
+	      doc: /* Maximum number of threads used to check large UTF-8 text.
+When text read by `insert-file-contents' is at least a megabyte of
+UTF-8, it is validated and its characters are counted in pieces of at
+least a megabyte, each in its own thread.  A value of 1 or less makes
+this happen in a single thread.  */);
+  coding_decode_threads = 4;
+
   DEFVAR_LISP ("translation-table-for-input", Vtranslation_table_for_input,
 	       doc: /* Char table for translating self-inserting characters.
 This is applied to the result of input methods, not their input.
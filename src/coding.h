@@ -700,6 +700,8 @@ extern void decode_coding_object (struct coding_system *,
 extern void encode_coding_object (struct coding_system *,
                                   Lisp_Object, ptrdiff_t, ptrdiff_t,
 				  ptrdiff_t, ptrdiff_t, Lisp_Object);
+extern bool encode_coding_identity_p (struct coding_system *,
+				      const unsigned char *, ptrdiff_t);
 
 /* Defined in this file.  */
 INLINE int surrogates_to_codepoint (int, int);
@@ -24,6 +24,8 @@ along with GNU Emacs.  If not, see <https://www.gnu.org/licenses/>.  */
 
 #include <config.h>
 
+#include <stdlib.h>
+
 #include "lisp.h"
 #include "character.h"
 #include "composite.h"
@@ -33,6 +35,7 @@ along with GNU Emacs.  If not, see <https://www.gnu.org/licenses/>.  */
 #include "frame.h"
 #include "dispextern.h"
 #include "termhooks.h"
+#include "blockinput.h"
 
 
 /* Emacs uses special text property `composition' to support character
@@ -616,19 +619,83 @@ make_composition_value_copy (Lisp_Object list)
 
 /* Hash table for automatic composition.  The key is a header of a
    lgstring (Lispy glyph-string), and the value is a body of a
-   lgstring.  */
+   lgstring.  The table is shared by all windows and frames, so text
+   shaped once is not shaped again as long as the entry stays in the
+   cache.  */
 
 static Lisp_Object gstring_hash_table;
 
+/* Least-recently-used bookkeeping for gstring_hash_table.  Element I
+   of gstring_cache_ticks is the value of gstring_cache_clock when the
+   I-th entry of the hash table was last looked up, stored, or
+   displayed.  gstring_cache_bytes is an estimate of the memory used
+   by all the cached glyph-strings; it is compared against
+   `composition-cache-limit' by composition_gstring_cache_compact.  */
+
+static EMACS_UINT *gstring_cache_ticks;
+static ptrdiff_t gstring_cache_ticks_size;
+static EMACS_UINT gstring_cache_clock;
+static EMACS_INT gstring_cache_bytes;
+
+/* Counters reported by `composition-cache-statistics'.  A hit is a
+   glyph-string found in the cache, i.e. a call to the shaping engine
+   that was avoided.  */
+
+static EMACS_INT gstring_cache_hits;
+static EMACS_INT gstring_cache_misses;
+static EMACS_INT gstring_cache_evictions;
+
 static Lisp_Object gstring_lookup_cache (Lisp_Object);
 
+/* Record that the I-th entry of gstring_hash_table has just been
+   used.  */
+
+static void
+gstring_cache_touch (ptrdiff_t i)
+{
+  if (gstring_cache_ticks_size <= i)
+    {
+      ptrdiff_t old_size = gstring_cache_ticks_size;
+      gstring_cache_ticks
+	= xpalloc (gstring_cache_ticks, &gstring_cache_ticks_size,
+		   i + 1 - old_size, -1, sizeof *gstring_cache_ticks);
+      memset (gstring_cache_ticks + old_size, 0,
+	      ((gstring_cache_ticks_size - old_size)
+	       * sizeof *gstring_cache_ticks));
+    }
+  gstring_cache_ticks[i] = ++gstring_cache_clock;
+}
+
+/* Return the approximate number of bytes used by the cached
+   glyph-string GSTRING, including its header and glyphs.  */
+
+static EMACS_INT
+gstring_cache_entry_bytes (Lisp_Object gstring)
+{
+  ptrdiff_t i, len = LGSTRING_GLYPH_LEN (gstring);
+  EMACS_INT nbytes = (header_size + ASIZE (gstring) * word_size
+		      + header_size
+		      + ASIZE (LGSTRING_HEADER (gstring)) * word_size);
+
+  for (i = 0; i < len && !NILP (LGSTRING_GLYPH (gstring, i)); i++)
+    nbytes += header_size + LGLYPH_SIZE * word_size;
+  return nbytes;
+}
+
 static Lisp_Object
 gstring_lookup_cache (Lisp_Object header)
 {
   struct Lisp_Hash_Table *h = XHASH_TABLE (gstring_hash_table);
   ptrdiff_t i = hash_lookup (h, header, NULL);
 
-  return (i >= 0 ? HASH_VALUE (h, i) : Qnil);
+  if (i < 0)
+    {
+      gstring_cache_misses++;
+      return Qnil;
+    }
+  gstring_cache_hits++;
+  gstring_cache_touch (i);
+  return HASH_VALUE (h, i);
 }
 
 Lisp_Object
@@ -656,6 +723,8 @@ composition_gstring_put_cache (Lisp_Object gstring, ptrdiff_t len)
     LGSTRING_SET_GLYPH (copy, i, Fcopy_sequence (LGSTRING_GLYPH (gstring, i)));
   i = hash_put (h, LGSTRING_HEADER (copy), copy, hash);
   LGSTRING_SET_ID (copy, make_number (i));
+  gstring_cache_touch (i);
+  gstring_cache_bytes += gstring_cache_entry_bytes (copy);
   return copy;
 }
 
@@ -664,9 +733,127 @@ composition_gstring_from_id (ptrdiff_t id)
 {
   struct Lisp_Hash_Table *h = XHASH_TABLE (gstring_hash_table);
 
+  gstring_cache_touch (id);
   return HASH_VALUE (h, id);
 }
 
+/* Compare the ticks of the gstring_hash_table entries whose indices
+   are pointed to by A and B, for sorting the least recently used
+   entry first.  */
+
+static int
+compare_gstring_cache_ticks (const void *a, const void *b)
+{
+  EMACS_UINT ta = gstring_cache_ticks[*(const ptrdiff_t *) a];
+  EMACS_UINT tb = gstring_cache_ticks[*(const ptrdiff_t *) b];
+
+  return ta < tb ? -1 : ta > tb;
+}
+
+/* Set the elements of IN_USE, which has room for SIZE, whose indices
+   are the ids of the automatic compositions that the glyphs of
+   MATRIX show.  */
+
+static void
+gstring_cache_mark_matrix (struct glyph_matrix *matrix, bool *in_use,
+			   ptrdiff_t size)
+{
+  for (int i = 0; i < matrix->nrows; i++)
+    {
+      struct glyph_row *row = MATRIX_ROW (matrix, i);
+      for (int area = LEFT_MARGIN_AREA; area < LAST_AREA; area++)
+	{
+	  struct glyph *glyph = row->glyphs[area];
+	  struct glyph *end = glyph + row->used[area];
+	  for (; glyph < end; glyph++)
+	    if (glyph->type == COMPOSITE_GLYPH && glyph->u.cmp.automatic
+		&& glyph->u.cmp.id < size)
+	      in_use[glyph->u.cmp.id] = true;
+	}
+    }
+}
+
+/* Like gstring_cache_mark_matrix, for the current matrices of WINDOW,
+   its subwindows and the windows after it.  */
+
+static void
+gstring_cache_mark_windows (Lisp_Object window, bool *in_use, ptrdiff_t size)
+{
+  for (; !NILP (window); window = XWINDOW (window)->next)
+    {
+      struct window *w = XWINDOW (window);
+      if (WINDOWP (w->contents))
+	gstring_cache_mark_windows (w->contents, in_use, size);
+      else if (w->current_matrix)
+	gstring_cache_mark_matrix (w->current_matrix, in_use, size);
+    }
+}
+
+/* If the glyph-string cache uses more memory than
+   `composition-cache-limit', remove the least recently used entries
+   until it is back below three quarters of the limit.
+
+   Glyph rows refer to cached glyph-strings by their index in the hash
+   table, and an index may be reused by the next entry stored.  So the
+   glyph-strings that the current matrices of the frames show are
+   kept, which leaves the cache over the limit if they alone exceed
+   it.  This is called from redisplay_internal once the frames are up
+   to date, when the desired matrices are no longer needed.  */
+
+void
+composition_gstring_cache_compact (void)
+{
+  struct Lisp_Hash_Table *h = XHASH_TABLE (gstring_hash_table);
+  ptrdiff_t *order, i, n, size = HASH_TABLE_SIZE (h);
+  bool *in_use;
+  EMACS_INT target;
+  Lisp_Object tail, frame;
+  USE_SAFE_ALLOCA;
+
+  if (! RANGED_INTEGERP (1, Vcomposition_cache_limit, EMACS_INT_MAX)
+      || gstring_cache_bytes <= XINT (Vcomposition_cache_limit))
+    return;
+  target = XINT (Vcomposition_cache_limit) / 4 * 3;
+
+  SAFE_NALLOCA (in_use, 1, size);
+  memset (in_use, 0, size * sizeof *in_use);
+  FOR_EACH_FRAME (tail, frame)
+    {
+      struct frame *f = XFRAME (frame);
+      if (f->current_matrix)
+	gstring_cache_mark_matrix (f->current_matrix, in_use, size);
+#if defined (HAVE_WINDOW_SYSTEM) && ! defined (USE_GTK) && ! defined (HAVE_NS)
+      if (WINDOWP (f->tool_bar_window)
+	  && XWINDOW (f->tool_bar_window)->current_matrix)
+	gstring_cache_mark_matrix (XWINDOW (f->tool_bar_window)->current_matrix,
+				   in_use, size);
+#endif
+      if (WINDOWP (f->root_window))
+	gstring_cache_mark_windows (f->root_window, in_use, size);
+    }
+
+  SAFE_NALLOCA (order, 1, h->count);
+  for (i = n = 0; i < size; i++)
+    if (!NILP (HASH_HASH (h, i)) && !in_use[i])
+      order[n++] = i;
+  qsort (order, n, sizeof *order, compare_gstring_cache_ticks);
+
+  for (i = 0; i < n && gstring_cache_bytes > target; i++)
+    {
+      Lisp_Object gstring = HASH_VALUE (h, order[i]);
+
+      gstring_cache_bytes -= gstring_cache_entry_bytes (gstring);
+      /* Lisp code may still hold the glyph-string; make sure it is
+	 not taken for a cached one any more.  */
+      LGSTRING_SET_ID (gstring, Qnil);
+      hash_remove_from_table (h, HASH_KEY (h, order[i]));
+      gstring_cache_evictions++;
+    }
+  if (gstring_cache_bytes < 0)
+    gstring_cache_bytes = 0;
+  SAFE_FREE ();
+}
+
 DEFUN ("clear-composition-cache", Fclear_composition_cache,
        Sclear_composition_cache, 0, 0, 0,
        doc: /* Internal use only.
@@ -675,12 +862,39 @@ Clear composition cache.  */)
 {
   Lisp_Object args[] = {QCtest, Qequal, QCsize, make_number (311)};
   gstring_hash_table = CALLMANY (Fmake_hash_table, args);
+  gstring_cache_bytes = 0;
+  xfree (gstring_cache_ticks);
+  gstring_cache_ticks = NULL;
+  gstring_cache_ticks_size = 0;
+  gstring_cache_clock = 0;
   /* Fixme: We call Fclear_face_cache to force complete re-building of
      display glyphs.  But, it may be better to call this function from
      Fclear_face_cache instead.  */
   return Fclear_face_cache (Qt);
 }
 
+DEFUN ("composition-cache-statistics", Fcomposition_cache_statistics,
+       Scomposition_cache_statistics, 0, 0, 0,
+       doc: /* Return statistics about the glyph-string cache.
+The value is an alist of the following elements:
+
+  (hits . N)       number of glyph-strings found in the cache, i.e.
+                   shaping calls that were avoided,
+  (misses . N)     number of lookups that had to shape the text,
+  (evictions . N)  number of entries removed to honor
+                   `composition-cache-limit',
+  (entries . N)    number of glyph-strings currently cached,
+  (bytes . N)      approximate memory used by the cached glyph-strings.  */)
+  (void)
+{
+  return list5 (Fcons (Qhits, make_number (gstring_cache_hits)),
+		Fcons (Qmisses, make_number (gstring_cache_misses)),
+		Fcons (Qevictions, make_number (gstring_cache_evictions)),
+		Fcons (Qentries,
+		       make_number (XHASH_TABLE (gstring_hash_table)->count)),
+		Fcons (Qbytes, make_number (gstring_cache_bytes)));
+}
+
 bool
 composition_gstring_p (Lisp_Object gstring)
 {
@@ -1954,8 +2168,24 @@ GSTRING, or modify GSTRING itself and return it.
 See also the documentation of `auto-composition-mode'.  */);
   Vcomposition_function_table = Fmake_char_table (Qnil, Qnil);
 
+  DEFVAR_LISP ("composition-cache-limit", Vcomposition_cache_limit,
+	       doc: /* Approximate maximum size in bytes of the glyph-string cache.
+Glyph-strings produced by shaping text for automatic composition are
+cached, so that the same text displayed with the same font is not
+shaped again.  When the cache grows larger than this, the least
+recently used glyph-strings are discarded at the end of redisplay.
+A value of nil means no limit.  */);
+  Vcomposition_cache_limit = make_number (8 * 1024 * 1024);
+
+  DEFSYM (Qhits, "hits");
+  DEFSYM (Qmisses, "misses");
+  DEFSYM (Qevictions, "evictions");
+  DEFSYM (Qentries, "entries");
+  DEFSYM (Qbytes, "bytes");
+
   defsubr (&Scompose_region_internal);
   defsubr (&Sfind_composition_internal);
   defsubr (&Scomposition_get_gstring);
   defsubr (&Sclear_composition_cache);
+  defsubr (&Scomposition_cache_statistics);
 }
@@ -41,6 +41,10 @@ extern bool OBJFWDP (union Lisp_Fwd *a);
 
 _Noreturn void wrong_range (Lisp_Object, Lisp_Object, Lisp_Object);
 
+/* Advanced whenever a symbol's function cell changes, and by each
+   garbage collection.  */
+EMACS_UINT symbol_function_epoch;
+
 static void
 set_blv_found (struct Lisp_Buffer_Local_Value *blv, int found)
 {
@@ -24,10 +24,12 @@ along with GNU Emacs.  If not, see <https://www.gnu.org/licenses/>.  */
 #include <errno.h>
 #include <sys/types.h>
 #include <sys/file.h>	/* Must be after sys/types.h for USG.  */
+#include <sys/stat.h>
 #include <fcntl.h>
 #include <unistd.h>
 
 #include <c-ctype.h>
+#include <stat-time.h>
 
 #include "lisp.h"
 #include "character.h"
@@ -36,6 +38,7 @@ along with GNU Emacs.  If not, see <https://www.gnu.org/licenses/>.  */
 #include "disptab.h"
 #include "intervals.h"
 #include "keymap.h"
+#include "systime.h"
 
 /* Buffer used for reading from documentation file.  */
 static char *get_doc_string_buffer;
@@ -45,6 +48,112 @@ static unsigned char *read_bytecode_pointer;
 
 static char const sibling_etc[] = "../etc/";
 
+/* The contents of the compiled files whose doc strings and function
+   definitions were fetched most recently, most recent first.  This
+   way, the lazily loaded parts of a file are read from disk only once,
+   instead of by a separate open, seek and read each.  */
+struct doc_file_cache_entry
+{
+  /* The file name, or null if the entry is unused.  */
+  char *name;
+
+  /* The file's modification time and size when it was read.  If they
+     change, the file is read afresh.  */
+  struct timespec mtime;
+  off_t size;
+
+  char *contents;
+};
+
+enum
+  {
+    DOC_FILE_CACHE_ENTRIES = 4,
+    /* Larger files are read a block at a time, as before.  */
+    DOC_FILE_CACHE_MAX_SIZE = 2 * 1024 * 1024
+  };
+
+static struct doc_file_cache_entry doc_file_cache[DOC_FILE_CACHE_ENTRIES];
+
+static void
+doc_file_cache_free (struct doc_file_cache_entry *entry)
+{
+  xfree (entry->name);
+  xfree (entry->contents);
+  entry->name = entry->contents = NULL;
+}
+
+/* Return the contents of file NAME, and store its size in *SIZE.
+   Use the cached contents if the file has not changed since they were
+   read.  Return null if the file cannot be opened or is too large to
+   cache.  */
+
+static char *
+doc_file_contents (char const *name, ptrdiff_t *size)
+{
+  struct stat st;
+  int i;
+
+  if (stat (name, &st) != 0
+      || ! S_ISREG (st.st_mode) || DOC_FILE_CACHE_MAX_SIZE < st.st_size)
+    return NULL;
+
+  for (i = 0; i < DOC_FILE_CACHE_ENTRIES - 1; i++)
+    if (doc_file_cache[i].name && !strcmp (doc_file_cache[i].name, name))
+      break;
+
+  /* Move the entry found, or the least recently used one, to the
+     front.  */
+  struct doc_file_cache_entry entry = doc_file_cache[i];
+  memmove (doc_file_cache + 1, doc_file_cache, i * sizeof *doc_file_cache);
+  doc_file_cache[0] = entry;
+
+  if (entry.name && !strcmp (entry.name, name)
+      && entry.size == st.st_size
+      && timespec_cmp (entry.mtime, get_stat_mtime (&st)) == 0)
+    {
+      *size = entry.size;
+      return entry.contents;
+    }
+
+  doc_file_cache_free (&doc_file_cache[0]);
+
+  int fd = emacs_open (name, O_RDONLY, 0);
+  if (fd < 0)
+    return NULL;
+  ptrdiff_t count = SPECPDL_INDEX ();
+  record_unwind_protect_int (close_file_unwind, fd);
+  if (fstat (fd, &st) != 0
+      || ! S_ISREG (st.st_mode) || DOC_FILE_CACHE_MAX_SIZE < st.st_size)
+    {
+      unbind_to (count, Qnil);
+      return NULL;
+    }
+
+  char *contents = xmalloc (st.st_size);
+  record_unwind_protect_ptr (xfree, contents);
+  ptrdiff_t nread = 0;
+  while (nread < st.st_size)
+    {
+      ptrdiff_t n = emacs_read_quit (fd, contents + nread,
+				     st.st_size - nread);
+      if (n < 0)
+	report_file_error ("Read error on documentation file",
+			   build_string (name));
+      if (n == 0)
+	break;
+      nread += n;
+    }
+  clear_unwind_protect (count + 1);
+  unbind_to (count, Qnil);
+
+  doc_file_cache[0].name = xstrdup (name);
+  doc_file_cache[0].mtime = get_stat_mtime (&st);
+  doc_file_cache[0].size = nread;
+  doc_file_cache[0].contents = contents;
+  *size = nread;
+  return contents;
+}
+
 /* `readchar' in lread.c calls back here to fetch the next byte.
    If UNREADFLAG is 1, we unread a byte.  */
 
@@ -104,6 +213,10 @@ get_doc_string (Lisp_Object filepos, bool unibyte, bool definition)
 
   position = eabs (XINT (pos));
 
+  /* Make sure we read at least 1024 bytes before `position'
+     so we can check the leading text for consistency.  */
+  offset = min (position, max (1024, position % (8 * 1024)));
+
   if (!STRINGP (Vdoc_directory))
     return Qnil;
 
@@ -124,6 +237,31 @@ get_doc_string (Lisp_Object filepos, bool unibyte, bool definition)
   name = SAFE_ALLOCA (docdir_sizemax + SBYTES (file));
   lispstpcpy (lispstpcpy (name, docdir), file);
 
+  /* A compiled file's doc strings and function definitions are read
+     from its cached contents.  */
+  if (CONSP (filepos))
+    {
+      ptrdiff_t size;
+      char *contents = doc_file_contents (name, &size);
+      if (contents)
+	{
+	  SAFE_FREE ();
+	  if (size < position)
+	    return Qnil;
+	  char *end = memchr (contents + position, '\037', size - position);
+	  ptrdiff_t len = ((end ? end : contents + size)
+			   - (contents + position - offset));
+	  if (get_doc_string_buffer_size <= len)
+	    get_doc_string_buffer
+	      = xpalloc (get_doc_string_buffer, &get_doc_string_buffer_size,
+			 len + 1 - get_doc_string_buffer_size, -1, 1);
+	  memcpy (get_doc_string_buffer, contents + position - offset, len);
+	  p = get_doc_string_buffer + len;
+	  *p = 0;
+	  goto check;
+	}
+    }
+
   fd = emacs_open (name, O_RDONLY, 0);
   if (fd < 0)
     {
@@ -152,9 +290,6 @@ get_doc_string (Lisp_Object filepos, bool unibyte, bool definition)
   record_unwind_protect_int (close_file_unwind, fd);
 
   /* Seek only to beginning of disk block.  */
-  /* Make sure we read at least 1024 bytes before `position'
-     so we can check the leading text for consistency.  */
-  offset = min (position, max (1024, position % (8 * 1024)));
   if (TYPE_MAXIMUM (off_t) < position
       || lseek (fd, position - offset, 0) < 0)
     error ("Position %"pI"d out of range in doc string file \"%s\"",
@@ -207,6 +342,7 @@ get_doc_string (Lisp_Object filepos, bool unibyte, bool definition)
   unbind_to (count, Qnil);
   SAFE_FREE ();
 
+ check:
   /* Sanity checking.  */
   if (CONSP (filepos))
     {
@@ -484,42 +484,54 @@ at POSITION.  */)
 }
 
 
-/* Restore saved buffer before leaving `save-excursion' special form.  */
+/* Save current buffer state for `save-excursion' special form
+   in the specpdl entry PDL.  */
 
 void
-save_excursion_restore (Lisp_Object info)
+save_excursion_save (union specbinding *pdl)
 {
-  Lisp_Object tem, tem1;
+  eassert (pdl->unwind_excursion.kind == SPECPDL_UNWIND_EXCURSION);
+  pdl->unwind_excursion.marker = Fpoint_marker ();
+  /* Selected window if current buffer is shown in it, nil otherwise.  */
+  pdl->unwind_excursion.window
+    = (EQ (XWINDOW (selected_window)->contents, Fcurrent_buffer ())
+       ? selected_window : Qnil);
+}
+
+/* Restore saved buffer before leaving `save-excursion' special form.
+   MARKER is the saved point and WINDOW the saved window.  */
 
-  tem = Fmarker_buffer (XSAVE_OBJECT (info, 0));
+void
+save_excursion_restore (Lisp_Object marker, Lisp_Object window)
+{
+  Lisp_Object buffer = Fmarker_buffer (marker);
   /* If we're unwinding to top level, saved buffer may be deleted.  This
-     means that all of its markers are unchained and so tem is nil.  */
-  if (NILP (tem))
+     means that all of its markers are unchained and so BUFFER is nil.  */
+  if (NILP (buffer))
     goto out;
 
-  Fset_buffer (tem);
+  Fset_buffer (buffer);
 
   /* Point marker.  */
-  tem = XSAVE_OBJECT (info, 0);
-  Fgoto_char (tem);
-  unchain_marker (XMARKER (tem));
+  Fgoto_char (marker);
+  unchain_marker (XMARKER (marker));
 
   /* If buffer was visible in a window, and a different window was
      selected, and the old selected window is still showing this
      buffer, restore point in that window.  */
-  tem = XSAVE_OBJECT (info, 2);
-  if (WINDOWP (tem)
-      && !EQ (tem, selected_window)
-      && (tem1 = XWINDOW (tem)->contents,
-	  (/* Window is live...  */
-	   BUFFERP (tem1)
-	   /* ...and it shows the current buffer.  */
-	   && XBUFFER (tem1) == current_buffer)))
-    Fset_window_point (tem, make_number (PT));
+  if (WINDOWP (window) && !EQ (window, selected_window))
+    {
+      /* Set window point if WINDOW is live and shows the current buffer.  */
+      Lisp_Object contents = XWINDOW (window)->contents;
+      if (BUFFERP (contents) && XBUFFER (contents) == current_buffer)
+	Fset_window_point (window, make_number (PT));
+    }
 
  out:
 
-  free_misc (info);
+  /* Nothing but the specpdl entry refers to the marker, so it can be
+     freed without waiting for the next garbage collection.  */
+  free_misc (marker);
 }
 
 DEFUN ("user-login-name", Fuser_login_name, Suser_login_name, 0, 1, 0,
@@ -1695,7 +1707,7 @@ buffer stay intact.  */)
 
   Fundo_boundary ();
   ptrdiff_t count = SPECPDL_INDEX ();
-  record_unwind_protect (save_excursion_restore, save_excursion_save ());
+  record_unwind_protect_excursion ();
 
   ptrdiff_t i = size_a;
   ptrdiff_t j = size_b;
@@ -1172,6 +1172,30 @@ error (const char *m, ...)
   verror (m, ap);
 }
 
+/* Enlarge the specpdl stack once it has filled up.  This is kept out
+   of line so that the common case in grow_specpdl stays small.  */
+
+static NO_INLINE void
+grow_specpdl_allocation (void)
+{
+  ptrdiff_t count = SPECPDL_INDEX ();
+  ptrdiff_t max_size = min (max_specpdl_size, PTRDIFF_MAX - 1000);
+  union specbinding *pdlvec = specpdl - 1;
+  ptrdiff_t pdlvecsize = specpdl_size + 1;
+  if (max_size <= specpdl_size)
+    {
+      if (max_specpdl_size < 400)
+	max_size = max_specpdl_size = 400;
+      if (max_size <= specpdl_size)
+	signal_error ("Variable binding depth exceeds max-specpdl-size",
+		      Qnil);
+    }
+  pdlvec = xpalloc (pdlvec, &pdlvecsize, 1, max_size + 1, sizeof *specpdl);
+  specpdl = pdlvec + 1;
+  specpdl_size = pdlvecsize - 1;
+  specpdl_ptr = specpdl + count;
+}
+
 /* Grow the specpdl stack by one entry.
    The caller should have already initialized the entry.
    Signal an error on stack overflow.
@@ -1186,26 +1210,8 @@ void
 grow_specpdl (void)
 {
   specpdl_ptr++;
-
   if (specpdl_ptr == specpdl + specpdl_size)
-    {
-      ptrdiff_t count = SPECPDL_INDEX ();
-      ptrdiff_t max_size = min (max_specpdl_size, PTRDIFF_MAX - 1000);
-      union specbinding *pdlvec = specpdl - 1;
-      ptrdiff_t pdlvecsize = specpdl_size + 1;
-      if (max_size <= specpdl_size)
-	{
-	  if (max_specpdl_size < 400)
-	    max_size = max_specpdl_size = 400;
-	  if (max_size <= specpdl_size)
-	    signal_error ("Variable binding depth exceeds max-specpdl-size",
-			  Qnil);
-	}
-      pdlvec = xpalloc (pdlvec, &pdlvecsize, 1, max_size + 1, sizeof *specpdl);
-      specpdl = pdlvec + 1;
-      specpdl_size = pdlvecsize - 1;
-      specpdl_ptr = specpdl + count;
-    }
+    grow_specpdl_allocation ();
 }
 
 ptrdiff_t
@@ -1512,6 +1518,23 @@ usage: (apply FUNCTION &rest ARGUMENTS)  */)
 
 /* Run hook variables in various ways.  */
 
+/* Call FUNCALL on the NARGS elements of ARGS, where ARGS[0] is a
+   function on the hook HOOK, in a timing span if spans are being
+   recorded.  */
+
+static Lisp_Object
+run_hook_function (Lisp_Object hook, ptrdiff_t nargs, Lisp_Object *args,
+		   Lisp_Object (*funcall) (ptrdiff_t nargs, Lisp_Object *args))
+{
+  if (!profiler_spans_running)
+    return funcall (nargs, args);
+
+  ptrdiff_t count = SPECPDL_INDEX ();
+  record_unwind_protect_int (profiler_span_end,
+			     profiler_span_begin (SPAN_HOOK, hook, args[0]));
+  return unbind_to (count, funcall (nargs, args));
+}
+
 /* ARGS[0] should be a hook symbol.
    Call each of the functions in the hook value, passing each of them
    as arguments all the rest of ARGS (all NARGS - 1 elements).
@@ -1536,7 +1559,7 @@ run_hook_with_args (ptrdiff_t nargs, Lisp_Object *args,
   else if (!CONSP (val) || FUNCTIONP (val))
     {
       args[0] = val;
-      return funcall (nargs, args);
+      return run_hook_function (sym, nargs, args, funcall);
     }
   else
     {
@@ -1556,7 +1579,7 @@ run_hook_with_args (ptrdiff_t nargs, Lisp_Object *args,
 	      if (!CONSP (global_vals) || EQ (XCAR (global_vals), Qlambda))
 		{
 		  args[0] = global_vals;
-		  ret = funcall (nargs, args);
+		  ret = run_hook_function (sym, nargs, args, funcall);
 		}
 	      else
 		{
@@ -1568,14 +1591,14 @@ run_hook_with_args (ptrdiff_t nargs, Lisp_Object *args,
 		      /* In a global value, t should not occur.  If it does, we
 			 must ignore it to avoid an endless loop.  */
 		      if (!EQ (args[0], Qt))
-			ret = funcall (nargs, args);
+			ret = run_hook_function (sym, nargs, args, funcall);
 		    }
 		}
 	    }
 	  else
 	    {
 	      args[0] = XCAR (val);
-	      ret = funcall (nargs, args);
+	      ret = run_hook_function (sym, nargs, args, funcall);
 	    }
 	}
 
@@ -2058,7 +2081,14 @@ DEFUN ("fetch-bytecode", Ffetch_bytecode, Sfetch_bytecode,
 	xsignal1 (Qinvalid_function, object);
       if (CONSP (AREF (object, COMPILED_BYTECODE)))
 	{
-	  tem = read_doc_string (AREF (object, COMPILED_BYTECODE));
+	  tem = AREF (object, COMPILED_BYTECODE);
+	  /* A negative position is that of a body in a binary compiled
+	     file.  */
+	  if (INTEGERP (XCDR (tem)) && XINT (XCDR (tem)) < 0)
+	    tem = read_binary_definition (tem,
+					  AREF (object, COMPILED_CONSTANTS));
+	  else
+	    tem = read_doc_string (tem);
 	  if (!CONSP (tem))
 	    {
 	      tem = AREF (object, COMPILED_BYTECODE);
@@ -2159,7 +2189,10 @@ specbind (Lisp_Object symbol, Lisp_Object value)
       specpdl_ptr->let.old_value = SYMBOL_VAL (sym);
       specpdl_ptr->let.saved_value = Qnil;
       grow_specpdl ();
-      do_specbind (sym, specpdl_ptr - 1, value, SET_INTERNAL_BIND);
+      if (!sym->u.s.trapped_write)
+	SET_SYMBOL_VAL (sym, value);
+      else
+	do_specbind (sym, specpdl_ptr - 1, value, SET_INTERNAL_BIND);
       break;
     case SYMBOL_LOCALIZED:
     case SYMBOL_FORWARDED:
@@ -2244,6 +2277,13 @@ do_one_unbind (union specbinding *this_binding, bool unwinding,
     case SPECPDL_UNWIND_VOID:
       this_binding->unwind_void.func ();
       break;
+    case SPECPDL_UNWIND_EXCURSION:
+      save_excursion_restore (this_binding->unwind_excursion.marker,
+			      this_binding->unwind_excursion.window);
+      break;
+    case SPECPDL_UNWIND_BUFFER:
+      set_buffer_if_live (this_binding->unwind_buffer.buffer);
+      break;
     case SPECPDL_BACKTRACE:
       break;
     case SPECPDL_LET:
@@ -2288,6 +2328,31 @@ static void
 do_nothing (void)
 {}
 
+/* Push an unwind-protect entry that saves the current buffer, point
+   and the window showing it, and restores them when unwound, like
+   `save-excursion'.  This needs no separate object to hold them.  */
+
+void
+record_unwind_protect_excursion (void)
+{
+  specpdl_ptr->unwind_excursion.kind = SPECPDL_UNWIND_EXCURSION;
+  save_excursion_save (specpdl_ptr);
+  grow_specpdl ();
+}
+
+/* Arrange to go back to the original buffer after the next
+   call to unbind_to if the original buffer is still alive.  Like
+   record_unwind_protect (set_buffer_if_live, ...), but unwinding
+   it needs no indirect call.  */
+
+void
+record_unwind_current_buffer (void)
+{
+  specpdl_ptr->unwind_buffer.kind = SPECPDL_UNWIND_BUFFER;
+  XSETBUFFER (specpdl_ptr->unwind_buffer.buffer, current_buffer);
+  grow_specpdl ();
+}
+
 /* Push an unwind-protect entry that does nothing, so that
    set_unwind_protect_ptr can overwrite it later.  */
 
@@ -2482,14 +2547,29 @@ backtrace_eval_unrewind (int distance)
 	    Lisp_Object oldarg = tmp->unwind.arg;
 	    if (tmp->unwind.func == set_buffer_if_live)
 	      tmp->unwind.arg = Fcurrent_buffer ();
-	    else if (tmp->unwind.func == save_excursion_restore)
-	      tmp->unwind.arg = save_excursion_save ();
 	    else
 	      break;
 	    tmp->unwind.func (oldarg);
 	    break;
 	  }
 
+	case SPECPDL_UNWIND_EXCURSION:
+	  {
+	    Lisp_Object marker = tmp->unwind_excursion.marker;
+	    Lisp_Object window = tmp->unwind_excursion.window;
+	    save_excursion_save (tmp);
+	    save_excursion_restore (marker, window);
+	  }
+	  break;
+
+	case SPECPDL_UNWIND_BUFFER:
+	  {
+	    Lisp_Object oldarg = tmp->unwind_buffer.buffer;
+	    XSETBUFFER (tmp->unwind_buffer.buffer, current_buffer);
+	    set_buffer_if_live (oldarg);
+	  }
+	  break;
+
 	case SPECPDL_UNWIND_PTR:
 	case SPECPDL_UNWIND_INT:
 	case SPECPDL_UNWIND_VOID:
@@ -2625,6 +2705,8 @@ NFRAMES and BASE specify the activation frame to use, as in `backtrace-frame'.
 	  case SPECPDL_UNWIND_PTR:
 	  case SPECPDL_UNWIND_INT:
 	  case SPECPDL_UNWIND_VOID:
+	  case SPECPDL_UNWIND_EXCURSION:
+	  case SPECPDL_UNWIND_BUFFER:
 	  case SPECPDL_BACKTRACE:
 	    break;
 
@@ -2653,6 +2735,15 @@ mark_specpdl (union specbinding *first, union specbinding *ptr)
 	  mark_object (specpdl_arg (pdl));
 	  break;
 
+	case SPECPDL_UNWIND_EXCURSION:
+	  mark_object (pdl->unwind_excursion.marker);
+	  mark_object (pdl->unwind_excursion.window);
+	  break;
+
+	case SPECPDL_UNWIND_BUFFER:
+	  mark_object (pdl->unwind_buffer.buffer);
+	  break;
+
 	case SPECPDL_BACKTRACE:
 	  {
 	    ptrdiff_t nargs = backtrace_nargs (pdl);
@@ -2685,11 +2776,14 @@ mark_specpdl (union specbinding *first, union specbinding *ptr)
     }
 }
 
+/* Copy the functions of the current backtrace into ARRAY, from index
+   START on, padding with nil.  */
+
 void
-get_backtrace (Lisp_Object array)
+get_backtrace (Lisp_Object array, ptrdiff_t start)
 {
   union specbinding *pdl = backtrace_next (backtrace_top ());
-  ptrdiff_t i = 0, asize = ASIZE (array);
+  ptrdiff_t i = start, asize = ASIZE (array);
 
   /* Copy the backtrace contents into working memory.  */
   for (; i < asize; i++)
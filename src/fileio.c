@@ -5091,7 +5091,9 @@ e_write (int desc, Lisp_Object string, ptrdiff_t start, ptrdiff_t end,
       if (STRINGP (string))
 	{
 	  coding->src_multibyte = SCHARS (string) < SBYTES (string);
-	  if (CODING_REQUIRE_ENCODING (coding))
+	  if (CODING_REQUIRE_ENCODING (coding)
+	      && ! encode_coding_identity_p (coding, SDATA (string),
+					     SBYTES (string)))
 	    {
 	      ptrdiff_t nchars = min (end - start, E_WRITE_MAX);
 
@@ -5115,9 +5117,14 @@ e_write (int desc, Lisp_Object string, ptrdiff_t start, ptrdiff_t end,
 	{
 	  ptrdiff_t start_byte = CHAR_TO_BYTE (start);
 	  ptrdiff_t end_byte = CHAR_TO_BYTE (end);
+	  /* The part of the text before or after the gap.  */
+	  ptrdiff_t contiguous_end_byte
+	    = start >= GPT || end <= GPT ? end_byte : GPT_BYTE;
 
 	  coding->src_multibyte = (end - start) < (end_byte - start_byte);
-	  if (CODING_REQUIRE_ENCODING (coding))
+	  if (CODING_REQUIRE_ENCODING (coding)
+	      && ! encode_coding_identity_p (coding, BYTE_POS_ADDR (start_byte),
+					     contiguous_end_byte - start_byte))
 	    {
 	      ptrdiff_t nchars = min (end - start, E_WRITE_MAX);
 
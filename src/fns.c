@@ -1428,6 +1428,17 @@ set_hash_index_slot (struct Lisp_Hash_Table *h, ptrdiff_t idx, ptrdiff_t val)
 {
   gc_aset (h->index, idx, make_number (val));
 }
+static void
+set_hash_old_index (struct Lisp_Hash_Table *h, Lisp_Object old_index)
+{
+  h->old_index = old_index;
+}
+static void
+set_hash_old_index_slot (struct Lisp_Hash_Table *h, ptrdiff_t idx,
+			 ptrdiff_t val)
+{
+  gc_aset (h->old_index, idx, make_number (val));
+}
 
 /* If OBJ is a Lisp hash table, return a pointer to its struct
    Lisp_Hash_Table.  Otherwise, signal an error.  */
@@ -1532,15 +1543,67 @@ HASH_NEXT (struct Lisp_Hash_Table *h, ptrdiff_t idx)
   return XINT (AREF (h->next, idx));
 }
 
-/* Return the index of the element in hash table H that is the start
-   of the collision list at index IDX, or -1 if the list is empty.  */
+/* The index of a hash table is open-addressed, and its size is a
+   power of 2.  Slot IDX of the index is -1 if it is empty; otherwise
+   it holds the number of an entry shifted left by HASH_TAG_BITS, with
+   a few bits of the entry's hash code in the low bits.  A lookup
+   starts at the slot given by the key's hash code and examines the
+   slots after it until it finds the key or an empty slot; the tag
+   lets it skip most entries with other keys without looking at
+   them.
 
-static ptrdiff_t
+   While a large table is being resized incrementally (see
+   maybe_resize_hash_table), its previous index is kept in old_index,
+   where a slot is HASH_INDEX_REMOVED once its entry has been
+   removed.  */
+
+enum { HASH_TAG_BITS = 7, HASH_INDEX_REMOVED = -2 };
+
+/* Return slot IDX of the index of hash table H.  */
+
+static EMACS_INT
 HASH_INDEX (struct Lisp_Hash_Table *h, ptrdiff_t idx)
 {
   return XINT (AREF (h->index, idx));
 }
 
+/* Scramble HASH_CODE so that codes that differ in only a few bits,
+   like those of objects at nearby addresses, spread over the index.  */
+
+static EMACS_UINT
+hash_index_mix (EMACS_UINT hash_code)
+{
+  return hash_code * (EMACS_UINT) 0x9e3779b97f4a7c15;
+}
+
+/* Return the slot where a search of INDEX for the scrambled hash
+   code MIXED starts.  */
+
+static ptrdiff_t
+hash_index_start (Lisp_Object index, EMACS_UINT mixed)
+{
+  return ((mixed ^ mixed >> EMACS_INT_WIDTH / 2)
+	  & (gc_asize (index) - 1));
+}
+
+/* Return the index slot contents for entry IDX, whose scrambled hash
+   code is MIXED.  */
+
+static EMACS_INT
+hash_index_slot (ptrdiff_t idx, EMACS_UINT mixed)
+{
+  return ((EMACS_INT) idx << HASH_TAG_BITS
+	  | mixed >> (EMACS_INT_WIDTH - HASH_TAG_BITS));
+}
+
+/* Return the entry number in index slot contents SLOT.  */
+
+static ptrdiff_t
+hash_index_entry (EMACS_INT slot)
+{
+  return slot >> HASH_TAG_BITS;
+}
+
 /* Compare KEY1 which has hash code HASH1 and KEY2 with hash code
    HASH2 in hash table H using `eql'.  Value is true if KEY1 and
    KEY2 are the same.  */
@@ -1644,6 +1707,93 @@ allocate_hash_table (void)
 #define INDEX_SIZE_BOUND \
   ((ptrdiff_t) min (MOST_POSITIVE_FIXNUM, PTRDIFF_MAX / word_size))
 
+/* Return the size of the index of a hash table with SIZE entries and
+   rehash threshold THRESHOLD, or -1 if it would be too large.  The
+   index is never more than 3/4 full, so that searches stay short.  */
+
+static ptrdiff_t
+hash_index_size (EMACS_INT size, double threshold)
+{
+  double index_float = size / min (threshold, 0.75);
+  ptrdiff_t index_size = 1;
+
+  if (! (index_float < INDEX_SIZE_BOUND >> HASH_TAG_BITS))
+    return -1;
+  while (index_size < index_float)
+    index_size *= 2;
+  return index_size;
+}
+
+/* Add entry IDX of hash table H to its index, in the first empty
+   slot from where a search for it starts.  */
+
+static void
+hash_index_add (struct Lisp_Hash_Table *h, ptrdiff_t idx)
+{
+  ptrdiff_t mask = ASIZE (h->index) - 1;
+  EMACS_UINT mixed = hash_index_mix (XUINT (HASH_HASH (h, idx)));
+  ptrdiff_t slot = hash_index_start (h->index, mixed);
+
+  while (HASH_INDEX (h, slot) >= 0)
+    slot = (slot + 1) & mask;
+  set_hash_index_slot (h, slot, hash_index_slot (idx, mixed));
+}
+
+/* Put the entries of hash table H into its index, which is empty.  */
+
+static void
+hash_index_fill (struct Lisp_Hash_Table *h)
+{
+  for (ptrdiff_t i = 0; i < HASH_TABLE_SIZE (h); i++)
+    if (!NILP (HASH_HASH (h, i)))
+      hash_index_add (h, i);
+}
+
+/* Return the slot of INDEX, an index of H, that refers to entry IDX,
+   or -1 if there is none.  */
+
+static ptrdiff_t
+hash_index_find_entry (struct Lisp_Hash_Table *h, Lisp_Object index,
+		       ptrdiff_t idx)
+{
+  ptrdiff_t mask = gc_asize (index) - 1;
+  EMACS_UINT mixed = hash_index_mix (XUINT (HASH_HASH (h, idx)));
+  ptrdiff_t slot = hash_index_start (index, mixed);
+  EMACS_INT contents;
+
+  for (; (contents = XINT (AREF (index, slot))) != -1;
+       slot = (slot + 1) & mask)
+    if (0 <= contents && hash_index_entry (contents) == idx)
+      return slot;
+  return -1;
+}
+
+/* Empty index slot SLOT of H.  Move back the slots after it that
+   would otherwise become unreachable from where their searches
+   start.  */
+
+static void
+hash_index_delete (struct Lisp_Hash_Table *h, ptrdiff_t slot)
+{
+  ptrdiff_t mask = gc_asize (h->index) - 1;
+  EMACS_INT contents;
+
+  for (ptrdiff_t next = (slot + 1) & mask;
+       0 <= (contents = HASH_INDEX (h, next));
+       next = (next + 1) & mask)
+    {
+      ptrdiff_t idx = hash_index_entry (contents);
+      EMACS_UINT mixed = hash_index_mix (XUINT (HASH_HASH (h, idx)));
+      ptrdiff_t start = hash_index_start (h->index, mixed);
+      if (((next - start) & mask) >= ((next - slot) & mask))
+	{
+	  set_hash_index_slot (h, slot, contents);
+	  slot = next;
+	}
+    }
+  set_hash_index_slot (h, slot, -1);
+}
+
 /* Create and initialize a new hash table.
 
    TEST specifies the test the hash table will use to compare keys.
@@ -1677,9 +1827,8 @@ make_hash_table (struct hash_table_test test, EMACS_INT size,
 {
   struct Lisp_Hash_Table *h;
   Lisp_Object table;
-  EMACS_INT index_size;
+  ptrdiff_t index_size;
   ptrdiff_t i;
-  double index_float;
 
   /* Preconditions.  */
   eassert (SYMBOLP (test.name));
@@ -1690,12 +1839,8 @@ make_hash_table (struct hash_table_test test, EMACS_INT size,
   if (size == 0)
     size = 1;
 
-  double threshold = rehash_threshold;
-  index_float = size / threshold;
-  index_size = (index_float < INDEX_SIZE_BOUND + 1
-		? next_almost_prime (index_float)
-		: INDEX_SIZE_BOUND + 1);
-  if (INDEX_SIZE_BOUND < max (index_size, 2 * size))
+  index_size = hash_index_size (size, rehash_threshold);
+  if (index_size < 0 || INDEX_SIZE_BOUND < max (index_size, 2 * size))
     error ("Hash table too large");
 
   /* Allocate a table and initialize it.  */
@@ -1711,6 +1856,8 @@ make_hash_table (struct hash_table_test test, EMACS_INT size,
   h->hash = Fmake_vector (make_number (size), Qnil);
   h->next = Fmake_vector (make_number (size), make_number (-1));
   h->index = Fmake_vector (make_number (index_size), make_number (-1));
+  h->old_index = Qnil;
+  h->migrated = 0;
   h->pure = pure;
 
   /* Set up the free list.  */
@@ -1732,8 +1879,48 @@ make_hash_table (struct hash_table_test test, EMACS_INT size,
   return table;
 }
 
+/* Migrate up to N slots of the old index of hash table H to its
+   index, and forget the old index once they have all been moved.  */
+
+static void
+hash_migrate (struct Lisp_Hash_Table *h, ptrdiff_t n)
+{
+  ptrdiff_t old_size = ASIZE (h->old_index);
+  ptrdiff_t end = min (old_size, h->migrated + n);
+
+  for (; h->migrated < end; h->migrated++)
+    {
+      EMACS_INT contents = XINT (AREF (h->old_index, h->migrated));
+      if (0 <= contents)
+	hash_index_add (h, hash_index_entry (contents));
+    }
+  if (h->migrated == old_size)
+    set_hash_old_index (h, Qnil);
+}
+
+/* Migrate some of the old index of hash table H, if it is being
+   resized incrementally.  Move enough slots each time that the old
+   index is gone before the free entries run out.  */
+
+static void
+hash_migrate_step (struct Lisp_Hash_Table *h)
+{
+  if (!NILP (h->old_index))
+    {
+      ptrdiff_t remaining = ASIZE (h->old_index) - h->migrated;
+      ptrdiff_t nfree = HASH_TABLE_SIZE (h) - h->count;
+      hash_migrate (h, 16 + remaining / max (nfree, 1));
+    }
+}
+
 /* Resize hash table H if it's too full.  If H cannot be resized
-   because it's already too large, throw an error.  */
+   because it's already too large, throw an error.
+
+   Normally the new index is filled at once.  A table that is large
+   enough according to `hash-table-incremental-resize' keeps its
+   previous index instead, and its slots are moved to the new index a
+   few at a time by later calls to hash_put and
+   hash_remove_from_table, so that no single call takes long.  */
 
 static void
 maybe_resize_hash_table (struct Lisp_Hash_Table *h)
@@ -1744,7 +1931,6 @@ maybe_resize_hash_table (struct Lisp_Hash_Table *h)
       EMACS_INT new_size, index_size, nsize;
       ptrdiff_t i;
       double rehash_size = h->rehash_size;
-      double index_float;
 
       if (rehash_size < 0)
 	new_size = old_size - rehash_size;
@@ -1758,13 +1944,9 @@ maybe_resize_hash_table (struct Lisp_Hash_Table *h)
 	}
       if (new_size <= old_size)
 	new_size = old_size + 1;
-      double threshold = h->rehash_threshold;
-      index_float = new_size / threshold;
-      index_size = (index_float < INDEX_SIZE_BOUND + 1
-		    ? next_almost_prime (index_float)
-		    : INDEX_SIZE_BOUND + 1);
+      index_size = hash_index_size (new_size, h->rehash_threshold);
       nsize = max (index_size, 2 * new_size);
-      if (INDEX_SIZE_BOUND < nsize)
+      if (index_size < 0 || INDEX_SIZE_BOUND < nsize)
 	error ("Hash table too large to resize");
 
 #ifdef ENABLE_CHECKING
@@ -1773,9 +1955,22 @@ maybe_resize_hash_table (struct Lisp_Hash_Table *h)
 	message ("Growing hash table to: %"pI"d", new_size);
 #endif
 
+      /* Finish any previous incremental resize first.  */
+      if (!NILP (h->old_index))
+	hash_migrate (h, ASIZE (h->old_index));
+
+      bool incremental = (NILP (h->weak)
+			  && INTEGERP (Vhash_table_incremental_resize)
+			  && XINT (Vhash_table_incremental_resize) <= old_size);
+
       set_hash_key_and_value (h, larger_vector (h->key_and_value,
 						2 * (new_size - old_size), -1));
       set_hash_hash (h, larger_vector (h->hash, new_size - old_size, -1));
+      if (incremental)
+	{
+	  set_hash_old_index (h, h->index);
+	  h->migrated = 0;
+	}
       set_hash_index (h, Fmake_vector (make_number (index_size),
 				       make_number (-1)));
       set_hash_next (h, larger_vecalloc (h->next, new_size - old_size, -1));
@@ -1803,18 +1998,70 @@ maybe_resize_hash_table (struct Lisp_Hash_Table *h)
 	}
 
       /* Rehash.  */
-      for (i = 0; i < old_size; ++i)
-	if (!NILP (HASH_HASH (h, i)))
-	  {
-	    EMACS_UINT hash_code = XUINT (HASH_HASH (h, i));
-	    ptrdiff_t start_of_bucket = hash_code % ASIZE (h->index);
-	    set_hash_next_slot (h, i, HASH_INDEX (h, start_of_bucket));
-	    set_hash_index_slot (h, start_of_bucket, i);
-	  }
+      if (!incremental)
+	hash_index_fill (h);
     }
 }
 
 
+/* Return the slot of INDEX, an index of H, that refers to the entry
+   for KEY, whose hash code is HASH_CODE, or the empty slot where the
+   search for it ended.  */
+
+static ptrdiff_t
+hash_index_find (struct Lisp_Hash_Table *h, Lisp_Object index,
+		 Lisp_Object key, EMACS_UINT hash_code)
+{
+  ptrdiff_t mask = ASIZE (index) - 1;
+  EMACS_UINT mixed = hash_index_mix (hash_code);
+  EMACS_INT tag = hash_index_slot (0, mixed);
+  ptrdiff_t slot = hash_index_start (index, mixed);
+  EMACS_INT contents;
+
+  for (; (contents = XINT (AREF (index, slot))) != -1;
+       slot = (slot + 1) & mask)
+    if (0 <= contents && (contents & ((1 << HASH_TAG_BITS) - 1)) == tag)
+      {
+	ptrdiff_t i = hash_index_entry (contents);
+	if (EQ (key, HASH_KEY (h, i))
+	    || (h->test.cmpfn
+		&& hash_code == XUINT (HASH_HASH (h, i))
+		&& h->test.cmpfn (&h->test, key, HASH_KEY (h, i))))
+	  break;
+      }
+
+  return slot;
+}
+
+/* Return the number of the entry for KEY, whose hash code is
+   HASH_CODE, in hash table H, or -1 if there is none.  If OLD_SLOT is
+   non-null, store in *OLD_SLOT the slot of the old index that refers
+   to it, or -1.  */
+
+static ptrdiff_t
+hash_find_entry (struct Lisp_Hash_Table *h, Lisp_Object key,
+		 EMACS_UINT hash_code, ptrdiff_t *old_slot)
+{
+  EMACS_INT contents
+    = HASH_INDEX (h, hash_index_find (h, h->index, key, hash_code));
+  ptrdiff_t i = contents < 0 ? -1 : hash_index_entry (contents);
+
+  if (old_slot)
+    *old_slot = -1;
+  if (!NILP (h->old_index) && (i < 0 || old_slot))
+    {
+      ptrdiff_t slot = hash_index_find (h, h->old_index, key, hash_code);
+      contents = XINT (AREF (h->old_index, slot));
+      if (0 <= contents)
+	{
+	  i = hash_index_entry (contents);
+	  if (old_slot)
+	    *old_slot = slot;
+	}
+    }
+  return i;
+}
+
 /* Lookup KEY in hash table H.  If HASH is non-null, return in *HASH
    the hash code of KEY.  Value is the index of the entry in H
    matching KEY, or -1 if not found.  */
@@ -1823,23 +2070,13 @@ ptrdiff_t
 hash_lookup (struct Lisp_Hash_Table *h, Lisp_Object key, EMACS_UINT *hash)
 {
   EMACS_UINT hash_code;
-  ptrdiff_t start_of_bucket, i;
 
   hash_code = h->test.hashfn (&h->test, key);
   eassert ((hash_code & ~INTMASK) == 0);
   if (hash)
     *hash = hash_code;
 
-  start_of_bucket = hash_code % ASIZE (h->index);
-
-  for (i = HASH_INDEX (h, start_of_bucket); 0 <= i; i = HASH_NEXT (h, i))
-    if (EQ (key, HASH_KEY (h, i))
-	|| (h->test.cmpfn
-	    && hash_code == XUINT (HASH_HASH (h, i))
-	    && h->test.cmpfn (&h->test, key, HASH_KEY (h, i))))
-      break;
-
-  return i;
+  return hash_find_entry (h, key, hash_code, NULL);
 }
 
 
@@ -1851,12 +2088,13 @@ ptrdiff_t
 hash_put (struct Lisp_Hash_Table *h, Lisp_Object key, Lisp_Object value,
 	  EMACS_UINT hash)
 {
-  ptrdiff_t start_of_bucket, i;
+  ptrdiff_t i;
 
   eassert ((hash & ~INTMASK) == 0);
 
   /* Increment count after resizing because resizing may fail.  */
   maybe_resize_hash_table (h);
+  hash_migrate_step (h);
   h->count++;
 
   /* Store key/value in the key_and_value vector.  */
@@ -1868,10 +2106,8 @@ hash_put (struct Lisp_Hash_Table *h, Lisp_Object key, Lisp_Object value,
   /* Remember its hash code.  */
   set_hash_hash_slot (h, i, make_number (hash));
 
-  /* Add new entry to its collision chain.  */
-  start_of_bucket = hash % ASIZE (h->index);
-  set_hash_next_slot (h, i, HASH_INDEX (h, start_of_bucket));
-  set_hash_index_slot (h, start_of_bucket, i);
+  /* Add new entry to the index.  */
+  hash_index_add (h, i);
   return i;
 }
 
@@ -1883,37 +2119,29 @@ hash_remove_from_table (struct Lisp_Hash_Table *h, Lisp_Object key)
 {
   EMACS_UINT hash_code = h->test.hashfn (&h->test, key);
   eassert ((hash_code & ~INTMASK) == 0);
-  ptrdiff_t start_of_bucket = hash_code % ASIZE (h->index);
-  ptrdiff_t prev = -1;
+  ptrdiff_t old_slot;
+  ptrdiff_t i = hash_find_entry (h, key, hash_code, &old_slot);
 
-  for (ptrdiff_t i = HASH_INDEX (h, start_of_bucket);
-       0 <= i;
-       i = HASH_NEXT (h, i))
+  if (i >= 0)
     {
-      if (EQ (key, HASH_KEY (h, i))
-	  || (h->test.cmpfn
-	      && hash_code == XUINT (HASH_HASH (h, i))
-	      && h->test.cmpfn (&h->test, key, HASH_KEY (h, i))))
-	{
-	  /* Take entry out of collision chain.  */
-	  if (prev < 0)
-	    set_hash_index_slot (h, start_of_bucket, HASH_NEXT (h, i));
-	  else
-	    set_hash_next_slot (h, prev, HASH_NEXT (h, i));
-
-	  /* Clear slots in key_and_value and add the slots to
-	     the free list.  */
-	  set_hash_key_slot (h, i, Qnil);
-	  set_hash_value_slot (h, i, Qnil);
-	  set_hash_hash_slot (h, i, Qnil);
-	  set_hash_next_slot (h, i, h->next_free);
-	  h->next_free = i;
-	  h->count--;
-	  eassert (h->count >= 0);
-	  break;
-	}
-
-      prev = i;
+      /* Take entry out of the index, and out of the old index if it
+	 is still there.  */
+      ptrdiff_t slot = hash_index_find_entry (h, h->index, i);
+      if (slot >= 0)
+	hash_index_delete (h, slot);
+      if (old_slot >= 0)
+	set_hash_old_index_slot (h, old_slot, HASH_INDEX_REMOVED);
+
+      /* Clear slots in key_and_value and add the slots to
+	 the free list.  */
+      set_hash_key_slot (h, i, Qnil);
+      set_hash_value_slot (h, i, Qnil);
+      set_hash_hash_slot (h, i, Qnil);
+      set_hash_next_slot (h, i, h->next_free);
+      h->next_free = i;
+      h->count--;
+      eassert (h->count >= 0);
+      hash_migrate_step (h);
     }
 }
 
@@ -1937,6 +2165,7 @@ hash_clear (struct Lisp_Hash_Table *h)
 
       for (i = 0; i < ASIZE (h->index); ++i)
 	ASET (h->index, i, make_number (-1));
+      set_hash_old_index (h, Qnil);
 
       h->next_free = 0;
       h->count = 0;
@@ -1957,76 +2186,68 @@ hash_clear (struct Lisp_Hash_Table *h)
 static bool
 sweep_weak_table (struct Lisp_Hash_Table *h, bool remove_entries_p)
 {
-  ptrdiff_t n = gc_asize (h->index);
+  ptrdiff_t n = gc_asize (h->next);
   bool marked = false;
 
-  for (ptrdiff_t bucket = 0; bucket < n; ++bucket)
+  /* Weak tables are never resized incrementally.  */
+  eassert (NILP (h->old_index));
+
+  for (ptrdiff_t i = 0; i < n; ++i)
     {
-      /* Follow collision chain, removing entries that
-	 don't survive this garbage collection.  */
-      ptrdiff_t prev = -1;
-      ptrdiff_t next;
-      for (ptrdiff_t i = HASH_INDEX (h, bucket); 0 <= i; i = next)
+      /* Look at each entry in use, removing those that don't survive
+	 this garbage collection.  */
+      if (NILP (HASH_HASH (h, i)))
+	continue;
+
+      bool key_known_to_survive_p = survives_gc_p (HASH_KEY (h, i));
+      bool value_known_to_survive_p = survives_gc_p (HASH_VALUE (h, i));
+      bool remove_p;
+
+      if (EQ (h->weak, Qkey))
+	remove_p = !key_known_to_survive_p;
+      else if (EQ (h->weak, Qvalue))
+	remove_p = !value_known_to_survive_p;
+      else if (EQ (h->weak, Qkey_or_value))
+	remove_p = !(key_known_to_survive_p || value_known_to_survive_p);
+      else if (EQ (h->weak, Qkey_and_value))
+	remove_p = !(key_known_to_survive_p && value_known_to_survive_p);
+      else
+	emacs_abort ();
+
+      if (remove_entries_p)
 	{
-	  bool key_known_to_survive_p = survives_gc_p (HASH_KEY (h, i));
-	  bool value_known_to_survive_p = survives_gc_p (HASH_VALUE (h, i));
-	  bool remove_p;
-
-	  if (EQ (h->weak, Qkey))
-	    remove_p = !key_known_to_survive_p;
-	  else if (EQ (h->weak, Qvalue))
-	    remove_p = !value_known_to_survive_p;
-	  else if (EQ (h->weak, Qkey_or_value))
-	    remove_p = !(key_known_to_survive_p || value_known_to_survive_p);
-	  else if (EQ (h->weak, Qkey_and_value))
-	    remove_p = !(key_known_to_survive_p && value_known_to_survive_p);
-	  else
-	    emacs_abort ();
+	  if (remove_p)
+	    {
+	      /* Take out of the index.  */
+	      hash_index_delete (h, hash_index_find_entry (h, h->index, i));
+
+	      /* Add to free list.  */
+	      set_hash_next_slot (h, i, h->next_free);
+	      h->next_free = i;
 
-	  next = HASH_NEXT (h, i);
+	      /* Clear key, value, and hash.  */
+	      set_hash_key_slot (h, i, Qnil);
+	      set_hash_value_slot (h, i, Qnil);
+	      set_hash_hash_slot (h, i, Qnil);
 
-	  if (remove_entries_p)
+	      h->count--;
+	    }
+	}
+      else
+	{
+	  if (!remove_p)
 	    {
-	      if (remove_p)
+	      /* Make sure key and value survive.  */
+	      if (!key_known_to_survive_p)
 		{
-		  /* Take out of collision chain.  */
-		  if (prev < 0)
-		    set_hash_index_slot (h, bucket, next);
-		  else
-		    set_hash_next_slot (h, prev, next);
-
-		  /* Add to free list.  */
-		  set_hash_next_slot (h, i, h->next_free);
-		  h->next_free = i;
-
-		  /* Clear key, value, and hash.  */
-		  set_hash_key_slot (h, i, Qnil);
-		  set_hash_value_slot (h, i, Qnil);
-		  set_hash_hash_slot (h, i, Qnil);
-
-		  h->count--;
+		  mark_object (HASH_KEY (h, i));
+		  marked = 1;
 		}
-	      else
-		{
-		  prev = i;
-		}
-	    }
-	  else
-	    {
-	      if (!remove_p)
+
+	      if (!value_known_to_survive_p)
 		{
-		  /* Make sure key and value survive.  */
-		  if (!key_known_to_survive_p)
-		    {
-		      mark_object (HASH_KEY (h, i));
-		      marked = 1;
-		    }
-
-		  if (!value_known_to_survive_p)
-		    {
-		      mark_object (HASH_VALUE (h, i));
-		      marked = 1;
-		    }
+		  mark_object (HASH_VALUE (h, i));
+		  marked = 1;
 		}
 	    }
 	}
@@ -2098,24 +2319,121 @@ sweep_weak_hash_tables (void)
 
 #define SXHASH_MAX_LEN   7
 
+/* Strings and bool vectors are hashed 8 bytes at a time, with the
+   XXH64 algorithm by Yann Collet.  Its multiply-and-rotate rounds mix
+   every input bit into the whole hash, so similar strings like file
+   names that differ only near their ends rarely collide.  */
+
+enum { HASH_CHUNK = 32 };
+
+static uint64_t const hash_prime_1 = 0x9e3779b185ebca87;
+static uint64_t const hash_prime_2 = 0xc2b2ae3d27d4eb4f;
+static uint64_t const hash_prime_3 = 0x165667b19e3779f9;
+static uint64_t const hash_prime_4 = 0x85ebca77c2b2ae63;
+static uint64_t const hash_prime_5 = 0x27d4eb2f165667c5;
+
+static uint64_t
+hash_rotl (uint64_t x, int n)
+{
+  return x << n | x >> (64 - n);
+}
+
+static uint64_t
+hash_load_64 (unsigned char const *p)
+{
+  uint64_t x;
+  memcpy (&x, p, sizeof x);
+  return x;
+}
+
+static uint64_t
+hash_round (uint64_t acc, uint64_t input)
+{
+  acc += input * hash_prime_2;
+  return hash_rotl (acc, 31) * hash_prime_1;
+}
+
+static uint64_t
+hash_merge_round (uint64_t acc, uint64_t val)
+{
+  acc ^= hash_round (0, val);
+  return acc * hash_prime_1 + hash_prime_4;
+}
+
+/* Return the 64-bit hash of the LEN bytes at P.  */
+
+static uint64_t
+hash_bytes (unsigned char const *p, ptrdiff_t len)
+{
+  unsigned char const *end = p + len;
+  uint64_t h;
+
+  if (len >= HASH_CHUNK)
+    {
+      uint64_t v1 = hash_prime_1 + hash_prime_2;
+      uint64_t v2 = hash_prime_2;
+      uint64_t v3 = 0;
+      uint64_t v4 = -hash_prime_1;
+
+      do
+	{
+	  v1 = hash_round (v1, hash_load_64 (p));
+	  v2 = hash_round (v2, hash_load_64 (p + 8));
+	  v3 = hash_round (v3, hash_load_64 (p + 16));
+	  v4 = hash_round (v4, hash_load_64 (p + 24));
+	  p += HASH_CHUNK;
+	}
+      while (end - p >= HASH_CHUNK);
+
+      h = (hash_rotl (v1, 1) + hash_rotl (v2, 7)
+	   + hash_rotl (v3, 12) + hash_rotl (v4, 18));
+      h = hash_merge_round (h, v1);
+      h = hash_merge_round (h, v2);
+      h = hash_merge_round (h, v3);
+      h = hash_merge_round (h, v4);
+    }
+  else
+    h = hash_prime_5;
+
+  h += len;
+
+  for (; end - p >= 8; p += 8)
+    {
+      h ^= hash_round (0, hash_load_64 (p));
+      h = hash_rotl (h, 27) * hash_prime_1 + hash_prime_4;
+    }
+  if (end - p >= 4)
+    {
+      uint32_t k;
+      memcpy (&k, p, 4);
+      h ^= k * hash_prime_1;
+      h = hash_rotl (h, 23) * hash_prime_2 + hash_prime_3;
+      p += 4;
+    }
+  for (; p < end; p++)
+    {
+      h ^= *p * hash_prime_5;
+      h = hash_rotl (h, 11) * hash_prime_1;
+    }
+
+  h ^= h >> 33;
+  h *= hash_prime_2;
+  h ^= h >> 29;
+  h *= hash_prime_3;
+  h ^= h >> 32;
+  return h;
+}
+
 /* Return a hash for string PTR which has length LEN.  The hash value
    can be any EMACS_UINT value.  */
 
 EMACS_UINT
 hash_string (char const *ptr, ptrdiff_t len)
 {
-  char const *p = ptr;
-  char const *end = p + len;
-  unsigned char c;
-  EMACS_UINT hash = 0;
-
-  while (p != end)
-    {
-      c = *p++;
-      hash = sxhash_combine (hash, c);
-    }
+  uint64_t hash = hash_bytes ((unsigned char const *) ptr, len);
 
-  return hash;
+  /* Keep the high bits too if EMACS_UINT is narrower.  */
+  return hash ^ hash >> 32 >> (EMACS_UINT_WIDTH - 32);
 }
 
 /* Return a hash for string PTR which has length LEN.  The hash
@@ -2203,14 +2521,10 @@ static EMACS_UINT
 sxhash_bool_vector (Lisp_Object vec)
 {
   EMACS_INT size = bool_vector_size (vec);
-  EMACS_UINT hash = size;
-  int i, n;
-
-  n = min (SXHASH_MAX_LEN, bool_vector_words (size));
-  for (i = 0; i < n; ++i)
-    hash = sxhash_combine (hash, bool_vector_data (vec)[i]);
+  EMACS_UINT hash = hash_string ((char const *) bool_vector_uchar_data (vec),
+				 bool_vector_bytes (size));
 
-  return SXHASH_REDUCE (hash);
+  return SXHASH_REDUCE (sxhash_combine (size, hash));
 }
 
 
@@ -2677,6 +2991,18 @@ syms_of_fns (void)
   defsubr (&Smake_hash_table);
   defsubr (&Shash_table_rehash_size);
 
+  DEFVAR_LISP ("hash-table-incremental-resize", Vhash_table_incremental_resize,
+	       doc: /* Minimum size of hash tables that grow incrementally.
+When a hash table with at least this many entries is full, it is given
+more room at once, but its keys are moved to their new places a few at
+a time by the `puthash' and `remhash' calls that follow, instead of
+all at once.  This bounds the time any one `puthash' takes, at the
+cost of making lookups slower while keys are being moved.
+
+nil means all hash tables are resized at once.  Weak hash tables are
+always resized at once.  */);
+  Vhash_table_incremental_resize = Qnil;
+
   /* Crypto and hashing stuff.  */
   DEFSYM (Qiv_auto, "iv-auto");
 
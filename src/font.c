@@ -190,6 +190,9 @@ font_make_object (int size, Lisp_Object entity, int pixelsize)
   /* GC can happen before the driver is set up,
      so avoid dangling pointer here (Bug#17771).  */
   font->driver = NULL;
+  font->metrics_blocks = NULL;
+  font->metrics_overflow = NULL;
+  font->metrics_overflow_size = font->metrics_overflow_count = 0;
   XSETFONT (font_object, font);
 
   if (! NILP (entity))
@@ -2621,6 +2624,7 @@ font_clear_cache (struct frame *f, Lisp_Object cache,
 			{
 			  eassert (font && driver == font->driver);
 			  driver->close (font);
+			  font_free_glyph_metrics (font);
 			}
 		    }
 		  if (driver->free_entity)
@@ -4262,6 +4266,176 @@ DEFUN ("clear-font-cache", Fclear_font_cache, Sclear_font_cache, 0, 0, 0,
 }
 
 
+/* Glyph metrics cache.
+
+   The text_extents method of a font driver usually has to ask the
+   font library or the X server about every glyph, and layout asks
+   for the same glyphs over and over.  So font_text_extents remembers
+   the metrics of each glyph of a font.  Glyph codes below
+   FONT_METRICS_DENSE_LIMIT, which covers the glyph indices of
+   TrueType and OpenType fonts as well as the 2-byte codes of X core
+   fonts, are stored in blocks of FONT_METRICS_BLOCK_SIZE entries
+   allocated on demand.  Larger codes go to a small open-addressed
+   hash table.  */
+
+#define FONT_METRICS_BLOCK_SIZE 256
+#define FONT_METRICS_DENSE_LIMIT 0x10000
+#define FONT_METRICS_NBLOCKS \
+  (FONT_METRICS_DENSE_LIMIT / FONT_METRICS_BLOCK_SIZE)
+
+struct font_glyph_metrics
+{
+  /* Glyph code; used only in the overflow hash table.  */
+  unsigned code;
+
+  /* True if METRICS has been filled in.  */
+  bool_bf valid : 1;
+
+  struct font_metrics metrics;
+};
+
+/* Return the slot for glyph CODE of FONT in the overflow hash table,
+   growing the table if needed.  */
+
+static struct font_glyph_metrics *
+font_overflow_glyph_metrics (struct font *font, unsigned code)
+{
+  struct font_glyph_metrics *table;
+  ptrdiff_t mask, i;
+
+  if (font->metrics_overflow_size < 2 * (font->metrics_overflow_count + 1))
+    {
+      struct font_glyph_metrics *old = font->metrics_overflow;
+      ptrdiff_t old_size = font->metrics_overflow_size;
+      ptrdiff_t size = old_size ? 2 * old_size : 64;
+
+      table = xzalloc (size * sizeof *table);
+      for (i = 0; i < old_size; i++)
+	if (old[i].valid)
+	  {
+	    ptrdiff_t j = (old[i].code * 2654435761u) & (size - 1);
+	    while (table[j].valid)
+	      j = (j + 1) & (size - 1);
+	    table[j] = old[i];
+	  }
+      xfree (old);
+      font->metrics_overflow = table;
+      font->metrics_overflow_size = size;
+    }
+
+  table = font->metrics_overflow;
+  mask = font->metrics_overflow_size - 1;
+  for (i = (code * 2654435761u) & mask;
+       table[i].valid && table[i].code != code;
+       i = (i + 1) & mask)
+    continue;
+  return table + i;
+}
+
+/* Return the metrics of glyph CODE of FONT, asking the font driver
+   only the first time.  */
+
+static struct font_metrics const *
+font_glyph_metrics (struct font *font, unsigned code)
+{
+  struct font_glyph_metrics *g;
+
+  if (code < FONT_METRICS_DENSE_LIMIT)
+    {
+      struct font_glyph_metrics **block;
+
+      if (! font->metrics_blocks)
+	font->metrics_blocks
+	  = xzalloc (FONT_METRICS_NBLOCKS * sizeof *font->metrics_blocks);
+      block = font->metrics_blocks + code / FONT_METRICS_BLOCK_SIZE;
+      if (! *block)
+	*block = xzalloc (FONT_METRICS_BLOCK_SIZE * sizeof **block);
+      g = *block + code % FONT_METRICS_BLOCK_SIZE;
+    }
+  else
+    {
+      g = font_overflow_glyph_metrics (font, code);
+      if (! g->valid)
+	font->metrics_overflow_count++;
+    }
+
+  if (! g->valid)
+    {
+      memset (&g->metrics, 0, sizeof g->metrics);
+      font->driver->text_extents (font, &code, 1, &g->metrics);
+      g->code = code;
+      g->valid = true;
+    }
+  return &g->metrics;
+}
+
+/* Compute the metrics of the NGLYPHS glyphs whose codes are in CODE,
+   laid out next to each other, and store them in METRICS if it is
+   non-NULL.  This is what the text_extents method of FONT's driver
+   does, but the metrics of individual glyphs are cached.  */
+
+void
+font_text_extents (struct font *font, unsigned *code, int nglyphs,
+		   struct font_metrics *metrics)
+{
+  int i, width = 0;
+
+  if (metrics)
+    memset (metrics, 0, sizeof *metrics);
+  for (i = 0; i < nglyphs; i++)
+    {
+      struct font_metrics const *m;
+      struct font_metrics invalid;
+
+      if (code[i] == FONT_INVALID_CODE)
+	{
+	  memset (&invalid, 0, sizeof invalid);
+	  font->driver->text_extents (font, code + i, 1, &invalid);
+	  m = &invalid;
+	}
+      else
+	m = font_glyph_metrics (font, code[i]);
+
+      if (! metrics)
+	;
+      else if (i == 0)
+	*metrics = *m;
+      else
+	{
+	  if (metrics->lbearing > width + m->lbearing)
+	    metrics->lbearing = width + m->lbearing;
+	  if (metrics->rbearing < width + m->rbearing)
+	    metrics->rbearing = width + m->rbearing;
+	  if (metrics->ascent < m->ascent)
+	    metrics->ascent = m->ascent;
+	  if (metrics->descent < m->descent)
+	    metrics->descent = m->descent;
+	}
+      width += m->width;
+    }
+  if (metrics)
+    metrics->width = width;
+}
+
+/* Free the glyph metrics cache of FONT.  */
+
+void
+font_free_glyph_metrics (struct font *font)
+{
+  if (font->metrics_blocks)
+    {
+      int i;
+
+      for (i = 0; i < FONT_METRICS_NBLOCKS; i++)
+	xfree (font->metrics_blocks[i]);
+      xfree (font->metrics_blocks);
+      font->metrics_blocks = NULL;
+    }
+  xfree (font->metrics_overflow);
+  font->metrics_overflow = NULL;
+  font->metrics_overflow_size = font->metrics_overflow_count = 0;
+}
+
 void
 font_fill_lglyph_metrics (Lisp_Object glyph, Lisp_Object font_object)
 {
@@ -4270,7 +4444,7 @@ font_fill_lglyph_metrics (Lisp_Object glyph, Lisp_Object font_object)
   struct font_metrics metrics;
 
   LGLYPH_SET_CODE (glyph, code);
-  font->driver->text_extents (font, &code, 1, &metrics);
+  font_text_extents (font, &code, 1, &metrics);
   LGLYPH_SET_LBEARING (glyph, metrics.lbearing);
   LGLYPH_SET_RBEARING (glyph, metrics.rbearing);
   LGLYPH_SET_WIDTH (glyph, metrics.width);
@@ -4812,7 +4986,7 @@ the corresponding element is nil.  */)
       LGLYPH_SET_TO (g, i);
       LGLYPH_SET_CHAR (g, c);
       LGLYPH_SET_CODE (g, code);
-      font->driver->text_extents (font, &code, 1, &metrics);
+      font_text_extents (font, &code, 1, &metrics);
       LGLYPH_SET_WIDTH (g, metrics.width);
       LGLYPH_SET_LBEARING (g, metrics.lbearing);
       LGLYPH_SET_RBEARING (g, metrics.rbearing);
@@ -378,6 +378,14 @@ struct font
   /* Font-driver for the font.  */
   struct font_driver const *driver;
 
+  /* Cache of the metrics of individual glyphs, maintained by
+     font_text_extents.  METRICS_BLOCKS holds the glyphs whose code is
+     below FONT_METRICS_DENSE_LIMIT, METRICS_OVERFLOW is a hash table
+     of METRICS_OVERFLOW_SIZE slots for the others.  */
+  struct font_glyph_metrics **metrics_blocks;
+  struct font_glyph_metrics *metrics_overflow;
+  ptrdiff_t metrics_overflow_size, metrics_overflow_count;
+
   /* There are more members in this structure, but they are private
      to the font-driver.  */
 };
@@ -856,6 +864,9 @@ extern Lisp_Object font_range (ptrdiff_t, ptrdiff_t, ptrdiff_t *,
 			       struct window *, struct face *,
 			       Lisp_Object);
 extern void font_fill_lglyph_metrics (Lisp_Object, Lisp_Object);
+extern void font_text_extents (struct font *, unsigned *, int,
+			       struct font_metrics *);
+extern void font_free_glyph_metrics (struct font *);
 
 extern Lisp_Object font_put_extra (Lisp_Object font, Lisp_Object prop,
                                    Lisp_Object val);
@@ -1353,10 +1353,7 @@ replace_range (ptrdiff_t from, ptrdiff_t to, Lisp_Object new,
      will insert before deleting, and thus will keep
      the markers before and after this text separate.  */
   if (!NILP (deletion))
-    {
-      record_insert (from + SCHARS (deletion), inschars);
-      record_delete (from, deletion, false);
-    }
+    record_replacement (from, deletion, inschars);
 
   GAP_SIZE -= outgoing_insbytes;
   GPT += inschars;
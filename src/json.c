@@ -729,6 +729,30 @@ json_parse_object_type (ptrdiff_t nargs, Lisp_Object *args)
     }
 }
 
+struct json_parse_args
+{
+  const char *input;
+  json_t *object;
+  json_error_t error;
+};
+
+static void
+json_parse_input (void *arg)
+{
+  struct json_parse_args *args = arg;
+  args->object = json_loads (args->input, 0, &args->error);
+}
+
+/* Release the object that json_parse_input stored in ARG, if any.  */
+
+static void
+json_release_parse_args (void *arg)
+{
+  struct json_parse_args *args = arg;
+  if (args->object != NULL)
+    json_decref (args->object);
+}
+
 DEFUN ("json-parse-string", Fjson_parse_string, Sjson_parse_string, 1, MANY,
        NULL,
        doc: /* Parse the JSON STRING into a Lisp object.
@@ -766,16 +790,32 @@ usage: (json-parse-string STRING &key (OBJECT-TYPE \\='hash-table))  */)
   enum json_object_type object_type
     = json_parse_object_type (nargs - 1, args + 1);
 
-  json_error_t error;
-  json_t *object = json_loads (SSDATA (encoded), 0, &error);
-  if (object == NULL)
-    json_parse_error (&error);
+  /* Release the parsed object on unwinding, including when getting
+     the global lock back after parsing it signals.  */
+  struct json_parse_args args;
+  args.object = NULL;
+  record_unwind_protect_ptr (json_release_parse_args, &args);
 
-  /* Avoid leaking the object in case of further errors.  */
-  if (object != NULL)
-    record_unwind_protect_ptr (json_release_object, object);
+  if (SBYTES (encoded) >= THREAD_UNLOCKED_MIN_BYTES && other_threads_p ())
+    {
+      /* Let other threads run while a copy of ENCODED is parsed, as
+	 its data may move meanwhile.  The allocator functions that
+	 Jansson uses do not need the global lock.  Getting the lock
+	 back can signal, so free the copy on unwinding too.  */
+      char *input = xlispstrdup (encoded);
+      record_unwind_protect_ptr (xfree, input);
+      args.input = input;
+      thread_call_unlocked (json_parse_input, &args);
+    }
+  else
+    {
+      args.input = SSDATA (encoded);
+      json_parse_input (&args);
+    }
+  if (args.object == NULL)
+    json_parse_error (&args.error);
 
-  return unbind_to (count, json_to_lisp (object, object_type));
+  return unbind_to (count, json_to_lisp (args.object, object_type));
 }
 
 struct json_read_buffer_data
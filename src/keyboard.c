@@ -300,6 +300,18 @@ static union buffered_input_event *volatile kbd_store_ptr;
    dequeuing functions?  Such a flag could be screwed up by interrupts
    at inopportune times.  */
 
+/* When each event in kbd_buffer was stored there.  */
+static struct timespec kbd_buffer_stored_at[KBD_BUFFER_SIZE];
+
+/* What happened to the events offered to kbd_buffer, for
+   `input-event-queue-statistics'.  */
+static struct
+{
+  EMACS_INT stored, coalesced, dropped, read;
+  int max_length;
+  struct timespec total_latency, max_latency;
+} kbd_buffer_stats;
+
 static Lisp_Object command_loop (void);
 
 static void echo_now (void);
@@ -3295,6 +3307,82 @@ kbd_buffer_nr_stored (void)
           + (kbd_store_ptr - kbd_buffer)));
 }
 
+/* Return the event stored last in kbd_buffer, or NULL if it is empty.  */
+
+static union buffered_input_event *
+kbd_buffer_last_stored (void)
+{
+  if (kbd_fetch_ptr == kbd_store_ptr)
+    return NULL;
+  return (kbd_store_ptr == kbd_buffer
+	  ? kbd_buffer + KBD_BUFFER_SIZE - 1
+	  : kbd_store_ptr - 1);
+}
+
+/* If EVENT adds nothing to the event stored just before it, merge it
+   into that one and return true.  Mouse motion is not queued, but the
+   help-echo, focus and frame events it brings about can arrive much
+   faster than they are read.  A user signal that repeats one not yet
+   read is dropped, as the system does with a signal already pending.  */
+
+static bool
+kbd_buffer_coalesce (union buffered_input_event *event)
+{
+  union buffered_input_event *last = kbd_buffer_last_stored ();
+
+  if (!last || last->kind != event->kind)
+    return false;
+
+  switch (event->kind)
+    {
+    case BUFFER_SWITCH_EVENT:
+      break;
+
+    case FOCUS_IN_EVENT:
+    case FOCUS_OUT_EVENT:
+    case MOVE_FRAME_EVENT:
+    case CONFIG_CHANGED_EVENT:
+      if (!EQ (last->ie.frame_or_window, event->ie.frame_or_window)
+	  || !EQ (last->ie.arg, event->ie.arg))
+	return false;
+      break;
+
+    case USER_SIGNAL_EVENT:
+      if (last->ie.code != event->ie.code)
+	return false;
+      break;
+
+    case HELP_EVENT:
+      /* Only the latest help for a frame is shown.  */
+      if (!EQ (last->ie.frame_or_window, event->ie.frame_or_window))
+	return false;
+      last->ie = event->ie;
+      break;
+
+    default:
+      return false;
+    }
+
+  kbd_buffer_stats.coalesced++;
+  return true;
+}
+
+/* Note that EVENT is being taken from kbd_buffer to be read.  */
+
+static void
+kbd_buffer_note_read (union buffered_input_event *event)
+{
+  struct timespec waited
+    = timespec_sub (current_timespec (),
+		    kbd_buffer_stored_at[event - kbd_buffer]);
+
+  kbd_buffer_stats.read++;
+  kbd_buffer_stats.total_latency
+    = timespec_add (kbd_buffer_stats.total_latency, waited);
+  if (timespec_cmp (waited, kbd_buffer_stats.max_latency) > 0)
+    kbd_buffer_stats.max_latency = waited;
+}
+
 /* Store an event obtained at interrupt level into kbd_buffer, fifo */
 
 void
@@ -3390,13 +3478,8 @@ kbd_buffer_store_buffered_event (union buffered_input_event *event,
 	  return;
 	}
     }
-  /* Don't insert two BUFFER_SWITCH_EVENT's in a row.
-     Just ignore the second one.  */
-  else if (event->kind == BUFFER_SWITCH_EVENT
-	   && kbd_fetch_ptr != kbd_store_ptr
-	   && ((kbd_store_ptr == kbd_buffer
-		? kbd_buffer + KBD_BUFFER_SIZE - 1
-		: kbd_store_ptr - 1)->kind) == BUFFER_SWITCH_EVENT)
+  /* Don't insert two BUFFER_SWITCH_EVENT's in a row, and the like.  */
+  else if (kbd_buffer_coalesce (event))
     return;
 
   if (kbd_store_ptr - kbd_buffer == KBD_BUFFER_SIZE)
@@ -3409,8 +3492,13 @@ kbd_buffer_store_buffered_event (union buffered_input_event *event,
   if (kbd_fetch_ptr - 1 != kbd_store_ptr)
     {
       *kbd_store_ptr = *event;
+      kbd_buffer_stored_at[kbd_store_ptr - kbd_buffer] = current_timespec ();
       ++kbd_store_ptr;
-      if (kbd_buffer_nr_stored () > KBD_BUFFER_SIZE / 2
+      kbd_buffer_stats.stored++;
+      int nr_stored = kbd_buffer_nr_stored ();
+      kbd_buffer_stats.max_length = max (kbd_buffer_stats.max_length,
+					 nr_stored);
+      if (nr_stored > KBD_BUFFER_SIZE / 2
 	  && ! kbd_on_hold_p ())
         {
           /* Don't read keyboard input until we have processed kbd_buffer.
@@ -3420,6 +3508,8 @@ kbd_buffer_store_buffered_event (union buffered_input_event *event,
           stop_polling ();
         }
     }
+  else
+    kbd_buffer_stats.dropped++;
 
   Lisp_Object ignore_event;
 
@@ -3457,6 +3547,7 @@ kbd_buffer_unget_event (struct selection_input_event *event)
   if (kp != kbd_store_ptr)
     {
       kp->sie = *event;
+      kbd_buffer_stored_at[kp - kbd_buffer] = current_timespec ();
       kbd_fetch_ptr = kp;
     }
 }
@@ -3734,6 +3825,7 @@ kbd_buffer_get_event (KBOARD **kbp,
 	     since otherwise swallow_events will see it
 	     and process it again.  */
 	  struct selection_input_event copy = event->sie;
+	  kbd_buffer_note_read (event);
 	  kbd_fetch_ptr = event + 1;
 	  input_pending = readable_events (0);
 	  x_handle_selection_event (&copy);
@@ -3749,6 +3841,7 @@ kbd_buffer_get_event (KBOARD **kbp,
     || defined (HAVE_NS) || defined (USE_GTK)
       case MENU_BAR_ACTIVATE_EVENT:
 	{
+	  kbd_buffer_note_read (event);
 	  kbd_fetch_ptr = event + 1;
 	  input_pending = readable_events (0);
 	  if (FRAME_LIVE_P (XFRAME (event->ie.frame_or_window)))
@@ -3791,6 +3884,7 @@ kbd_buffer_get_event (KBOARD **kbp,
       case SELECT_WINDOW_EVENT:
         {
           obj = make_lispy_event (&event->ie);
+          kbd_buffer_note_read (event);
           kbd_fetch_ptr = event + 1;
         }
         break;
@@ -3845,6 +3939,7 @@ kbd_buffer_get_event (KBOARD **kbp,
 
 	      /* Wipe out this event, to catch bugs.  */
 	      clear_event (&event->ie);
+	      kbd_buffer_note_read (event);
 	      kbd_fetch_ptr = event + 1;
 	    }
 	}
@@ -3906,6 +4001,32 @@ kbd_buffer_get_event (KBOARD **kbp,
   return (obj);
 }
 
+#ifdef HAVE_X11
+
+/* Move the elements of BASE, a cyclic array of KBD_BUFFER_SIZE
+   elements of SIZE bytes, from index BEG up to END one slot to the
+   right, overwriting the element at END.  */
+
+static void
+shift_right_cyclically (void *base, size_t size, ptrdiff_t beg, ptrdiff_t end)
+{
+  char *p = base;
+
+  if (end > beg)
+    memmove (p + (beg + 1) * size, p + beg * size, (end - beg) * size);
+  else if (end < beg)
+    {
+      if (end > 0)
+	memmove (p + size, p, end * size);
+      memcpy (p, p + (KBD_BUFFER_SIZE - 1) * size, size);
+      if (beg < KBD_BUFFER_SIZE - 1)
+	memmove (p + (beg + 1) * size, p + beg * size,
+		 (KBD_BUFFER_SIZE - 1 - beg) * size);
+    }
+}
+
+#endif
+
 /* Process any non-user-visible events (currently X selection events),
    without reading any user-visible events.  */
 
@@ -3936,22 +4057,14 @@ process_special_events (void)
 	     cyclically.  */
 
 	  struct selection_input_event copy = event->sie;
-	  union buffered_input_event *beg
-	    = (kbd_fetch_ptr == kbd_buffer + KBD_BUFFER_SIZE)
-	    ? kbd_buffer : kbd_fetch_ptr;
+	  ptrdiff_t beg = (kbd_fetch_ptr == kbd_buffer + KBD_BUFFER_SIZE
+			   ? 0 : kbd_fetch_ptr - kbd_buffer);
 
-	  if (event > beg)
-	    memmove (beg + 1, beg, (event - beg) * sizeof *beg);
-	  else if (event < beg)
-	    {
-	      if (event > kbd_buffer)
-		memmove (kbd_buffer + 1, kbd_buffer,
-			 (event - kbd_buffer) * sizeof *kbd_buffer);
-	      *kbd_buffer = *(kbd_buffer + KBD_BUFFER_SIZE - 1);
-	      if (beg < kbd_buffer + KBD_BUFFER_SIZE - 1)
-		memmove (beg + 1, beg,
-			 (kbd_buffer + KBD_BUFFER_SIZE - 1 - beg) * sizeof *beg);
-	    }
+	  shift_right_cyclically (kbd_buffer, sizeof *kbd_buffer,
+				  beg, event - kbd_buffer);
+	  shift_right_cyclically (kbd_buffer_stored_at,
+				  sizeof *kbd_buffer_stored_at,
+				  beg, event - kbd_buffer);
 
 	  if (kbd_fetch_ptr == kbd_buffer + KBD_BUFFER_SIZE)
 	    kbd_fetch_ptr = kbd_buffer + 1;
@@ -4177,6 +4290,11 @@ timer_check_2 (Lisp_Object timers, Lisp_Object idle_timers)
 	      ASET (chosen_timer, 0, Qt);
 
 	      specbind (Qinhibit_quit, Qt);
+	      if (profiler_spans_running)
+		record_unwind_protect_int (profiler_span_end,
+					   profiler_span_begin
+					   (SPAN_TIMER, chosen_timer,
+					    AREF (chosen_timer, 5)));
 
 	      call1 (Qtimer_event_handler, chosen_timer);
 	      Vdeactivate_mark = old_deactivate_mark;
@@ -9911,6 +10029,46 @@ Also end any kbd macro being defined.  */)
 
   return Qnil;
 }
+
+DEFUN ("input-event-queue-statistics", Finput_event_queue_statistics,
+       Sinput_event_queue_statistics, 0, 1, 0,
+       doc: /* Return statistics about the queue of pending input events.
+The value is an alist of the following elements:
+
+  (stored . N)        number of events put in the queue,
+  (coalesced . N)     number of events merged into the one queued just
+                      before, like repeated help-echo or focus events,
+  (dropped . N)       number of events lost because the queue was full,
+  (read . N)          number of queued events read by the command loop,
+  (max-length . N)    most events that were waiting at once,
+  (mean-latency . S)  average time in seconds that an event read by the
+                      command loop waited in the queue,
+  (max-latency . S)   longest time in seconds that such an event waited.
+
+Keyboard macros and `unread-command-events' do not go through the
+queue.  If RESET is non-nil, start counting from zero again after
+returning the statistics.  */)
+  (Lisp_Object reset)
+{
+  double mean_latency
+    = (kbd_buffer_stats.read == 0 ? 0
+       : timespectod (kbd_buffer_stats.total_latency) / kbd_buffer_stats.read);
+  Lisp_Object stats
+    = nconc2 (list4 (Fcons (Qstored, make_number (kbd_buffer_stats.stored)),
+		     Fcons (Qcoalesced,
+			    make_number (kbd_buffer_stats.coalesced)),
+		     Fcons (Qdropped, make_number (kbd_buffer_stats.dropped)),
+		     Fcons (Qread, make_number (kbd_buffer_stats.read))),
+	      list3 (Fcons (Qmax_length,
+			    make_number (kbd_buffer_stats.max_length)),
+		     Fcons (Qmean_latency, make_float (mean_latency)),
+		     Fcons (Qmax_latency,
+			    make_float (timespectod
+					(kbd_buffer_stats.max_latency)))));
+  if (!NILP (reset))
+    memset (&kbd_buffer_stats, 0, sizeof kbd_buffer_stats);
+  return stats;
+}
 
 DEFUN ("suspend-emacs", Fsuspend_emacs, Ssuspend_emacs, 0, 1, "",
        doc: /* Stop Emacs and return to superior process.  You can resume later.
@@ -10668,6 +10826,13 @@ syms_of_keyboard (void)
   /* Tool-bars.  */
   DEFSYM (QCimage, ":image");
   DEFSYM (Qhelp_echo, "help-echo");
+
+  DEFSYM (Qstored, "stored");
+  DEFSYM (Qcoalesced, "coalesced");
+  DEFSYM (Qdropped, "dropped");
+  DEFSYM (Qmax_length, "max-length");
+  DEFSYM (Qmean_latency, "mean-latency");
+  DEFSYM (Qmax_latency, "max-latency");
   DEFSYM (QCrtl, ":rtl");
 
   staticpro (&item_properties);
@@ -10915,6 +11080,7 @@ syms_of_keyboard (void)
   defsubr (&Ssuspend_emacs);
   defsubr (&Srecursion_depth);
   defsubr (&Sdiscard_input);
+  defsubr (&Sinput_event_queue_statistics);
   defsubr (&Sopen_dribble_file);
   defsubr (&Sset_input_interrupt_mode);
   defsubr (&Sset_output_flow_control);
@@ -603,6 +603,7 @@ extern void char_table_set (Lisp_Object, int, Lisp_Object);
 
 /* Defined in data.c.  */
 extern _Noreturn void wrong_type_argument (Lisp_Object, Lisp_Object);
+extern EMACS_UINT symbol_function_epoch;
 
 #ifdef CANNOT_DUMP
 enum { might_dump = false };
@@ -2130,18 +2131,22 @@ struct Lisp_Hash_Table
      I-th entry is unused.  */
   Lisp_Object hash;
 
-  /* Vector used to chain entries.  If entry I is free, next[I] is the
-     entry number of the next free item.  If entry I is non-free,
-     next[I] is the index of the next entry in the collision chain,
-     or -1 if there is such entry.  */
+  /* Vector used to chain free entries.  If entry I is free, next[I]
+     is the entry number of the next free item, or -1 if there is no
+     such entry.  */
   Lisp_Object next;
 
-  /* Bucket vector.  An entry of -1 indicates no item is present,
-     and a nonnegative entry is the index of the first item in
-     a collision chain.  This vector's size can be larger than the
-     hash table size to reduce collisions.  */
+  /* Open-addressed index of the entries, whose size is a power of 2
+     larger than the hash table size.  An element of -1 indicates no
+     item is present; a nonnegative element holds the number of an
+     entry and a few bits of its hash code.  See HASH_INDEX in
+     fns.c.  */
   Lisp_Object index;
 
+  /* The previous index while the table is being resized incrementally,
+     otherwise nil.  */
+  Lisp_Object old_index;
+
   /* Only the fields above are traced normally by the GC.  The ones below
      `count' are special and are either ignored by the GC or traced in
      a special way (e.g. because of weakness).  */
@@ -2152,6 +2157,9 @@ struct Lisp_Hash_Table
   /* Index of first free entry in free list, or -1 if none.  */
   ptrdiff_t next_free;
 
+  /* Number of slots of old_index that have been moved to index.  */
+  ptrdiff_t migrated;
+
   /* True if the table can be purecopied.  The table cannot be
      changed afterwards.  */
   bool pure;
@@ -3143,6 +3151,8 @@ enum specbind_tag {
   SPECPDL_UNWIND_PTR,		/* Likewise, on void *.  */
   SPECPDL_UNWIND_INT,		/* Likewise, on int.  */
   SPECPDL_UNWIND_VOID,		/* Likewise, with no arg.  */
+  SPECPDL_UNWIND_EXCURSION,	/* Likewise, on an excursion.  */
+  SPECPDL_UNWIND_BUFFER,	/* Likewise, on the current buffer.  */
   SPECPDL_BACKTRACE,		/* An element of the backtrace.  */
   SPECPDL_LET,			/* A plain and simple dynamic let-binding.  */
   /* Tags greater than SPECPDL_LET must be "subkinds" of LET.  */
@@ -3172,6 +3182,14 @@ union specbinding
       ENUM_BF (specbind_tag) kind : CHAR_BIT;
       void (*func) (void);
     } unwind_void;
+    struct {
+      ENUM_BF (specbind_tag) kind : CHAR_BIT;
+      Lisp_Object marker, window;
+    } unwind_excursion;
+    struct {
+      ENUM_BF (specbind_tag) kind : CHAR_BIT;
+      Lisp_Object buffer;
+    } unwind_buffer;
     struct {
       ENUM_BF (specbind_tag) kind : CHAR_BIT;
       /* `where' is not used in the case of SPECPDL_LET.  */
@@ -3314,9 +3332,12 @@ set_symbol_declared_special(struct Lisp_Symbol *sym, bool value)
   sym->u.s.declared_special = value;
 }
 
+/* Every change to a function cell advances symbol_function_epoch,
+   which invalidates the definitions cached by Bcall.  */
 INLINE void
 set_symbol_function (Lisp_Object sym, Lisp_Object function)
 {
+  symbol_function_epoch++;
   XSYMBOL (sym)->u.s.function = function;
 }
 
@@ -3935,7 +3956,9 @@ extern Lisp_Object intern_driver (Lisp_Object, Lisp_Object, Lisp_Object);
 extern Lisp_Object intern_sym (Lisp_Object sym, Lisp_Object obarray, Lisp_Object index);
 extern void init_symbol (Lisp_Object, Lisp_Object);
 extern Lisp_Object oblookup (Lisp_Object, const char *, ptrdiff_t, ptrdiff_t);
+extern void obarray_unintern (Lisp_Object, Lisp_Object);
 extern Lisp_Object read_internal_start (Lisp_Object, Lisp_Object, Lisp_Object);
+extern Lisp_Object read_binary_definition (Lisp_Object, Lisp_Object);
 extern void loadhist_attach(Lisp_Object x);
 INLINE void
 LOADHIST_ATTACH (Lisp_Object x)
@@ -4027,6 +4050,8 @@ extern void record_unwind_protect (void (*) (Lisp_Object), Lisp_Object);
 extern void record_unwind_protect_ptr (void (*) (void *), void *);
 extern void record_unwind_protect_int (void (*) (int), int);
 extern void record_unwind_protect_void (void (*) (void));
+extern void record_unwind_protect_excursion (void);
+extern void record_unwind_current_buffer (void);
 extern void record_unwind_protect_nothing (void);
 extern void clear_unwind_protect (ptrdiff_t);
 extern void set_unwind_protect (ptrdiff_t, void (*) (Lisp_Object), Lisp_Object);
@@ -4051,7 +4076,7 @@ extern void prog_ignore (Lisp_Object);
 extern ptrdiff_t record_in_backtrace (Lisp_Object, Lisp_Object *, ptrdiff_t);
 extern void mark_specpdl (union specbinding *first, union specbinding *ptr);
 extern void grow_specpdl (void);
-extern void get_backtrace (Lisp_Object array);
+extern void get_backtrace (Lisp_Object array, ptrdiff_t start);
 Lisp_Object backtrace_top_function (void);
 extern bool let_shadows_buffer_binding_p (struct Lisp_Symbol *symbol);
 
@@ -4126,9 +4151,9 @@ extern void mark_threads (void);
 /* Defined in editfns.c.  */
 extern Lisp_Object styled_format (ptrdiff_t, Lisp_Object *, bool);
 extern void insert1 (Lisp_Object);
-extern Lisp_Object save_excursion_save (void);
+extern void save_excursion_save (union specbinding *);
 extern Lisp_Object save_restriction_save (void);
-extern void save_excursion_restore (Lisp_Object);
+extern void save_excursion_restore (Lisp_Object, Lisp_Object);
 extern void save_restriction_restore (Lisp_Object);
 extern _Noreturn void time_overflow (void);
 extern Lisp_Object make_buffer_string (ptrdiff_t, ptrdiff_t, bool);
@@ -4396,7 +4421,8 @@ extern void setup_process_coding_systems (Lisp_Object);
 #else
 # define CHILD_SETUP_TYPE int
 #endif
-extern CHILD_SETUP_TYPE child_setup (int, int, int, char **, bool, Lisp_Object);
+extern CHILD_SETUP_TYPE child_setup (int, int, int, char **, char **, bool,
+				      Lisp_Object);
 extern void init_callproc_1 (void);
 extern void init_callproc (void);
 extern void set_initial_environment (void);
@@ -4436,6 +4462,7 @@ extern void syms_of_macros (void);
 extern void truncate_undo_list (struct buffer *);
 extern void record_insert (ptrdiff_t, ptrdiff_t);
 extern void record_delete (ptrdiff_t, Lisp_Object, bool);
+extern void record_replacement (ptrdiff_t, Lisp_Object, ptrdiff_t);
 extern void record_first_change (void);
 extern void record_change (ptrdiff_t, ptrdiff_t);
 extern void record_property_change (ptrdiff_t, ptrdiff_t,
@@ -4615,6 +4642,16 @@ extern bool profiler_memory_running;
 extern Lisp_Object memory_log;
 extern Lisp_Object make_log (EMACS_INT heap_size, EMACS_INT max_stack_depth);
 extern void malloc_probe (size_t);
+extern bool profiler_allocation_running;
+extern void allocation_probe (Lisp_Object, size_t);
+extern void mark_allocation_samples (void);
+extern void sweep_allocation_samples (void);
+enum profiler_span_kind { SPAN_HOOK, SPAN_TIMER, SPAN_FILTER, SPAN_SENTINEL };
+extern bool profiler_spans_running;
+extern int profiler_span_begin (enum profiler_span_kind, Lisp_Object,
+				Lisp_Object);
+extern void profiler_span_end (int);
+extern void mark_profiler_spans (void);
 extern void syms_of_profiler (void);
 
 
@@ -4923,6 +4960,7 @@ maybe_gc (void)
 }
 
 Lisp_Object funcall_lambda (Lisp_Object, ptrdiff_t, Lisp_Object *);
+Lisp_Object funcall_with_definition (ptrdiff_t, Lisp_Object *, Lisp_Object);
 
 bool backtrace_debug_on_exit (union specbinding *pdl);
 
@@ -27,6 +27,7 @@ along with GNU Emacs.  If not, see <https://www.gnu.org/licenses/>.  */
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <sys/file.h>
+#include <dirent.h>
 #include <errno.h>
 #include <math.h>
 #include <stat-time.h>
@@ -56,6 +57,10 @@ along with GNU Emacs.  If not, see <https://www.gnu.org/licenses/>.  */
 
 #include <fcntl.h>
 
+#ifdef HAVE_MMAP
+#include <sys/mman.h>
+#endif
+
 #ifdef HAVE_FSEEKO
 #define file_offset off_t
 #define file_tell ftello
@@ -255,6 +260,16 @@ readchar (Lisp_Object readcharfun, bool *multibyte)
 
   if (EQ (readcharfun, Qget_file_char))
     {
+      /* Most of a compiled file is ASCII; take it straight from the
+	 contents read in by `load', without going through READBYTE.  */
+      if (unread_char < 0 && infile->lookahead == 0
+	  && infile->pos < infile->size
+	  && ASCII_CHAR_P (infile->contents[infile->pos]))
+	{
+	  if (multibyte)
+	    *multibyte = 1;
+	  return infile->contents[infile->pos++];
+	}
       readbyte = readbyte_from_file;
       goto read_multibyte;
     }
@@ -342,15 +357,82 @@ readchar (Lisp_Object readcharfun, bool *multibyte)
   (EQ (readcharfun, Qget_file_char)			\
    || EQ (readcharfun, Qget_emacs_mule_file_char))
 
+/* Bit masks for read_byte_class.  */
+enum
+  {
+    /* The byte can be part of a symbol name without quoting.  */
+    READ_SYMBOL_BYTE = 1,
+    /* The byte stands for itself inside a string.  */
+    READ_STRING_BYTE = 2
+  };
+
+/* For each byte, the READ_*_BYTE bits that describe it.  Only ASCII
+   bytes have any bits set.  */
+static unsigned char read_byte_class[256];
+
 static void
-skip_dyn_bytes (Lisp_Object readcharfun, ptrdiff_t n)
+init_read_byte_class (void)
 {
-  if (FROM_FILE_P (readcharfun))
+  for (int c = 0; c < 0200; c++)
+    read_byte_class[c]
+      = ((c > 040 && c != '\\' && !strchr ("\"';()[]#`,", c)
+	  ? READ_SYMBOL_BYTE : 0)
+	 | (c != '\\' && c != '"' ? READ_STRING_BYTE : 0));
+}
+
+/* If READCHARFUN is reading a file whose contents are in memory,
+   copy the longest run of bytes whose class includes CLASS, but no
+   more than SIZE bytes, from there to P.  Return the number of bytes
+   copied, each of which stands for one character.  */
+
+static ptrdiff_t
+read_file_run (Lisp_Object readcharfun, int class, char *p, ptrdiff_t size)
+{
+  if (! EQ (readcharfun, Qget_file_char)
+      || unread_char >= 0 || infile->lookahead != 0
+      || infile->pos == infile->size)
+    return 0;
+
+  unsigned char *s = infile->contents + infile->pos;
+  ptrdiff_t n = min (size, infile->size - infile->pos);
+  ptrdiff_t i = 0;
+  while (i < n && (read_byte_class[s[i]] & class))
+    i++;
+  memcpy (p, s, i);
+  infile->pos += i;
+  readchar_count += i;
+  return i;
+}
+
+/* Skip N bytes of the file being loaded, after any lookahead.  */
+
+static void
+skip_file_bytes (ptrdiff_t n)
+{
+  ptrdiff_t left = infile->size - infile->pos;
+  if (n <= left)
+    infile->pos += n;
+  else
     {
+      infile->pos = infile->size;
       block_input ();		/* FIXME: Not sure if it's needed.  */
-      fseek (infile->stream, n - infile->lookahead, SEEK_CUR);
+      fseek (infile->stream, n - left, SEEK_CUR);
       unblock_input ();
-      infile->lookahead = 0;
+    }
+}
+
+static void
+skip_dyn_bytes (Lisp_Object readcharfun, ptrdiff_t n)
+{
+  if (FROM_FILE_P (readcharfun))
+    {
+      if (n < infile->lookahead)
+	infile->lookahead -= n;
+      else
+	{
+	  skip_file_bytes (n - infile->lookahead);
+	  infile->lookahead = 0;
+	}
     }
   else
     { /* We're not reading directly from a file.  In that case, it's difficult
@@ -371,6 +453,7 @@ skip_dyn_eof (Lisp_Object readcharfun)
 {
   if (FROM_FILE_P (readcharfun))
     {
+      infile->pos = infile->size;
       block_input ();		/* FIXME: Not sure if it's needed.  */
       fseek (infile->stream, 0, SEEK_END);
       unblock_input ();
@@ -922,6 +1005,32 @@ suffix_p (Lisp_Object string, const char *suffix)
   return string_len >= suffix_len && !strcmp (SSDATA (string) + string_len - suffix_len, suffix);
 }
 
+/* Read the rest of IN's stream into memory, so that the reader can
+   take bytes from there without a call per byte.  Leave IN's
+   contents null if the stream is not a regular file.  */
+
+static void
+read_infile_contents (struct infile *in)
+{
+  struct stat st;
+
+  in->contents = NULL;
+  in->pos = in->size = 0;
+
+  file_offset offset = file_tell (in->stream);
+  if (offset < 0 || fstat (fileno (in->stream), &st) != 0
+      || ! S_ISREG (st.st_mode) || st.st_size <= offset
+      || min (PTRDIFF_MAX, SIZE_MAX) < st.st_size - offset)
+    return;
+
+  ptrdiff_t size = st.st_size - offset;
+  in->contents = xmalloc (size);
+  record_unwind_protect_ptr (xfree, in->contents);
+  block_input ();
+  in->size = fread (in->contents, 1, size, in->stream);
+  unblock_input ();
+}
+
 static void
 close_infile_unwind (void *arg)
 {
@@ -931,6 +1040,1082 @@ close_infile_unwind (void *arg)
   fclose (stream);
 }
 
+/* Binary compiled files.
+
+   `write-binary-compiled-file' converts a compiled file into one that
+   `load' can evaluate without parsing printed Lisp.  The file starts
+   with a header that `safe_to_load_version' accepts, with ELB_VERSION
+   as its version, followed by a ^_ and the file's top-level forms,
+   each one encoded as an object:
+
+     ELB_NIL, ELB_T		nil and t
+     ELB_FIXNUM N		an integer, zigzag encoded
+     ELB_FLOAT B...		a float as an IEEE double, low byte first
+     ELB_SYMBOL S		the interned symbol named S
+     ELB_UNINTERNED S		a new uninterned symbol named S
+     ELB_STRING S		the string S
+     ELB_LIST N X... TAIL	a list of N elements ending in TAIL
+     ELB_VECTOR N X...		a vector of N elements
+     ELB_COMPILED N X...	a byte-code object of N slots
+     ELB_LAZY N L BODY X...	a byte-code object whose byte code and
+				constants are in BODY, L bytes long,
+				followed by its N - 2 other slots
+     ELB_DOC L TEXT		a (FILE . POSITION) reference to a doc
+				string, as in other compiled files
+     ELB_SHARE X		X, which is referred to again by ELB_REF
+     ELB_REF I			the Ith object marked with ELB_SHARE
+     ELB_TEXT S			a form that could not be encoded, as
+				printed text to `read'
+
+   N, L and I are unsigned LEB128 numbers.  A string S is the number of
+   its characters times two, plus one if it is multibyte, then the
+   number of its bytes if it is multibyte, then its bytes.  TEXT is the
+   quoted text of the doc string between two ^_, where `get_doc_string'
+   finds it.  BODY is ELB_BODY followed by H, a hash of the rest of
+   BODY, then the byte code string and the constants vector; it
+   numbers its shared objects separately from the form around it.
+   Each top-level form starts numbering afresh.
+
+   `load' maps the file into memory and evaluates its forms with
+   readevalloop, as for other compiled files.  `read' decodes them
+   from the mapping, copying each string out of it in one go.  The byte code of
+   a function defined by a top-level `defalias' stays in the file until
+   the function is first called, when `fetch-bytecode' finds it at the
+   negative position in (FILE . -POSITION), its byte code slot.  Its
+   constants slot holds H until then, so that a function whose file
+   was replaced since it was loaded is not given another body.  The
+   mappings of the files loaded last are kept for this.  */
+
+enum elb_tag
+  {
+    ELB_NIL, ELB_T, ELB_FIXNUM, ELB_FLOAT, ELB_SYMBOL, ELB_UNINTERNED,
+    ELB_STRING, ELB_LIST, ELB_VECTOR, ELB_COMPILED, ELB_LAZY, ELB_BODY,
+    ELB_DOC, ELB_SHARE, ELB_REF, ELB_TEXT
+  };
+
+enum
+  {
+    /* The version byte in the header, which tells binary compiled
+       files from the files the byte compiler writes.  */
+    ELB_VERSION = 0x7f,
+    /* The number of files whose mappings are kept.  */
+    ELB_MAPPINGS = 4
+  };
+
+static char const elb_header[]
+  = (";ELC\177\0\0\0\n"
+     ";;; in Emacs version " PACKAGE_VERSION ", binary format\n\037");
+
+/* A binary compiled file mapped into memory.  */
+struct elb_mapping
+{
+  /* The encoded file name, or null if the entry is unused.  */
+  char *name;
+
+  /* The file's modification time and size when it was mapped.  If
+     they change, the file is mapped afresh.  */
+  struct timespec mtime;
+  off_t size;
+
+  unsigned char *contents;
+};
+
+/* The files whose forms or function bodies were decoded most recently,
+   most recent first.  */
+static struct elb_mapping elb_mappings[ELB_MAPPINGS];
+
+/* Map SIZE bytes of the file open on FD into memory, and return their
+   address, or null if that fails.  */
+
+static unsigned char *
+elb_map_file (int fd, off_t size)
+{
+#ifdef HAVE_MMAP
+  void *contents = mmap (NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  return contents == MAP_FAILED ? NULL : contents;
+#else
+  unsigned char *contents = xmalloc (size);
+  ptrdiff_t nread = 0;
+  while (nread < size)
+    {
+      ptrdiff_t n = emacs_read_quit (fd, contents + nread, size - nread);
+      if (n <= 0)
+	{
+	  xfree (contents);
+	  return NULL;
+	}
+      nread += n;
+    }
+  return contents;
+#endif
+}
+
+static void
+elb_unmap (struct elb_mapping *m)
+{
+  if (m->name)
+    {
+#ifdef HAVE_MMAP
+      munmap (m->contents, m->size);
+#else
+      xfree (m->contents);
+#endif
+      xfree (m->name);
+      m->name = NULL;
+    }
+}
+
+/* Put the mapping ARG of a file that has just been loaded in front of
+   the others, in place of an older mapping of the same file or of the
+   least recently used one.  */
+
+static void
+elb_keep_mapping (void *arg)
+{
+  struct elb_mapping *m = arg;
+  int i;
+
+  for (i = 0; i < ELB_MAPPINGS - 1; i++)
+    if (elb_mappings[i].name && !strcmp (elb_mappings[i].name, m->name))
+      break;
+  elb_unmap (&elb_mappings[i]);
+  memmove (elb_mappings + 1, elb_mappings, i * sizeof *elb_mappings);
+  elb_mappings[0] = *m;
+}
+
+/* Return the mapping of the binary compiled file NAME, mapping it if
+   it is not mapped yet or has changed since.  Return null if the file
+   cannot be mapped.  */
+
+static struct elb_mapping *
+elb_file_mapping (char const *name)
+{
+  struct stat st;
+  int i;
+
+  if (stat (name, &st) != 0)
+    return NULL;
+
+  for (i = 0; i < ELB_MAPPINGS - 1; i++)
+    if (elb_mappings[i].name && !strcmp (elb_mappings[i].name, name))
+      break;
+
+  /* Move the entry found, or the least recently used one, to the
+     front.  */
+  struct elb_mapping m = elb_mappings[i];
+  memmove (elb_mappings + 1, elb_mappings, i * sizeof *elb_mappings);
+  elb_mappings[0] = m;
+
+  if (m.name && !strcmp (m.name, name) && m.size == st.st_size
+      && timespec_cmp (m.mtime, get_stat_mtime (&st)) == 0)
+    return &elb_mappings[0];
+
+  elb_unmap (&elb_mappings[0]);
+
+  int fd = emacs_open (name, O_RDONLY, 0);
+  if (fd < 0)
+    return NULL;
+  unsigned char *contents = NULL;
+  if (fstat (fd, &st) == 0 && S_ISREG (st.st_mode) && 0 < st.st_size
+      && st.st_size <= min (PTRDIFF_MAX, SIZE_MAX))
+    contents = elb_map_file (fd, st.st_size);
+  emacs_close (fd);
+  if (!contents)
+    return NULL;
+
+  elb_mappings[0].name = xstrdup (name);
+  elb_mappings[0].mtime = get_stat_mtime (&st);
+  elb_mappings[0].size = st.st_size;
+  elb_mappings[0].contents = contents;
+  return &elb_mappings[0];
+}
+
+/* The state of decoding a binary compiled file.  */
+struct elb_reader
+{
+  /* The file's contents, the next byte to decode and the end.  */
+  unsigned char const *contents, *p, *end;
+
+  /* The file name, for doc string and function body references.  */
+  Lisp_Object file;
+
+  /* The objects marked with ELB_SHARE so far, and their number.  */
+  Lisp_Object shared;
+  ptrdiff_t nshared;
+};
+
+/* The binary compiled file being loaded, whose forms `read' decodes
+   when its stream is get-binary-file-object, or null.  */
+static struct elb_reader *elb_input;
+
+static _Noreturn void
+elb_invalid (struct elb_reader *r)
+{
+  error ("Invalid data in binary compiled file %s", SDATA (r->file));
+}
+
+static int
+elb_read_byte (struct elb_reader *r)
+{
+  if (r->p == r->end)
+    elb_invalid (r);
+  return *r->p++;
+}
+
+static EMACS_UINT
+elb_read_uint (struct elb_reader *r)
+{
+  EMACS_UINT n = 0;
+
+  for (int shift = 0; ; shift += 7)
+    {
+      int c = elb_read_byte (r);
+      if (EMACS_UINT_WIDTH <= shift)
+	elb_invalid (r);
+      n |= (EMACS_UINT) (c & 0x7f) << shift;
+      if (c < 0x80)
+	return n;
+    }
+}
+
+/* Read a count of elements or bytes to come, each taking at least a
+   byte.  */
+
+static ptrdiff_t
+elb_read_count (struct elb_reader *r)
+{
+  EMACS_UINT n = elb_read_uint (r);
+  if (r->end - r->p < n)
+    elb_invalid (r);
+  return n;
+}
+
+/* Read a string's characters.  Store their numbers of characters and
+   bytes in *NCHARS and *NBYTES, whether they are multibyte in
+   *MULTIBYTE, and return their address in the file.  */
+
+static char const *
+elb_read_chars (struct elb_reader *r, ptrdiff_t *nchars, ptrdiff_t *nbytes,
+		bool *multibyte)
+{
+  EMACS_UINT n = elb_read_uint (r);
+  *multibyte = n & 1;
+  if (r->end - r->p < n >> 1)
+    elb_invalid (r);
+  *nchars = n >> 1;
+  *nbytes = *multibyte ? elb_read_count (r) : *nchars;
+  if (r->end - r->p < *nbytes || *nbytes < *nchars)
+    elb_invalid (r);
+  char const *chars = (char const *) r->p;
+  r->p += *nbytes;
+  return chars;
+}
+
+static Lisp_Object
+elb_read_object (struct elb_reader *r)
+{
+  ptrdiff_t nchars, nbytes;
+  bool multibyte;
+  char const *chars;
+
+  int tag = elb_read_byte (r);
+
+  switch (tag)
+    {
+    case ELB_NIL:
+      return Qnil;
+
+    case ELB_T:
+      return Qt;
+
+    case ELB_FIXNUM:
+      {
+	EMACS_UINT n = elb_read_uint (r);
+	EMACS_INT i = n & 1 ? ~ (EMACS_INT) (n >> 1) : (EMACS_INT) (n >> 1);
+	if (FIXNUM_OVERFLOW_P (i))
+	  elb_invalid (r);
+	return make_number (i);
+      }
+
+    case ELB_FLOAT:
+      {
+	uint64_t bits = 0;
+	double d;
+	verify (sizeof d == sizeof bits);
+	for (int i = 0; i < sizeof bits; i++)
+	  bits |= (uint64_t) elb_read_byte (r) << (CHAR_BIT * i);
+	memcpy (&d, &bits, sizeof d);
+	return make_float (d);
+      }
+
+    case ELB_SYMBOL:
+      {
+	chars = elb_read_chars (r, &nchars, &nbytes, &multibyte);
+	Lisp_Object obarray = check_obarray (Vobarray);
+	Lisp_Object tem = oblookup (obarray, chars, nchars, nbytes);
+	if (SYMBOLP (tem))
+	  return tem;
+	return intern_driver (make_specified_string (chars, nchars, nbytes,
+						     multibyte),
+			      obarray, tem);
+      }
+
+    case ELB_UNINTERNED:
+      chars = elb_read_chars (r, &nchars, &nbytes, &multibyte);
+      return Fmake_symbol (make_specified_string (chars, nchars, nbytes,
+						  multibyte));
+
+    case ELB_STRING:
+      chars = elb_read_chars (r, &nchars, &nbytes, &multibyte);
+      return make_specified_string (chars, nchars, nbytes, multibyte);
+
+    case ELB_LIST:
+      {
+	ptrdiff_t n = elb_read_count (r);
+	if (n == 0)
+	  elb_invalid (r);
+	Lisp_Object list = Fcons (elb_read_object (r), Qnil);
+	Lisp_Object tail = list;
+	while (--n > 0)
+	  {
+	    XSETCDR (tail, Fcons (elb_read_object (r), Qnil));
+	    tail = XCDR (tail);
+	  }
+	XSETCDR (tail, elb_read_object (r));
+	return list;
+      }
+
+    case ELB_VECTOR:
+    case ELB_COMPILED:
+      {
+	bool compiled = tag == ELB_COMPILED;
+	ptrdiff_t n = elb_read_count (r);
+	if (compiled && n <= COMPILED_STACK_DEPTH)
+	  elb_invalid (r);
+	Lisp_Object vector = Fmake_vector (make_number (n), Qnil);
+	for (ptrdiff_t i = 0; i < n; i++)
+	  ASET (vector, i, elb_read_object (r));
+	if (compiled)
+	  make_byte_code (XVECTOR (vector));
+	return vector;
+      }
+
+    case ELB_LAZY:
+      {
+	ptrdiff_t n = elb_read_count (r);
+	if (n <= COMPILED_STACK_DEPTH)
+	  elb_invalid (r);
+	ptrdiff_t len = elb_read_count (r);
+	EMACS_INT pos = r->p - r->contents;
+	unsigned char const *body_end = r->p + len;
+	if (elb_read_byte (r) != ELB_BODY)
+	  elb_invalid (r);
+	EMACS_UINT hash = elb_read_uint (r);
+	if (MOST_POSITIVE_FIXNUM < hash || body_end < r->p)
+	  elb_invalid (r);
+	r->p = body_end;
+	Lisp_Object fun = Fmake_vector (make_number (n), Qnil);
+	ASET (fun, COMPILED_BYTECODE, Fcons (r->file, make_number (- pos)));
+	ASET (fun, COMPILED_CONSTANTS, make_number (hash));
+	for (ptrdiff_t i = 0; i < n; i++)
+	  if (i != COMPILED_BYTECODE && i != COMPILED_CONSTANTS)
+	    ASET (fun, i, elb_read_object (r));
+	make_byte_code (XVECTOR (fun));
+	return fun;
+      }
+
+    case ELB_DOC:
+      {
+	EMACS_UINT n = elb_read_uint (r);
+	if (r->end - r->p < n >> 1 || n >> 1 < 2)
+	  elb_invalid (r);
+	EMACS_INT pos = r->p + 1 - r->contents;
+	r->p += n >> 1;
+	return Fcons (r->file, make_number (n & 1 ? - pos : pos));
+      }
+
+    case ELB_SHARE:
+      {
+	ptrdiff_t i = r->nshared++;
+	if (ASIZE (r->shared) <= i)
+	  r->shared = larger_vector (r->shared, 1, -1);
+	Lisp_Object obj = elb_read_object (r);
+	ASET (r->shared, i, obj);
+	return obj;
+      }
+
+    case ELB_REF:
+      {
+	EMACS_UINT i = elb_read_uint (r);
+	if (r->nshared <= i)
+	  elb_invalid (r);
+	return AREF (r->shared, i);
+      }
+
+    case ELB_TEXT:
+      chars = elb_read_chars (r, &nchars, &nbytes, &multibyte);
+      return Fcar (Fread_from_string (make_specified_string (chars, nchars,
+							      nbytes,
+							      multibyte),
+				      Qnil, Qnil));
+
+    default:
+      elb_invalid (r);
+    }
+}
+
+/* Return the byte code and constants, as a cons cell, of a function
+   loaded from a binary compiled file, given its byte code slot REF,
+   (FILE . -POSITION), and its constants slot HASH.  Return nil if the
+   file cannot be read, or no longer has that body there.  */
+
+Lisp_Object
+read_binary_definition (Lisp_Object ref, Lisp_Object hash)
+{
+  Lisp_Object file = XCAR (ref);
+  if (!STRINGP (file))
+    return Qnil;
+
+  struct elb_mapping *m = elb_file_mapping (SSDATA (ENCODE_FILE (file)));
+  EMACS_INT pos = - XINT (XCDR (ref));
+  if (!m || pos <= 0 || m->size <= pos)
+    return Qnil;
+
+  struct elb_reader r = { m->contents, m->contents + pos,
+			  m->contents + m->size, file,
+			  Fmake_vector (make_number (16), Qnil), 0 };
+  if (elb_read_byte (&r) != ELB_BODY
+      || ! (INTEGERP (hash) && elb_read_uint (&r) == XINT (hash)))
+    return Qnil;
+  Lisp_Object bytecode = elb_read_object (&r);
+  return Fcons (bytecode, elb_read_object (&r));
+}
+
+static void
+elb_restore_input (void *arg)
+{
+  elb_input = arg;
+}
+
+/* Return the next top-level form of the binary compiled file that R
+   decodes.  */
+
+static Lisp_Object
+elb_read_form (struct elb_reader *r)
+{
+  r->nshared = 0;
+  return elb_read_object (r);
+}
+
+/* Evaluate the forms of the binary compiled file open on STREAM.
+   SOURCENAME is its name for `load-history'.  The forms are evaluated
+   by readevalloop, as those of other compiled files are, reading them
+   with `load-read-function' from the stream get-binary-file-object.  */
+
+static void
+load_binary_file (FILE *stream, Lisp_Object sourcename)
+{
+  ptrdiff_t count = SPECPDL_INDEX ();
+  struct elb_mapping m;
+  struct stat st;
+
+  if (fstat (fileno (stream), &st) != 0)
+    report_file_error ("Reading binary compiled file", Vload_file_name);
+  if (! S_ISREG (st.st_mode) || st.st_size == 0
+      || min (PTRDIFF_MAX, SIZE_MAX) < st.st_size
+      || ! (m.contents = elb_map_file (fileno (stream), st.st_size)))
+    error ("Cannot map binary compiled file %s", SDATA (Vload_file_name));
+  m.name = xstrdup (SSDATA (ENCODE_FILE (Vload_file_name)));
+  m.mtime = get_stat_mtime (&st);
+  m.size = st.st_size;
+  record_unwind_protect_ptr (elb_keep_mapping, &m);
+
+  struct elb_reader r = { m.contents, m.contents, m.contents + m.size,
+			  Vload_file_name,
+			  Fmake_vector (make_number (16), Qnil), 0 };
+  r.p = memchr (m.contents, '\037', min (m.size, 512));
+  if (!r.p)
+    elb_invalid (&r);
+  r.p++;
+
+  record_unwind_protect_ptr (elb_restore_input, elb_input);
+  elb_input = &r;
+  readevalloop (Qget_binary_file_object, NULL, sourcename,
+		0, Qnil, Qnil, Qnil, Qnil);
+  unbind_to (count, Qnil);
+}
+
+/* The state of encoding a binary compiled file.  */
+struct elb_writer
+{
+  /* The encoded file so far.  */
+  unsigned char *buf;
+  ptrdiff_t size, len;
+
+  /* The name of the compiled file being converted, which its doc
+     string references use.  */
+  Lisp_Object file;
+
+  /* Hash tables mapping the objects of the form being encoded that
+     can be shared to the number of references to them, and to the
+     number given to them by ELB_SHARE, and the number of these.  */
+  Lisp_Object counts, indices;
+  ptrdiff_t nshared;
+
+  /* The function in the form whose body is to be loaded lazily, or
+     nil.  */
+  Lisp_Object lazy;
+};
+
+static void
+elb_free_writer (void *arg)
+{
+  struct elb_writer *w = arg;
+  xfree (w->buf);
+}
+
+static void
+elb_write_bytes (struct elb_writer *w, void const *bytes, ptrdiff_t n)
+{
+  if (w->size - w->len < n)
+    w->buf = xpalloc (w->buf, &w->size, n - (w->size - w->len), -1, 1);
+  memcpy (w->buf + w->len, bytes, n);
+  w->len += n;
+}
+
+static void
+elb_write_byte (struct elb_writer *w, int c)
+{
+  unsigned char byte = c;
+  elb_write_bytes (w, &byte, 1);
+}
+
+/* Store N in BUF as an unsigned LEB128 number, and return the number
+   of bytes used.  */
+
+static int
+elb_encode_uint (unsigned char buf[INT_BUFSIZE_BOUND (EMACS_UINT)],
+		 EMACS_UINT n)
+{
+  int len = 0;
+  for (; 0x80 <= n; n >>= 7)
+    buf[len++] = (n & 0x7f) | 0x80;
+  buf[len++] = n;
+  return len;
+}
+
+static void
+elb_write_uint (struct elb_writer *w, EMACS_UINT n)
+{
+  unsigned char buf[INT_BUFSIZE_BOUND (EMACS_UINT)];
+  elb_write_bytes (w, buf, elb_encode_uint (buf, n));
+}
+
+static void
+elb_write_chars (struct elb_writer *w, Lisp_Object string)
+{
+  bool multibyte = STRING_MULTIBYTE (string);
+  elb_write_uint (w, (EMACS_UINT) SCHARS (string) << 1 | multibyte);
+  if (multibyte)
+    elb_write_uint (w, SBYTES (string));
+  elb_write_bytes (w, SDATA (string), SBYTES (string));
+}
+
+static Lisp_Object
+elb_hash_table (void)
+{
+  return make_hash_table (hashtest_eq, DEFAULT_HASH_SIZE,
+			  DEFAULT_REHASH_SIZE, DEFAULT_REHASH_THRESHOLD,
+			  Qnil, false);
+}
+
+static bool
+elb_shareable_p (Lisp_Object obj)
+{
+  return (CONSP (obj) || STRINGP (obj) || VECTORLIKEP (obj)
+	  || (SYMBOLP (obj) && !SYMBOL_INTERNED_P (obj)));
+}
+
+/* Count the references to the objects in OBJ that can be shared in
+   the hash table COUNTS.  Return false if OBJ is circular.  */
+
+static bool
+elb_count (Lisp_Object counts, Lisp_Object obj)
+{
+  struct Lisp_Hash_Table *h = XHASH_TABLE (counts);
+  Lisp_Object list = obj;
+
+  /* An object whose parts are being counted has a count of zero.  */
+  while (elb_shareable_p (obj))
+    {
+      EMACS_UINT hash;
+      ptrdiff_t i = hash_lookup (h, obj, &hash);
+      if (0 <= i)
+	{
+	  EMACS_INT n = XINT (HASH_VALUE (h, i));
+	  if (n == 0)
+	    return false;
+	  set_hash_value_slot (h, i, make_number (n + 1));
+	  break;
+	}
+      hash_put (h, obj, make_number (0), hash);
+      if (CONSP (obj))
+	{
+	  if (! elb_count (counts, XCAR (obj)))
+	    return false;
+	  obj = XCDR (obj);
+	  continue;
+	}
+      if (VECTORP (obj) || COMPILEDP (obj))
+	{
+	  ptrdiff_t size = VECTORP (obj) ? ASIZE (obj) : PVSIZE (obj);
+	  for (ptrdiff_t j = 0; j < size; j++)
+	    if (! elb_count (counts, AREF (obj, j)))
+	      return false;
+	}
+      set_hash_value_slot (h, hash_lookup (h, obj, NULL), make_number (1));
+      break;
+    }
+
+  /* The cells of the list counted above are done too.  */
+  for (; CONSP (list); list = XCDR (list))
+    {
+      ptrdiff_t i = hash_lookup (h, list, NULL);
+      if (XINT (HASH_VALUE (h, i)) != 0)
+	break;
+      set_hash_value_slot (h, i, make_number (1));
+    }
+  return true;
+}
+
+static bool
+elb_shared_p (struct elb_writer *w, Lisp_Object obj)
+{
+  struct Lisp_Hash_Table *h = XHASH_TABLE (w->counts);
+  ptrdiff_t i = hash_lookup (h, obj, NULL);
+  return 0 <= i && 1 < XINT (HASH_VALUE (h, i));
+}
+
+static bool elb_write_object (struct elb_writer *, Lisp_Object);
+
+/* Append the doc string that REF refers to in the compiled file being
+   converted.  */
+
+static bool
+elb_write_doc (struct elb_writer *w, Lisp_Object ref)
+{
+  Lisp_Object doc = get_doc_string (ref, false, false);
+  if (!STRINGP (doc))
+    return false;
+
+  /* Quote the text as `get_doc_string' expects it.  */
+  USE_SAFE_ALLOCA;
+  unsigned char *text = SAFE_ALLOCA (2 * SBYTES (doc) + 2);
+  ptrdiff_t len = 0;
+  text[len++] = '\037';
+  for (ptrdiff_t i = 0; i < SBYTES (doc); i++)
+    {
+      unsigned char c = SREF (doc, i);
+      if (c == 1 || c == 0 || c == '\037')
+	{
+	  text[len++] = 1;
+	  c = c == 1 ? 1 : c == 0 ? '0' : '_';
+	}
+      text[len++] = c;
+    }
+  text[len++] = '\037';
+
+  elb_write_byte (w, ELB_DOC);
+  elb_write_uint (w, (EMACS_UINT) len << 1 | (XINT (XCDR (ref)) < 0));
+  elb_write_bytes (w, text, len);
+  SAFE_FREE ();
+  return true;
+}
+
+/* Append CODE, the byte code and constants of a function, as a body
+   with its own shared objects and its hash, preceded by its length.  */
+
+static bool
+elb_write_body (struct elb_writer *w, Lisp_Object code)
+{
+  Lisp_Object counts = w->counts, indices = w->indices;
+  ptrdiff_t nshared = w->nshared;
+  ptrdiff_t start = w->len;
+  bool ok;
+
+  w->counts = elb_hash_table ();
+  w->indices = elb_hash_table ();
+  w->nshared = 0;
+  ok = elb_count (w->counts, code);
+  ok = (ok
+	&& elb_write_object (w, XCAR (code))
+	&& elb_write_object (w, XCDR (code)));
+  w->counts = counts;
+  w->indices = indices;
+  w->nshared = nshared;
+  if (!ok)
+    return false;
+
+  /* Insert the length, the tag and the hash in front of the body.  */
+  unsigned char buf[1 + 2 * INT_BUFSIZE_BOUND (EMACS_UINT)];
+  unsigned char head[1 + INT_BUFSIZE_BOUND (EMACS_UINT)];
+  EMACS_UINT hash = (hash_string ((char const *) w->buf + start,
+				  w->len - start)
+		     & MOST_POSITIVE_FIXNUM);
+  head[0] = ELB_BODY;
+  int nhead = 1 + elb_encode_uint (head + 1, hash);
+  int n = elb_encode_uint (buf, nhead + w->len - start);
+  memcpy (buf + n, head, nhead);
+  n += nhead;
+  elb_write_bytes (w, buf, n);
+  memmove (w->buf + start + n, w->buf + start, w->len - n - start);
+  memcpy (w->buf + start, buf, n);
+  return true;
+}
+
+static bool
+elb_write_compiled (struct elb_writer *w, Lisp_Object fun)
+{
+  ptrdiff_t size = PVSIZE (fun);
+  Lisp_Object code = Qnil;
+
+  if (COMPILED_CONSTANTS < size)
+    {
+      code = AREF (fun, COMPILED_BYTECODE);
+      /* A function compiled with `byte-compile-dynamic' whose body is
+	 still in the file being converted.  */
+      if (CONSP (code))
+	{
+	  code = read_doc_string (code);
+	  if (!CONSP (code))
+	    return false;
+	}
+      else
+	code = Fcons (code, AREF (fun, COMPILED_CONSTANTS));
+    }
+
+  if (CONSP (code) && EQ (fun, w->lazy))
+    {
+      elb_write_byte (w, ELB_LAZY);
+      elb_write_uint (w, size);
+      if (! elb_write_body (w, code))
+	return false;
+    }
+  else
+    {
+      elb_write_byte (w, ELB_COMPILED);
+      elb_write_uint (w, size);
+    }
+
+  for (ptrdiff_t i = 0; i < size; i++)
+    if (CONSP (code) && (i == COMPILED_BYTECODE || i == COMPILED_CONSTANTS))
+      {
+	if (! (EQ (fun, w->lazy)
+	       || elb_write_object (w, (i == COMPILED_BYTECODE
+					? XCAR (code) : XCDR (code)))))
+	  return false;
+      }
+    else if (! elb_write_object (w, AREF (fun, i)))
+      return false;
+  return true;
+}
+
+/* Append OBJ.  Return false if it cannot be encoded.  */
+
+static bool
+elb_write_object (struct elb_writer *w, Lisp_Object obj)
+{
+  if (NILP (obj))
+    elb_write_byte (w, ELB_NIL);
+  else if (EQ (obj, Qt))
+    elb_write_byte (w, ELB_T);
+  else if (INTEGERP (obj))
+    {
+      EMACS_INT i = XINT (obj);
+      elb_write_byte (w, ELB_FIXNUM);
+      elb_write_uint (w, (i < 0
+			  ? ~ ((EMACS_UINT) i << 1)
+			  : (EMACS_UINT) i << 1));
+    }
+  else if (FLOATP (obj))
+    {
+      double d = XFLOAT_DATA (obj);
+      uint64_t bits;
+      memcpy (&bits, &d, sizeof bits);
+      elb_write_byte (w, ELB_FLOAT);
+      for (int i = 0; i < sizeof bits; i++)
+	elb_write_byte (w, bits >> (CHAR_BIT * i));
+    }
+  else if (SYMBOLP (obj) && SYMBOL_INTERNED_P (obj))
+    {
+      elb_write_byte (w, ELB_SYMBOL);
+      elb_write_chars (w, SYMBOL_NAME (obj));
+    }
+  else if (CONSP (obj) && EQ (XCAR (obj), w->file) && INTEGERP (XCDR (obj)))
+    return elb_write_doc (w, obj);
+  else if (!elb_shareable_p (obj))
+    return false;
+  else
+    {
+      if (elb_shared_p (w, obj))
+	{
+	  struct Lisp_Hash_Table *h = XHASH_TABLE (w->indices);
+	  EMACS_UINT hash;
+	  ptrdiff_t i = hash_lookup (h, obj, &hash);
+	  if (0 <= i)
+	    {
+	      elb_write_byte (w, ELB_REF);
+	      elb_write_uint (w, XINT (HASH_VALUE (h, i)));
+	      return true;
+	    }
+	  hash_put (h, obj, make_number (w->nshared++), hash);
+	  elb_write_byte (w, ELB_SHARE);
+	}
+
+      if (SYMBOLP (obj))
+	{
+	  elb_write_byte (w, ELB_UNINTERNED);
+	  elb_write_chars (w, SYMBOL_NAME (obj));
+	}
+      else if (STRINGP (obj))
+	{
+	  if (string_intervals (obj))
+	    return false;
+	  elb_write_byte (w, ELB_STRING);
+	  elb_write_chars (w, obj);
+	}
+      else if (CONSP (obj))
+	{
+	  /* Encode the cells up to one that is shared as a list.  */
+	  ptrdiff_t n = 1;
+	  Lisp_Object tail = XCDR (obj);
+	  for (; CONSP (tail) && !elb_shared_p (w, tail); tail = XCDR (tail))
+	    n++;
+	  elb_write_byte (w, ELB_LIST);
+	  elb_write_uint (w, n);
+	  for (; n > 0; n--, obj = XCDR (obj))
+	    if (! elb_write_object (w, XCAR (obj)))
+	      return false;
+	  return elb_write_object (w, tail);
+	}
+      else if (VECTORP (obj))
+	{
+	  elb_write_byte (w, ELB_VECTOR);
+	  elb_write_uint (w, ASIZE (obj));
+	  for (ptrdiff_t i = 0; i < ASIZE (obj); i++)
+	    if (! elb_write_object (w, AREF (obj, i)))
+	      return false;
+	}
+      else if (COMPILEDP (obj))
+	return elb_write_compiled (w, obj);
+      else
+	return false;
+    }
+  return true;
+}
+
+/* Return the function in FORM whose body can be loaded lazily, or nil.
+   That is a function given to a top-level `defalias', as a function or
+   as a macro, whose body shares no objects with the rest of FORM.  */
+
+static Lisp_Object
+elb_lazy_function (struct elb_writer *w, Lisp_Object form)
+{
+  Lisp_Object fun = Qnil;
+
+  if (CONSP (form) && EQ (XCAR (form), Qdefalias)
+      && CONSP (XCDR (form)) && CONSP (XCDR (XCDR (form))))
+    fun = XCAR (XCDR (XCDR (form)));
+  /* (cons 'macro FUNCTION).  */
+  if (CONSP (fun) && EQ (XCAR (fun), Qcons))
+    {
+      Lisp_Object kind = CAR_SAFE (CDR_SAFE (fun));
+      if (EQ (CAR_SAFE (kind), Qquote)
+	  && EQ (CAR_SAFE (CDR_SAFE (kind)), Qmacro))
+	fun = CAR_SAFE (CDR_SAFE (CDR_SAFE (fun)));
+    }
+  if (! (COMPILEDP (fun) && COMPILED_CONSTANTS < PVSIZE (fun)))
+    return Qnil;
+
+  Lisp_Object code = AREF (fun, COMPILED_BYTECODE);
+  if (CONSP (code))
+    return fun;
+
+  /* Every object in the body must be referred to from there only.  */
+  code = Fcons (code, AREF (fun, COMPILED_CONSTANTS));
+  Lisp_Object counts = elb_hash_table ();
+  elb_count (counts, code);
+  struct Lisp_Hash_Table *h = XHASH_TABLE (counts);
+  struct Lisp_Hash_Table *form_counts = XHASH_TABLE (w->counts);
+  for (ptrdiff_t i = 0; i < HASH_TABLE_SIZE (h); i++)
+    if (!NILP (HASH_HASH (h, i)) && !EQ (HASH_KEY (h, i), code))
+      {
+	ptrdiff_t j = hash_lookup (form_counts, HASH_KEY (h, i), NULL);
+	if (j < 0 || XINT (HASH_VALUE (form_counts, j))
+	    != XINT (HASH_VALUE (h, i)))
+	  return Qnil;
+      }
+  return fun;
+}
+
+/* Return the printed representation of FORM, for `read'.  */
+
+static Lisp_Object
+elb_print (Lisp_Object form)
+{
+  ptrdiff_t count = SPECPDL_INDEX ();
+  specbind (Qprint_circle, Qt);
+  specbind (Qprint_gensym, Qt);
+  specbind (Qprint_length, Qnil);
+  specbind (Qprint_level, Qnil);
+  specbind (Qprint_escape_newlines, Qnil);
+  return unbind_to (count, Fprin1_to_string (form, Qnil));
+}
+
+/* Restore the input stream and the unread character of a load that
+   `write-binary-compiled-file' was called from.  */
+
+static void
+elb_restore_infile (void *arg)
+{
+  infile = arg;
+}
+
+static void
+elb_restore_unread_char (int c)
+{
+  unread_char = c;
+}
+
+DEFUN ("write-binary-compiled-file", Fwrite_binary_compiled_file,
+       Swrite_binary_compiled_file, 1, 2, 0,
+       doc: /* Write the compiled Lisp file FILE in binary form to OUTFILE.
+OUTFILE defaults to FILE, which is then replaced.
+
+`load' evaluates a binary compiled file without parsing it as text.
+The bodies of the functions defined by `defalias' forms at top level
+are read from the file only when the functions are first called, the
+way `byte-compile-dynamic' does it.  Doc strings stay in the file as
+`byte-compile-dynamic-docstrings' leaves them.  Therefore, the functions
+that the file defines stop working if the file is moved or changed
+after loading it.
+
+Return OUTFILE.  */)
+  (Lisp_Object file, Lisp_Object outfile)
+{
+  ptrdiff_t count0 = SPECPDL_INDEX ();
+  Lisp_Object readcharfun = Qget_file_char;
+  int fd, version, c;
+
+  record_unwind_protect_ptr (elb_restore_infile, infile);
+  record_unwind_protect_int (elb_restore_unread_char, unread_char);
+
+  file = Fexpand_file_name (file, Qnil);
+  outfile = NILP (outfile) ? file : Fexpand_file_name (outfile, Qnil);
+
+  fd = emacs_open (SSDATA (ENCODE_FILE (file)), O_RDONLY, 0);
+  if (fd < 0)
+    report_file_error ("Opening input file", file);
+  ptrdiff_t count = SPECPDL_INDEX ();
+  record_unwind_protect_int (close_file_unwind, fd);
+  version = safe_to_load_version (fd);
+  if (version < 22 || version == ELB_VERSION)
+    error ("%s is not a compiled file that can be converted", SDATA (file));
+  FILE *stream = fdopen (fd, "r" FOPEN_BINARY);
+  if (!stream)
+    report_file_error ("Opening stdio stream", file);
+  set_unwind_protect_ptr (count, close_infile_unwind, stream);
+
+  struct infile input;
+  input.stream = stream;
+  input.lookahead = 0;
+  read_infile_contents (&input);
+  if (!input.contents)
+    error ("%s is not a regular file", SDATA (file));
+  infile = &input;
+  unread_char = -1;
+
+  struct elb_writer w = { NULL, 0, 0, file,
+			  elb_hash_table (), elb_hash_table (), 0, Qnil };
+  record_unwind_protect_ptr (elb_free_writer, &w);
+  elb_write_bytes (&w, elb_header, sizeof elb_header - 1);
+
+  /* Read the forms as `load' would, with (#$ . POSITION) references to
+     doc strings in FILE left in place.  */
+  specbind (Qload_file_name, file);
+  specbind (Qload_in_progress, Qt);
+  specbind (Qload_force_doc_strings, Qnil);
+  while (true)
+    {
+      c = READCHAR;
+      if (c == ';')
+	{
+	  while ((c = READCHAR) != '\n' && c != -1)
+	    continue;
+	  continue;
+	}
+      if (c < 0)
+	break;
+      if (c == ' ' || c == '\t' || c == '\n' || c == '\f' || c == '\r')
+	continue;
+      UNREAD (c);
+
+      struct infile form_start = input;
+      int form_unread_char = unread_char;
+      Lisp_Object form = read_internal_start (readcharfun, Qnil, Qnil);
+
+      /* Fetching a lazily loaded definition reads from elsewhere.  */
+      int next_unread_char = unread_char;
+      ptrdiff_t start = w.len;
+      hash_clear (XHASH_TABLE (w.counts));
+      hash_clear (XHASH_TABLE (w.indices));
+      w.nshared = 0;
+      bool ok = elb_count (w.counts, form);
+      if (ok)
+	{
+	  w.lazy = elb_lazy_function (&w, form);
+	  ok = elb_write_object (&w, form);
+	}
+      if (!ok)
+	{
+	  /* Read the form again, this time with its doc strings, and
+	     keep its text.  */
+	  ptrdiff_t count1 = SPECPDL_INDEX ();
+	  w.len = start;
+	  input = form_start;
+	  unread_char = form_unread_char;
+	  specbind (Qload_force_doc_strings, Qt);
+	  form = read_internal_start (readcharfun, Qnil, Qnil);
+	  unbind_to (count1, Qnil);
+	  elb_write_byte (&w, ELB_TEXT);
+	  elb_write_chars (&w, elb_print (form));
+	}
+      unread_char = next_unread_char;
+    }
+
+  /* Write to a new file, so that OUTFILE can be FILE, and so that
+     nobody sees it half written.  */
+  Lisp_Object temp = concat2 (outfile, build_string (".tmp"));
+  Lisp_Object encoded_temp = ENCODE_FILE (temp);
+  int out = emacs_open (SSDATA (encoded_temp),
+			O_WRONLY | O_CREAT | O_TRUNC, 0666);
+  if (out < 0)
+    report_file_error ("Opening output file", temp);
+  bool written = emacs_write_quit (out, w.buf, w.len) == w.len;
+  if (emacs_close (out) != 0)
+    written = false;
+  if (! written
+      || rename (SSDATA (encoded_temp), SSDATA (ENCODE_FILE (outfile))) != 0)
+    {
+      int err = errno;
+      unlink (SSDATA (encoded_temp));
+      errno = err;
+      report_file_error ("Writing binary compiled file", outfile);
+    }
+
+  return unbind_to (count0, outfile);
+}
+
 DEFUN ("load", Fload, Sload, 1, 5, 0,
        doc: /* Execute a file of Lisp code named FILE.
 First try FILE with `.elc' appended, then try with `.el', then try
@@ -1298,11 +2483,14 @@ Return t if the file exists and loads successfully.  */)
       emacs_abort ();
 #endif
     }
+  else if (version == ELB_VERSION)
+    load_binary_file (stream, hist_file_name);
   else
     {
       struct infile input;
       input.stream = stream;
       input.lookahead = 0;
+      read_infile_contents (&input);
       infile = &input;
 
       if (lisp_file_lexically_bound_p (Qget_file_char))
@@ -1381,6 +2569,134 @@ directories, make sure the PREDICATE function returns `dir-ok' for them.  */)
   return file;
 }
 
+/* The file names in the directories that `openp' has searched.  This
+   maps the encoded name of each directory to (MTIME . NAMES), where
+   MTIME is the directory's modification time and NAMES is a hash
+   table whose keys are the names of its files, with ASCII letters
+   downcased.  */
+static Lisp_Object load_dir_index;
+
+static void
+load_dir_index_unwind (void *d)
+{
+  closedir (d);
+}
+
+/* Return the NAMES table of DIR, an encoded directory name, reading
+   the directory if it has changed since it was last read.  Return t
+   if there is no such directory, and nil if its contents are not
+   known.  */
+
+static Lisp_Object
+load_dir_names (Lisp_Object dir)
+{
+  struct stat st;
+
+  if (stat (SSDATA (dir), &st) != 0)
+    return errno == ENOENT || errno == ENOTDIR ? Qt : Qnil;
+  if (! S_ISDIR (st.st_mode))
+    return Qt;
+
+  /* File systems with coarse timestamps may not change the
+     modification time of a directory that changes again soon after
+     it was read; wait before trusting its contents.  */
+  struct timespec mtime = get_stat_mtime (&st);
+  if (timespec_cmp (current_timespec (),
+		    timespec_add (mtime, make_timespec (2, 0)))
+      < 0)
+    return Qnil;
+
+  Lisp_Object stamp = make_lisp_time (mtime);
+  if (! HASH_TABLE_P (load_dir_index))
+    load_dir_index = make_hash_table (hashtest_equal, DEFAULT_HASH_SIZE,
+				      DEFAULT_REHASH_SIZE,
+				      DEFAULT_REHASH_THRESHOLD, Qnil, false);
+  struct Lisp_Hash_Table *h = XHASH_TABLE (load_dir_index);
+  EMACS_UINT hash;
+  ptrdiff_t i = hash_lookup (h, dir, &hash);
+  if (i >= 0 && !NILP (Fequal (XCAR (HASH_VALUE (h, i)), stamp)))
+    return XCDR (HASH_VALUE (h, i));
+
+  DIR *d = opendir (SSDATA (dir));
+  if (! d)
+    return Qnil;
+  ptrdiff_t count = SPECPDL_INDEX ();
+  record_unwind_protect_ptr (load_dir_index_unwind, d);
+
+  Lisp_Object names = make_hash_table (hashtest_equal, DEFAULT_HASH_SIZE,
+				       DEFAULT_REHASH_SIZE,
+				       DEFAULT_REHASH_THRESHOLD, Qnil, false);
+  struct Lisp_Hash_Table *hn = XHASH_TABLE (names);
+  while (true)
+    {
+      errno = 0;
+      struct dirent *dp = readdir (d);
+      if (! dp)
+	{
+	  if (errno != 0)
+	    names = Qnil;
+	  break;
+	}
+      Lisp_Object name = build_unibyte_string (dp->d_name);
+      for (ptrdiff_t j = 0; j < SBYTES (name); j++)
+	SSET (name, j, c_tolower (SREF (name, j)));
+      EMACS_UINT name_hash;
+      if (hash_lookup (hn, name, &name_hash) < 0)
+	hash_put (hn, name, Qt, name_hash);
+    }
+  unbind_to (count, Qnil);
+
+  if (! NILP (names))
+    {
+      if (i >= 0)
+	set_hash_value_slot (h, i, Fcons (stamp, names));
+      else
+	hash_put (h, dir, Fcons (stamp, names), hash);
+    }
+  return names;
+}
+
+/* Return true if the directory index shows that there is no file
+   named ENCODED_FN, an encoded absolute file name.  *NAMES caches
+   the NAMES table of the directory between calls for files in the
+   same directory; it should be unbound on the first call.  */
+
+static bool
+load_dir_lacks (Lisp_Object *names, Lisp_Object encoded_fn)
+{
+#ifdef DOS_NT
+  /* Files can also be opened by their short names.  */
+  return false;
+#endif
+  if (! load_path_use_index)
+    return false;
+
+  char *fn = SSDATA (encoded_fn);
+  char *base = strrchr (fn, '/');
+  if (! base || base == fn)
+    return false;
+  base++;
+
+  /* A file system could fold the case of ASCII letters, but it could
+     also normalize other characters.  */
+  ptrdiff_t len = SBYTES (encoded_fn) - (base - fn);
+  for (ptrdiff_t i = 0; i < len; i++)
+    if (! ASCII_CHAR_P (base[i]))
+      return false;
+
+  if (EQ (*names, Qunbound))
+    *names = load_dir_names (make_unibyte_string (fn, base - 1 - fn));
+  if (EQ (*names, Qt))
+    return true;
+  if (! HASH_TABLE_P (*names))
+    return false;
+
+  Lisp_Object name = make_uninit_string (len);
+  for (ptrdiff_t i = 0; i < len; i++)
+    SSET (name, i, c_tolower (base[i]));
+  return hash_lookup (XHASH_TABLE (*names), name, NULL) < 0;
+}
+
 /* Search for a file whose name is STR, looking in directories
    in the Lisp list PATH, and trying suffixes from SUFFIX.
    On success, return a file descriptor (or 1 or -2 as described below).
@@ -1446,6 +2762,7 @@ openp (Lisp_Object path, Lisp_Object str, Lisp_Object suffixes,
   for (; CONSP (path); path = XCDR (path))
     {
       ptrdiff_t baselen, prefixlen;
+      Lisp_Object dir_names = Qunbound;
 
       filename = Fexpand_file_name (str, XCAR (path));
       if (!complete_filename_p (filename))
@@ -1548,8 +2865,11 @@ openp (Lisp_Object path, Lisp_Object str, Lisp_Object suffixes,
 	      encoded_fn = ENCODE_FILE (string);
 	      pfn = SSDATA (encoded_fn);
 
-	      /* Check that we can access or open it.  */
-	      if (NATNUMP (predicate))
+	      /* Check that we can access or open it, unless the
+		 directory index shows that it does not exist.  */
+	      if (load_dir_lacks (&dir_names, encoded_fn))
+		fd = -1;
+	      else if (NATNUMP (predicate))
 		{
 		  fd = -1;
 		  if (INT_MAX < XFASTINT (predicate))
@@ -1775,7 +3095,8 @@ readevalloop (Lisp_Object readcharfun,
 	 Vload_source_file_function -> load-with-code-conversion
 	 -> eval-buffer.  */
       || EQ (readcharfun, Qget_file_char)
-      || EQ (readcharfun, Qget_emacs_mule_file_char))
+      || EQ (readcharfun, Qget_emacs_mule_file_char)
+      || EQ (readcharfun, Qget_binary_file_object))
     macroexpand = Qnil;
 
   if (MARKERP (readcharfun))
@@ -1825,11 +3146,11 @@ readevalloop (Lisp_Object readcharfun,
       if (!NILP (start))
 	{
 	  /* Switch to the buffer we are reading from.  */
-	  record_unwind_protect (save_excursion_restore, save_excursion_save ());
+	  record_unwind_protect_excursion ();
 	  set_buffer_internal (b);
 
 	  /* Save point in it.  */
-	  record_unwind_protect (save_excursion_restore, save_excursion_save ());
+	  record_unwind_protect_excursion ();
 	  /* Save ZV in it.  */
 	  record_unwind_protect (save_restriction_restore, save_restriction_save ());
 	  /* Those get unbound after we read one expression.  */
@@ -1851,6 +3172,21 @@ readevalloop (Lisp_Object readcharfun,
 	whole_buffer = (BUF_PT (b) == BUF_BEG (b) && BUF_ZV (b) == BUF_Z (b));
 
       infile = infile0;
+
+      /* The forms of a binary compiled file are decoded, not parsed.  */
+      if (EQ (readcharfun, Qget_binary_file_object))
+	{
+	  if (elb_input->end <= elb_input->p)
+	    {
+	      unbind_to (count1, Qnil);
+	      break;
+	    }
+	  val = (NILP (Vload_read_function)
+		 ? elb_read_form (elb_input)
+		 : call1 (Vload_read_function, readcharfun));
+	  goto form_read;
+	}
+
     read_next:
       c = READCHAR;
       if (c == ';')
@@ -1915,6 +3251,7 @@ readevalloop (Lisp_Object readcharfun,
 	  && XHASH_TABLE (read_objects_completed)->count > 0)
 	read_objects_completed = Qnil;
 
+    form_read:
       if (!NILP (start) && continue_reading_p)
 	start = Fpoint_marker ();
 
@@ -1940,7 +3277,8 @@ readevalloop (Lisp_Object readcharfun,
     }
 
   build_load_history (sourcename,
-		      infile0 || whole_buffer);
+		      (infile0 || whole_buffer
+		       || EQ (readcharfun, Qget_binary_file_object)));
 
   unbind_to (count, Qnil);
 }
@@ -1986,7 +3324,7 @@ This function preserves the position of point.  */)
 
   specbind (Qeval_buffer_list, Fcons (buf, Veval_buffer_list));
   specbind (Qstandard_output, tem);
-  record_unwind_protect (save_excursion_restore, save_excursion_save ());
+  record_unwind_protect_excursion ();
   BUF_TEMP_SET_PT (XBUFFER (buf), BUF_BEGV (XBUFFER (buf)));
   specbind (Qlexical_binding, lisp_file_lexically_bound_p (buf) ? Qt : Qnil);
   BUF_TEMP_SET_PT (XBUFFER (buf), BUF_BEGV (XBUFFER (buf)));
@@ -2022,6 +3360,13 @@ read_internal_start (Lisp_Object stream, Lisp_Object start, Lisp_Object end)
 {
   Lisp_Object retval;
 
+  if (EQ (stream, Qget_binary_file_object))
+    {
+      if (!elb_input || elb_input->end <= elb_input->p)
+	end_of_file_error ();
+      return elb_read_form (elb_input);
+    }
+
   readchar_count = 0;
   new_backquote_flag = force_new_style_backquotes;
   /* We can get called from readevalloop which may have set these
@@ -2822,6 +4167,7 @@ read1 (Lisp_Object readcharfun, int *pch, bool first_in_list)
 
 	      FILE *instream = infile->stream;
 	      saved_doc_string_position = (file_tell (instream)
+					   - (infile->size - infile->pos)
 					   - infile->lookahead);
 
 	      /* Copy that many bytes into saved_doc_string.  */
@@ -2829,6 +4175,14 @@ read1 (Lisp_Object readcharfun, int *pch, bool first_in_list)
 	      for (int n = min (nskip, infile->lookahead); 0 < n; n--)
 		saved_doc_string[i++]
 		  = c = infile->buf[--infile->lookahead];
+	      ptrdiff_t n = min (nskip - i, infile->size - infile->pos);
+	      if (0 < n)
+		{
+		  memcpy (saved_doc_string + i, infile->contents + infile->pos,
+			  n);
+		  infile->pos += n;
+		  i += n;
+		}
 	      block_input ();
 	      for (; i < nskip && 0 <= c; i++)
 		saved_doc_string[i] = c = getc_unlocked (instream);
@@ -3201,6 +4555,11 @@ read1 (Lisp_Object readcharfun, int *pch, bool first_in_list)
 		  force_multibyte = true;
 	      }
 	    nchars++;
+
+	    ptrdiff_t run = read_file_run (readcharfun, READ_STRING_BYTE,
+					   p, end - p);
+	    p += run;
+	    nchars += run;
 	  }
 
 	if (ch < 0)
@@ -3285,6 +4644,7 @@ read1 (Lisp_Object readcharfun, int *pch, bool first_in_list)
 	      p += CHAR_STRING (c, (unsigned char *) p);
 	    else
 	      *p++ = c;
+	    p += read_file_run (readcharfun, READ_SYMBOL_BYTE, p, end - p - 1);
 	    c = READCHAR;
 	  }
 	while (c > 040
@@ -3828,6 +5188,181 @@ Lisp_Object initial_obarray;
 
 size_t oblookup_last_bucket_number;
 
+/* The initial obarray holds far more symbols than it has buckets, so
+   its bucket chains are long.  To find a symbol without walking them,
+   the symbols of the initial obarray are also kept in an open-addressed
+   hash table, together with the hashes of their names.  The table
+   grows as symbols are interned.  The chains remain the real contents
+   of the obarray, which `mapatoms' and Lisp code see, and the table is
+   built from them the first time it is needed.  */
+
+struct obarray_index_entry
+{
+  /* The hash_string of the symbol's name.  */
+  EMACS_UINT hash;
+
+  /* The symbol, or NULL if the entry is free.  */
+  struct Lisp_Symbol *symbol;
+};
+
+static struct obarray_index_entry *obarray_index;
+
+/* The number of entries in obarray_index, a power of 2, and the number
+   of those in use.  */
+static ptrdiff_t obarray_index_size, obarray_index_count;
+
+enum { OBARRAY_INDEX_MIN_SIZE = 1 << 14 };
+
+/* Return the entry of obarray_index where to start looking for HASH.  */
+
+static ptrdiff_t
+obarray_index_start (EMACS_UINT hash)
+{
+  return (hash ^ (hash >> 15)) & (obarray_index_size - 1);
+}
+
+static void
+obarray_index_insert (EMACS_UINT hash, struct Lisp_Symbol *sym)
+{
+  ptrdiff_t mask = obarray_index_size - 1;
+  ptrdiff_t i;
+
+  for (i = obarray_index_start (hash); obarray_index[i].symbol;
+       i = (i + 1) & mask)
+    continue;
+  obarray_index[i].hash = hash;
+  obarray_index[i].symbol = sym;
+  obarray_index_count++;
+}
+
+static EMACS_UINT
+symbol_name_hash (struct Lisp_Symbol *sym)
+{
+  Lisp_Object name = sym->u.s.name;
+  return hash_string (SSDATA (name), SBYTES (name));
+}
+
+/* Put all the symbols of the initial obarray in obarray_index, making
+   it big enough that it is at most half full, with room for one more.  */
+
+static void
+obarray_index_rebuild (void)
+{
+  ptrdiff_t size = OBARRAY_INDEX_MIN_SIZE;
+  ptrdiff_t nsymbols = 1;
+  ptrdiff_t i;
+
+  for (i = 0; i < ASIZE (initial_obarray); i++)
+    {
+      Lisp_Object bucket = AREF (initial_obarray, i);
+      if (SYMBOLP (bucket))
+	for (struct Lisp_Symbol *sym = XSYMBOL (bucket); sym;
+	     sym = sym->u.s.next)
+	  nsymbols++;
+    }
+  while (size < 2 * nsymbols)
+    size *= 2;
+  xfree (obarray_index);
+  obarray_index = xzalloc (size * sizeof *obarray_index);
+  obarray_index_size = size;
+  obarray_index_count = 0;
+
+  for (i = 0; i < ASIZE (initial_obarray); i++)
+    {
+      Lisp_Object bucket = AREF (initial_obarray, i);
+      if (SYMBOLP (bucket))
+	for (struct Lisp_Symbol *sym = XSYMBOL (bucket); sym;
+	     sym = sym->u.s.next)
+	  obarray_index_insert (symbol_name_hash (sym), sym);
+    }
+}
+
+/* Add SYM, whose name has hash HASH, to obarray_index after it has
+   been interned in the initial obarray.  */
+
+static void
+obarray_index_add (EMACS_UINT hash, struct Lisp_Symbol *sym)
+{
+  if (!obarray_index)
+    /* The table will include SYM when it is built.  */
+    return;
+  if (2 * (obarray_index_count + 1) > obarray_index_size)
+    /* This puts SYM in the table too.  */
+    obarray_index_rebuild ();
+  else
+    obarray_index_insert (hash, sym);
+}
+
+/* Return the symbol of the initial obarray whose name is the string
+   of SIZE characters (SIZE_BYTE bytes) at PTR, with hash HASH, or NULL
+   if there is none.  */
+
+static struct Lisp_Symbol *
+obarray_index_lookup (EMACS_UINT hash, const char *ptr, ptrdiff_t size,
+		      ptrdiff_t size_byte)
+{
+  ptrdiff_t mask, i;
+
+  if (!obarray_index)
+    obarray_index_rebuild ();
+  mask = obarray_index_size - 1;
+  for (i = obarray_index_start (hash); obarray_index[i].symbol;
+       i = (i + 1) & mask)
+    if (obarray_index[i].hash == hash)
+      {
+	Lisp_Object name = obarray_index[i].symbol->u.s.name;
+	if (SBYTES (name) == size_byte
+	    && SCHARS (name) == size
+	    && !memcmp (SDATA (name), ptr, size_byte))
+	  return obarray_index[i].symbol;
+      }
+  return NULL;
+}
+
+/* Remove SYM from obarray_index when it is uninterned from OBARRAY.  */
+
+void
+obarray_unintern (Lisp_Object obarray, Lisp_Object sym)
+{
+  ptrdiff_t mask, i, j;
+
+  if (!EQ (obarray, initial_obarray) || !obarray_index)
+    return;
+  mask = obarray_index_size - 1;
+  for (i = obarray_index_start (symbol_name_hash (XSYMBOL (sym)));
+       obarray_index[i].symbol != XSYMBOL (sym);
+       i = (i + 1) & mask)
+    if (!obarray_index[i].symbol)
+      return;
+
+  /* Move back the entries that follow, so that each can still be
+     reached from where its search starts.  */
+  for (j = (i + 1) & mask; obarray_index[j].symbol; j = (j + 1) & mask)
+    {
+      ptrdiff_t start = obarray_index_start (obarray_index[j].hash);
+      if (((j - start) & mask) >= ((j - i) & mask))
+	{
+	  obarray_index[i] = obarray_index[j];
+	  i = j;
+	}
+    }
+  obarray_index[i].symbol = NULL;
+  obarray_index_count--;
+}
+
+DEFUN ("internal--obarray-reset-index", Finternal__obarray_reset_index,
+       Sinternal__obarray_reset_index, 0, 0, 0,
+       doc: /* Drop the index of the initial obarray.
+It is built again from the obarray when it is next needed, as when a
+dumped Emacs starts.  This is only meant for testing.  */)
+  (void)
+{
+  xfree (obarray_index);
+  obarray_index = NULL;
+  obarray_index_size = obarray_index_count = 0;
+  return Qnil;
+}
+
 /* Intern symbol SYM in OBARRAY using bucket INDEX.  */
 
 Lisp_Object
@@ -3849,6 +5384,8 @@ intern_sym (Lisp_Object sym, Lisp_Object obarray, Lisp_Object index)
   ptr = aref_addr (obarray, XINT (index));
   set_symbol_next (sym, SYMBOLP (*ptr) ? XSYMBOL (*ptr) : NULL);
   *ptr = sym;
+  if (EQ (obarray, initial_obarray))
+    obarray_index_add (symbol_name_hash (XSYMBOL (sym)), XSYMBOL (sym));
   return sym;
 }
 
@@ -3875,11 +5412,15 @@ define_symbol (Lisp_Object sym, char const *str)
    If there is no such symbol, return the integer bucket number of
    where the symbol would be if it were present.
 
-   Also store the bucket number in oblookup_last_bucket_number.  */
+   Also store the bucket number in oblookup_last_bucket_number.
+
+   Symbols of the initial obarray are looked up in obarray_index
+   instead of the bucket chain.  */
 
 Lisp_Object
 oblookup (Lisp_Object obarray, register const char *ptr, ptrdiff_t size, ptrdiff_t size_byte)
 {
+  EMACS_UINT name_hash;
   size_t hash;
   size_t obsize;
   register Lisp_Object tail;
@@ -3888,9 +5429,19 @@ oblookup (Lisp_Object obarray, register const char *ptr, ptrdiff_t size, ptrdiff
   obarray = check_obarray (obarray);
   /* This is sometimes needed in the middle of GC.  */
   obsize = gc_asize (obarray);
-  hash = hash_string (ptr, size_byte) % obsize;
-  bucket = AREF (obarray, hash);
+  name_hash = hash_string (ptr, size_byte);
+  hash = name_hash % obsize;
   oblookup_last_bucket_number = hash;
+  if (EQ (obarray, initial_obarray))
+    {
+      struct Lisp_Symbol *sym
+	= obarray_index_lookup (name_hash, ptr, size, size_byte);
+      if (sym)
+	return make_lisp_symbol (sym);
+      XSETINT (tem, hash);
+      return tem;
+    }
+  bucket = AREF (obarray, hash);
   if (EQ (bucket, make_number (0)))
     ;
   else if (!SYMBOLP (bucket))
@@ -4150,6 +5701,16 @@ load_path_default (void)
 void
 init_lread (void)
 {
+  /* The index of the initial obarray was allocated before Emacs was
+     dumped, if it was; build it afresh when it is next needed.  */
+  if (initialized)
+    {
+      obarray_index = NULL;
+      obarray_index_size = obarray_index_count = 0;
+    }
+
+  init_read_byte_class ();
+
   if (NILP (Vpurify_flag) && !NILP (Ffboundp (Qfile_truename)))
     Vsource_directory = call1 (Qfile_truename, Vsource_directory);
 
@@ -4266,8 +5827,10 @@ syms_of_lread (void)
 {
   defsubr (&Sread_from_string);
   defsubr (&Slread__substitute_object_in_subtree);
+  defsubr (&Sinternal__obarray_reset_index);
   defsubr (&Sget_load_suffixes);
   defsubr (&Sload);
+  defsubr (&Swrite_binary_compiled_file);
   defsubr (&Seval_buffer);
   defsubr (&Slocate_file_internal);
 
@@ -4552,7 +6115,16 @@ this variable will become obsolete.  */);
      by Emacs 21 or older.  */
   DEFSYM (Qget_emacs_mule_file_char, "get-emacs-mule-file-char");
 
+  /* The stream that `read' decodes the forms of a binary compiled
+     file from while it is loaded.  */
+  DEFSYM (Qget_binary_file_object, "get-binary-file-object");
+
   DEFSYM (Qload_force_doc_strings, "load-force-doc-strings");
+  DEFSYM (Qdefalias, "defalias");
+  DEFSYM (Qprint_circle, "print-circle");
+  DEFSYM (Qprint_gensym, "print-gensym");
+  DEFSYM (Qprint_length, "print-length");
+  DEFSYM (Qprint_level, "print-level");
 
   DEFSYM (Qbackquote, "`");
   DEFSYM (Qcomma, ",");
@@ -4568,6 +6140,16 @@ this variable will become obsolete.  */);
   DEFSYM (Qdir_ok, "dir-ok");
   DEFSYM (Qdo_after_load_evaluation, "do-after-load-evaluation");
 
+  DEFVAR_BOOL ("load-path-use-index", load_path_use_index,
+	       doc: /* Non-nil means `load' and `locate-file' use a directory index.
+When searching for a file, they read each directory once and remember
+the names in it.  They then try to open only the files that exist,
+until the directory's modification time changes.  */);
+  load_path_use_index = true;
+
+  staticpro (&load_dir_index);
+  load_dir_index = Qnil;
+
   staticpro (&read_objects_map);
   read_objects_map = Qnil;
   staticpro (&read_objects_completed);
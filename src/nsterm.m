@@ -3033,7 +3033,7 @@ so some key presses (TAB) are swallowed by the system.  */
       codes[0] = *(s->char2b);
       codes[1] = *(s->char2b + s->nchars - 1);
 
-      font->driver->text_extents (font, codes, 2, &metrics);
+      font_text_extents (font, codes, 2, &metrics);
       s->left_overhang = -metrics.lbearing;
       s->right_overhang
 	= metrics.rbearing > metrics.width
@@ -1564,6 +1564,96 @@ usage: (make-process &rest ARGS)  */)
   return unbind_to (count, proc);
 }
 
+DEFUN ("call-process-async", Fcall_process_async, Scall_process_async,
+       1, MANY, 0,
+       doc: /* Call PROGRAM in a subprocess, inserting its output as it arrives.
+Return the process object at once, without waiting for PROGRAM.
+
+This is like `call-process', but Emacs keeps running the command loop
+while PROGRAM runs.  Its standard output and standard error are
+decoded and inserted at the end of BUFFER, in large blocks, from the
+command loop.  BUFFER may be a buffer or buffer name, or nil to
+discard the output.  PROGRAM's standard input is empty.
+
+When PROGRAM exits, its process is deleted and CALLBACK, if non-nil,
+is called with one argument: the exit status, as `call-process' would
+return it.  That is a number, or a string describing the signal that
+killed PROGRAM.
+
+The remaining arguments are strings passed as command arguments to
+PROGRAM.  PROGRAM is found in `exec-path' as for `make-process'.
+
+usage: (call-process-async PROGRAM &optional BUFFER CALLBACK &rest ARGS)  */)
+  (ptrdiff_t nargs, Lisp_Object *args)
+{
+  Lisp_Object program = args[0];
+  Lisp_Object buffer = nargs > 1 ? args[1] : Qnil;
+  Lisp_Object callback = nargs > 2 ? args[2] : Qnil;
+  Lisp_Object command, proc;
+  struct Lisp_Process *p;
+
+  CHECK_STRING (program);
+  command = Fcons (program, Flist (max (nargs - 3, 0), args + 3));
+  if (!NILP (buffer))
+    buffer = Fget_buffer_create (buffer);
+
+  proc = CALLN (Fmake_process,
+		QCname, Ffile_name_nondirectory (program),
+		QCbuffer, buffer,
+		QCcommand, command,
+		QCconnection_type, Qpipe,
+		QCsentinel, Qinternal_call_process_async_sentinel);
+  p = XPROCESS (proc);
+
+  /* Read as much as a pipe holds at a time, so that output arrives
+     in a few large insertions rather than many small ones.  */
+  p->read_output_max = 64 * 1024;
+  pset_plist (p, list2 (QCcallback, callback));
+  Fprocess_send_eof (proc);
+  return proc;
+}
+
+DEFUN ("internal-call-process-async-sentinel",
+       Finternal_call_process_async_sentinel,
+       Sinternal_call_process_async_sentinel, 2, 2, 0,
+       doc: /* Sentinel of processes started by `call-process-async'.
+When PROC has exited, delete it and call its callback with its exit
+status.  */)
+  (Lisp_Object proc, Lisp_Object msg)
+{
+  struct Lisp_Process *p;
+  Lisp_Object symbol, code, status, callback;
+  bool coredump;
+
+  CHECK_PROCESS (proc);
+  p = XPROCESS (proc);
+  if (p->raw_status_new)
+    update_status (p);
+  decode_status (p->status, &symbol, &code, &coredump);
+
+  if (EQ (symbol, Qexit))
+    status = code;
+  else if (EQ (symbol, Qsignal))
+    {
+      const char *signame;
+
+      synchronize_system_messages_locale ();
+      signame = strsignal (XFASTINT (code));
+      if (signame == 0)
+	signame = "unknown";
+      status = code_convert_string_norecord (build_string (signame),
+					     Vlocale_coding_system, 0);
+    }
+  else
+    return Qnil;
+
+  callback = Fplist_get (p->plist, QCcallback);
+  Fdelete_process (proc);
+  if (!NILP (callback))
+    call1 (callback, status);
+  return Qnil;
+}
+
 /* If PROC doesn't have its pid set, then an error was signaled and
    the process wasn't started successfully, so remove it.  */
 static void
@@ -1690,44 +1780,65 @@ create_process (Lisp_Object process, char **new_argv, Lisp_Object current_dir)
   /* This may signal an error.  */
   setup_process_coding_systems (process);
 
+  /* The child's environment.  This is freed before anything can
+     signal an error, except on MS-Windows when the child cannot be
+     started.  */
+  char **env = make_environment_block (current_dir);
+
+  /* A child on a pty must make it its controlling terminal before it
+     execs, which posix_spawn cannot do.  */
+  bool spawn = !pty_flag && spawn_child_p ();
+
   block_input ();
   block_child_signal (&oldset);
 
 #ifndef WINDOWSNT
-  /* vfork, and prevent local vars from being clobbered by the vfork.  */
-  Lisp_Object volatile current_dir_volatile = current_dir;
-  Lisp_Object volatile lisp_pty_name_volatile = lisp_pty_name;
-  char **volatile new_argv_volatile = new_argv;
-  int volatile forkin_volatile = forkin;
-  int volatile forkout_volatile = forkout;
-  int volatile forkerr_volatile = forkerr;
-  struct Lisp_Process *p_volatile = p;
+  pid = (spawn
+	 ? spawn_child (forkin, forkout, forkerr < 0 ? forkout : forkerr,
+			new_argv, env, current_dir, &oldset, true)
+	 : -1);
 
-#ifdef DARWIN_OS
-  /* Darwin doesn't let us run setsid after a vfork, so use fork when
-     necessary.  Also, reset SIGCHLD handling after a vfork, as
-     apparently macOS can mistakenly deliver SIGCHLD to the child.  */
-  if (pty_flag)
-    pid = fork ();
-  else
+  /* Unless posix_spawn started the child, vfork, and prevent local
+     vars from being clobbered by the vfork.  */
+  if (pid < 0)
     {
-      pid = vfork ();
-      if (pid == 0)
-	signal (SIGCHLD, SIG_DFL);
-    }
+      Lisp_Object volatile current_dir_volatile = current_dir;
+      Lisp_Object volatile lisp_pty_name_volatile = lisp_pty_name;
+      char **volatile new_argv_volatile = new_argv;
+      char **volatile env_volatile = env;
+      int volatile forkin_volatile = forkin;
+      int volatile forkout_volatile = forkout;
+      int volatile forkerr_volatile = forkerr;
+      struct Lisp_Process *p_volatile = p;
+
+#ifdef DARWIN_OS
+      /* Darwin doesn't let us run setsid after a vfork, so use fork
+	 when necessary.  Also, reset SIGCHLD handling after a vfork,
+	 as apparently macOS can mistakenly deliver SIGCHLD to the
+	 child.  */
+      if (pty_flag)
+	pid = fork ();
+      else
+	{
+	  pid = vfork ();
+	  if (pid == 0)
+	    signal (SIGCHLD, SIG_DFL);
+	}
 #else
-  pid = vfork ();
+      pid = vfork ();
 #endif
 
-  current_dir = current_dir_volatile;
-  lisp_pty_name = lisp_pty_name_volatile;
-  new_argv = new_argv_volatile;
-  forkin = forkin_volatile;
-  forkout = forkout_volatile;
-  forkerr = forkerr_volatile;
-  p = p_volatile;
+      current_dir = current_dir_volatile;
+      lisp_pty_name = lisp_pty_name_volatile;
+      new_argv = new_argv_volatile;
+      env = env_volatile;
+      forkin = forkin_volatile;
+      forkout = forkout_volatile;
+      forkerr = forkerr_volatile;
+      p = p_volatile;
 
-  pty_flag = p->pty_flag;
+      pty_flag = p->pty_flag;
+    }
 
   if (pid == 0)
 #endif /* not WINDOWSNT */
@@ -1833,15 +1944,17 @@ create_process (Lisp_Object process, char **new_argv, Lisp_Object current_dir)
       if (forkerr < 0)
 	forkerr = forkout;
 #ifdef WINDOWSNT
-      pid = child_setup (forkin, forkout, forkerr, new_argv, 1, current_dir);
+      pid = child_setup (forkin, forkout, forkerr, new_argv, env, 1,
+			 current_dir);
 #else  /* not WINDOWSNT */
-      child_setup (forkin, forkout, forkerr, new_argv, 1, current_dir);
+      child_setup (forkin, forkout, forkerr, new_argv, env, 1, current_dir);
 #endif /* not WINDOWSNT */
     }
 
   /* Back in the parent process.  */
 
   vfork_errno = errno;
+  xfree (env);
   p->pid = pid;
   if (pid >= 0)
     p->alive = 1;
@@ -5454,9 +5567,9 @@ read_and_dispose_of_process_output (struct Lisp_Process *p, char *chars,
    starting with our buffered-ahead character if we have one.
    Yield number of decoded characters read.
 
-   This function reads at most 4096 characters.
-   If you want to read all available subprocess output,
-   you must call it repeatedly until it returns zero.
+   This function reads at most the process's read_output_max bytes,
+   4096 by default.  If you want to read all available subprocess
+   output, you must call it repeatedly until it returns zero.
 
    The characters read are decoded according to PROC's coding-system
    for decoding.  */
@@ -5468,10 +5581,11 @@ read_process_output (Lisp_Object proc, int channel)
   struct Lisp_Process *p = XPROCESS (proc);
   struct coding_system *coding = proc_decode_coding_system[channel];
   int carryover = p->decoding_carryover;
-  enum { readmax = 4096 };
+  int readmax = p->read_output_max > 0 ? p->read_output_max : 4096;
   ptrdiff_t count = SPECPDL_INDEX ();
   Lisp_Object odeactivate;
-  char chars[sizeof coding->carryover + readmax];
+  USE_SAFE_ALLOCA;
+  char *chars = SAFE_ALLOCA (sizeof coding->carryover + readmax);
 
   if (carryover)
     /* See the comment above.  */
@@ -5538,7 +5652,10 @@ read_process_output (Lisp_Object proc, int channel)
   if (nbytes <= 0)
     {
       if (nbytes < 0 || coding->mode & CODING_MODE_LAST_BLOCK)
-	return nbytes;
+	{
+	  SAFE_FREE ();
+	  return nbytes;
+	}
       coding->mode |= CODING_MODE_LAST_BLOCK;
     }
 
@@ -5559,6 +5676,7 @@ read_process_output (Lisp_Object proc, int channel)
   /* Handling the process output should not deactivate the mark.  */
   Vdeactivate_mark = odeactivate;
 
+  SAFE_FREE ();
   unbind_to (count, Qnil);
   return nbytes;
 }
@@ -5640,13 +5758,22 @@ read_and_dispose_of_process_output (struct Lisp_Process *p, char *chars,
       p->decoding_carryover = coding->carryover_bytes;
     }
   if (SBYTES (text) > 0)
-    /* FIXME: It's wrong to wrap or not based on debug-on-error, and
-       sometimes it's simply wrong to wrap (e.g. when called from
-       accept-process-output).  */
-    internal_condition_case_1 (read_process_output_call,
-			       list3 (outstream, make_lisp_proc (p), text),
-			       !NILP (Vdebug_on_error) ? Qnil : Qerror,
-			       read_process_output_error_handler);
+    {
+      ptrdiff_t span_count = SPECPDL_INDEX ();
+      Lisp_Object proc = make_lisp_proc (p);
+      if (profiler_spans_running)
+	record_unwind_protect_int (profiler_span_end,
+				   profiler_span_begin (SPAN_FILTER, proc,
+							outstream));
+      /* FIXME: It's wrong to wrap or not based on debug-on-error, and
+	 sometimes it's simply wrong to wrap (e.g. when called from
+	 accept-process-output).  */
+      internal_condition_case_1 (read_process_output_call,
+				 list3 (outstream, proc, text),
+				 !NILP (Vdebug_on_error) ? Qnil : Qerror,
+				 read_process_output_error_handler);
+      unbind_to (span_count, Qnil);
+    }
 
   /* If we saved the match data nonrecursively, restore it now.  */
   restore_search_regs ();
@@ -5920,7 +6047,8 @@ send_process (Lisp_Object proc, const char *buf, ptrdiff_t len,
     }
   coding->dst_multibyte = 0;
 
-  if (CODING_REQUIRE_ENCODING (coding))
+  if (CODING_REQUIRE_ENCODING (coding)
+      && ! encode_coding_identity_p (coding, (const unsigned char *) buf, len))
     {
       coding->dst_object = Qt;
       if (BUFFERP (object))
@@ -6685,6 +6813,10 @@ exec_sentinel (Lisp_Object proc, Lisp_Object reason)
      save the match data in a special nonrecursive fashion.  */
   running_asynch_code = 1;
 
+  if (profiler_spans_running)
+    record_unwind_protect_int (profiler_span_end,
+			       profiler_span_begin (SPAN_SENTINEL, proc,
+						    sentinel));
   internal_condition_case_1 (read_process_output_call,
 			     list3 (sentinel, proc, reason),
 			     !NILP (Vdebug_on_error) ? Qnil : Qerror,
@@ -7191,6 +7323,19 @@ restore_nofile_limit (void)
 #endif
 }
 
+/* Return true if restore_nofile_limit would change the limit, which
+   only a child that runs code of ours before it execs can do.  */
+
+bool
+nofile_limit_lowered (void)
+{
+#ifdef HAVE_SETRLIMIT
+  return FD_SETSIZE < nofile_limit.rlim_cur;
+#else
+  return false;
+#endif
+}
+
 
 /* This is not called "init_process" because that is the name of a
    Mach system call, so it would cause problems on Darwin systems.  */
@@ -7381,6 +7526,9 @@ syms_of_process (void)
   DEFSYM (Qctime, "ctime");
   DEFSYM (Qinternal_default_process_sentinel,
 	  "internal-default-process-sentinel");
+  DEFSYM (Qinternal_call_process_async_sentinel,
+	  "internal-call-process-async-sentinel");
+  DEFSYM (QCcallback, ":callback");
   DEFSYM (Qinternal_default_process_filter,
 	  "internal-default-process-filter");
   DEFSYM (Qpri, "pri");
@@ -7432,6 +7580,8 @@ The variable takes effect when `start-process' is called.  */);
   defsubr (&Sset_process_inherit_coding_system_flag);
   defsubr (&Sprocess_contact);
   defsubr (&Smake_process);
+  defsubr (&Scall_process_async);
+  defsubr (&Sinternal_call_process_async_sentinel);
   defsubr (&Smake_pipe_process);
   defsubr (&Sserial_process_configure);
   defsubr (&Smake_serial_process);
@@ -23,6 +23,7 @@ along with GNU Emacs.  If not, see <https://www.gnu.org/licenses/>.  */
 #include <sys/types.h>
 #endif
 
+#include <signal.h>
 #include <unistd.h>
 
 #ifdef HAVE_GNUTLS
@@ -142,6 +143,9 @@ struct Lisp_Process
     EMACS_INT update_tick;
     /* Size of carryover in decoding.  */
     int decoding_carryover;
+    /* Most bytes to read from this process at a time, or zero for
+       the default of 4096.  */
+    int read_output_max;
     /* Hysteresis to try to read process output in larger blocks.
        On some systems, e.g. GNU/Linux, Emacs is seen as
        an interactive app also when reading process output, meaning
@@ -267,6 +271,10 @@ enum
 
 extern Lisp_Object encode_current_directory (void);
 extern void record_kill_process (struct Lisp_Process *, Lisp_Object);
+extern char **make_environment_block (Lisp_Object);
+extern bool spawn_child_p (void);
+extern pid_t spawn_child (int, int, int, char **, char **, Lisp_Object,
+			  sigset_t const *, bool);
 
 /* Defined in sysdep.c.  */
 
@@ -290,6 +298,7 @@ extern void add_write_fd (int fd, fd_callback func, void *data);
 extern void delete_write_fd (int fd);
 extern void catch_child_signal (void);
 extern void restore_nofile_limit (void);
+extern bool nofile_limit_lowered (void);
 
 #ifdef WINDOWSNT
 extern Lisp_Object network_interface_list (void);
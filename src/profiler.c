@@ -21,6 +21,23 @@ along with GNU Emacs.  If not, see <https://www.gnu.org/licenses/>.  */
 #include "lisp.h"
 #include "syssignal.h"
 #include "systime.h"
+#include "thread.h"
+
+/* Native frames are found by following the frame pointers from the
+   registers of the interrupted code, whose layout is specific to
+   x86-64 GNU/Linux.  The program counters are recorded as fixnums,
+   which is why this needs a 64-bit host.  */
+#if (defined PROFILER_CPU_SUPPORT && defined GNU_LINUX && defined __GLIBC__ \
+     && defined __x86_64__)
+# define PROFILER_NATIVE_SUPPORT
+# include <fcntl.h>
+# include <link.h>
+# include <stdio.h>
+# include <stdlib.h>
+# include <sys/mman.h>
+# include <sys/stat.h>
+# include <ucontext.h>
+#endif
 
 /* Return A + B, but return the maximum fixnum if the result would overflow.
    Assume A and B are nonnegative and in fixnum range.  */
@@ -128,25 +145,80 @@ static void evict_lower_half (log_t *log)
       }
 }
 
-/* Record the current backtrace in LOG.  COUNT is the weight of this
-   current backtrace: interrupt counts for CPU, and the allocation
-   size for memory.  */
+#ifdef PROFILER_NATIVE_SUPPORT
+
+/* The most native frames recorded per sample.  */
+enum { NATIVE_STACK_DEPTH_MAX = 64 };
+
+/* The registers of the code that the profiler signal interrupted, or
+   NULL outside the signal handler.  */
+static ucontext_t *profiler_signal_context;
+
+/* Put the program counters of the DEPTH innermost native frames of
+   the code interrupted by the profiler signal at the start of ARRAY,
+   innermost first, padding with nil.  This runs in the signal
+   handler, so it must not take locks or allocate, as an unwinder
+   would.  It only reads the stack between the interrupted stack
+   pointer and the bottom of the stack, following the saved frame
+   pointers for as long as they look like a chain of frames; code
+   compiled without frame pointers gives just the innermost frame.  */
 
 static void
-record_backtrace (log_t *log, EMACS_INT count)
+get_native_backtrace (Lisp_Object array, int depth)
 {
-  Lisp_Object backtrace;
-  ptrdiff_t index;
+  int i = 0;
 
+  /* When another thread has the global lock, the main thread is only
+     waiting for it, and its frames have nothing to do with the Lisp
+     backtrace.  */
+  if (profiler_signal_context && main_thread_p (current_thread))
+    {
+      greg_t const *regs = profiler_signal_context->uc_mcontext.gregs;
+      uintptr_t low = regs[REG_RSP];
+      uintptr_t high = (uintptr_t) stack_bottom;
+      uintptr_t const *fp = (uintptr_t const *) regs[REG_RBP];
+
+      ASET (array, i++, make_number (regs[REG_RIP]));
+      while (i < depth
+	     && low <= (uintptr_t) fp && (uintptr_t) fp < high
+	     && (uintptr_t) fp % alignof (uintptr_t) == 0
+	     && 2 * sizeof *fp <= high - (uintptr_t) fp
+	     && fp[1] != 0)
+	{
+	  ASET (array, i++, make_number (fp[1]));
+	  /* Frames further out are at higher addresses.  */
+	  low = (uintptr_t) (fp + 2);
+	  fp = (uintptr_t const *) fp[0];
+	}
+    }
+  for (; i < depth; i++)
+    ASET (array, i, Qnil);
+}
+
+#endif /* PROFILER_NATIVE_SUPPORT */
+
+/* Return the vector in which to put the next backtrace recorded in
+   LOG, evicting entries if it is full.  */
+
+static Lisp_Object
+log_backtrace_vector (log_t *log)
+{
   if (log->next_free < 0)
     /* FIXME: transfer the evicted counts to a special entry rather
        than dropping them on the floor.  */
     evict_lower_half (log);
-  index = log->next_free;
 
   /* Get a "working memory" vector.  */
-  backtrace = HASH_KEY (log, index);
-  get_backtrace (backtrace);
+  return HASH_KEY (log, log->next_free);
+}
+
+/* Add COUNT to the entry of LOG for BACKTRACE, which is the vector
+   that log_backtrace_vector returned, now filled in.  */
+
+static void
+log_add (log_t *log, Lisp_Object backtrace, EMACS_INT count)
+{
+  ptrdiff_t index = log->next_free;
 
   { /* We basically do a `gethash+puthash' here, except that we have to be
        careful to avoid memory allocation since we're in a signal
@@ -186,6 +258,24 @@ record_backtrace (log_t *log, EMACS_INT count)
       }
   }
 }
+
+/* Record the current backtrace in LOG.  COUNT is the weight of this
+   current backtrace: interrupt counts for CPU, and the allocation
+   size for memory.  NATIVE_DEPTH is the number of native frames
+   recorded before the Lisp frames, which is zero except in the CPU
+   profiler.  */
+
+static void
+record_backtrace (log_t *log, EMACS_INT count, int native_depth)
+{
+  Lisp_Object backtrace = log_backtrace_vector (log);
+#ifdef PROFILER_NATIVE_SUPPORT
+  if (native_depth > 0)
+    get_native_backtrace (backtrace, native_depth);
+#endif
+  get_backtrace (backtrace, native_depth);
+  log_add (log, backtrace, count);
+}
 
 /* Sampling profiler.  */
 
@@ -217,6 +307,10 @@ static EMACS_INT cpu_gc_count;
 /* The current sampling interval in nanoseconds.  */
 static EMACS_INT current_sampling_interval;
 
+/* The number of native frames at the start of each backtrace in
+   cpu_log.  */
+static int cpu_native_depth;
+
 /* Signal handler for sampling profiler.  */
 
 /* timer_getoverrun is not implemented on Cygwin, but the following
@@ -248,7 +342,7 @@ handle_profiler_signal (int signal)
 	}
 #endif
       eassert (HASH_TABLE_P (cpu_log));
-      record_backtrace (XHASH_TABLE (cpu_log), count);
+      record_backtrace (XHASH_TABLE (cpu_log), count, cpu_native_depth);
     }
 }
 
@@ -258,6 +352,19 @@ deliver_profiler_signal (int signal)
   deliver_process_signal (signal, handle_profiler_signal);
 }
 
+#ifdef PROFILER_NATIVE_SUPPORT
+/* Like deliver_profiler_signal, but for an SA_SIGINFO handler, which
+   also gets the registers of the interrupted code in CONTEXT.  */
+
+static void
+deliver_profiler_signal_context (int signal, siginfo_t *info, void *context)
+{
+  profiler_signal_context = context;
+  deliver_profiler_signal (signal);
+  profiler_signal_context = NULL;
+}
+#endif
+
 static int
 setup_cpu_timer (Lisp_Object sampling_interval)
 {
@@ -277,6 +384,10 @@ setup_cpu_timer (Lisp_Object sampling_interval)
   interval = make_timespec (current_sampling_interval / billion,
 			    current_sampling_interval % billion);
   emacs_sigaction_init (&action, deliver_profiler_signal);
+#ifdef PROFILER_NATIVE_SUPPORT
+  action.sa_sigaction = deliver_profiler_signal_context;
+  action.sa_flags |= SA_SIGINFO;
+#endif
   sigaction (SIGPROF, &action, 0);
 
 #ifdef HAVE_ITIMERSPEC
@@ -327,6 +438,322 @@ setup_cpu_timer (Lisp_Object sampling_interval)
   return NOT_RUNNING;
 }
 
+/* Make a log for the CPU profiler, with room for cpu_native_depth
+   native frames.  */
+
+static Lisp_Object
+make_cpu_log (void)
+{
+  return make_log (profiler_log_size,
+		   profiler_max_stack_depth + cpu_native_depth);
+}
+
+#ifdef PROFILER_NATIVE_SUPPORT
+
+/* Naming native frames.  This is done when the log is returned, so
+   the signal handler only has to record program counters.  */
+
+/* A function in the symbol table of a loaded object.  */
+struct native_symbol
+{
+  uintptr_t start, size;
+  char const *name;
+};
+
+/* The executable or a shared library, as loaded in memory.  */
+struct native_object
+{
+  /* The file it was loaded from, and the name to show for addresses
+     in it that are not in a known function.  */
+  char *file;
+  char *name;
+
+  /* What to add to addresses in the file to get addresses in memory,
+     and the range of addresses it is loaded at.  */
+  uintptr_t bias, start, end;
+
+  /* Its functions sorted by address, once they have been read, and
+     the mapped file that their names point into.  These are only
+     kept while a log is being named.  */
+  bool symbols_read;
+  struct native_symbol *symbols;
+  ptrdiff_t nsymbols;
+  void *contents;
+  size_t contents_size;
+};
+
+/* The objects seen so far.  Emacs never unloads a shared library, so
+   they need not be forgotten.  */
+static struct native_object *native_objects;
+static ptrdiff_t native_objects_count, native_objects_size;
+
+/* Add the object that INFO describes to native_objects, unless it is
+   there already.  A callback for dl_iterate_phdr.  */
+
+static int
+add_native_object (struct dl_phdr_info *info, size_t size, void *data)
+{
+  uintptr_t start = UINTPTR_MAX, end = 0;
+  for (int i = 0; i < info->dlpi_phnum; i++)
+    if (info->dlpi_phdr[i].p_type == PT_LOAD)
+      {
+	uintptr_t segment = info->dlpi_addr + info->dlpi_phdr[i].p_vaddr;
+	start = min (start, segment);
+	end = max (end, segment + info->dlpi_phdr[i].p_memsz);
+      }
+  if (end == 0)
+    return 0;
+  for (ptrdiff_t i = 0; i < native_objects_count; i++)
+    if (native_objects[i].start == start)
+      return 0;
+
+  if (native_objects_count == native_objects_size)
+    native_objects = xpalloc (native_objects, &native_objects_size, 1, -1,
+			      sizeof *native_objects);
+  struct native_object *object = &native_objects[native_objects_count++];
+  memset (object, 0, sizeof *object);
+  object->bias = info->dlpi_addr;
+  object->start = start;
+  object->end = end;
+  if (*info->dlpi_name)
+    {
+      char const *slash = strrchr (info->dlpi_name, '/');
+      object->file = xstrdup (info->dlpi_name);
+      object->name = xstrdup (slash ? slash + 1 : info->dlpi_name);
+    }
+  else
+    {
+      /* The executable is the only object without a name.  */
+      object->file = xstrdup ("/proc/self/exe");
+      object->name = xstrdup (STRINGP (Vinvocation_name)
+			      ? SSDATA (Vinvocation_name) : "emacs");
+    }
+  return 0;
+}
+
+static int
+compare_native_symbols (void const *a, void const *b)
+{
+  struct native_symbol const *s1 = a, *s2 = b;
+  return (s1->start > s2->start) - (s1->start < s2->start);
+}
+
+/* Read the functions of OBJECT from the symbol table of its file, or
+   from its dynamic symbol table if it is stripped.  Give up quietly
+   on anything unexpected, leaving the addresses unnamed.  */
+
+static void
+read_native_symbols (struct native_object *object)
+{
+  object->symbols_read = true;
+
+  int fd = emacs_open (object->file, O_RDONLY, 0);
+  if (fd < 0)
+    return;
+  struct stat st;
+  void *contents = MAP_FAILED;
+  if (fstat (fd, &st) == 0 && sizeof (ElfW (Ehdr)) <= st.st_size
+      && st.st_size <= SIZE_MAX)
+    contents = mmap (NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  emacs_close (fd);
+  if (contents == MAP_FAILED)
+    return;
+  object->contents = contents;
+  object->contents_size = st.st_size;
+
+  char const *file = contents;
+  size_t size = st.st_size;
+  ElfW (Ehdr) const *ehdr = contents;
+  if (memcmp (ehdr->e_ident, ELFMAG, SELFMAG) != 0
+      || ehdr->e_shentsize != sizeof (ElfW (Shdr))
+      || size < ehdr->e_shoff
+      || (size - ehdr->e_shoff) / sizeof (ElfW (Shdr)) < ehdr->e_shnum)
+    return;
+
+  ElfW (Shdr) const *shdr = (ElfW (Shdr) const *) (file + ehdr->e_shoff);
+  ElfW (Shdr) const *symtab = NULL;
+  for (int i = 0; i < ehdr->e_shnum; i++)
+    if (shdr[i].sh_type == SHT_SYMTAB
+	|| (shdr[i].sh_type == SHT_DYNSYM && !symtab))
+      symtab = &shdr[i];
+  if (! (symtab
+	 && symtab->sh_entsize == sizeof (ElfW (Sym))
+	 && symtab->sh_offset <= size
+	 && symtab->sh_size <= size - symtab->sh_offset
+	 && symtab->sh_link < ehdr->e_shnum))
+    return;
+  ElfW (Shdr) const *strtab = &shdr[symtab->sh_link];
+  if (! (strtab->sh_offset <= size
+	 && strtab->sh_size <= size - strtab->sh_offset
+	 && 0 < strtab->sh_size
+	 && file[strtab->sh_offset + strtab->sh_size - 1] == '\0'))
+    return;
+
+  ElfW (Sym) const *syms = (ElfW (Sym) const *) (file + symtab->sh_offset);
+  ptrdiff_t nsyms = symtab->sh_size / sizeof *syms;
+  object->symbols = xnmalloc (nsyms, sizeof *object->symbols);
+  for (ptrdiff_t i = 0; i < nsyms; i++)
+    if (ELF64_ST_TYPE (syms[i].st_info) == STT_FUNC
+	&& syms[i].st_shndx != SHN_UNDEF
+	&& syms[i].st_value != 0
+	&& syms[i].st_name < strtab->sh_size)
+      {
+	struct native_symbol *symbol = &object->symbols[object->nsymbols++];
+	symbol->start = object->bias + syms[i].st_value;
+	symbol->size = syms[i].st_size;
+	symbol->name = file + strtab->sh_offset + syms[i].st_name;
+      }
+  qsort (object->symbols, object->nsymbols, sizeof *object->symbols,
+	 compare_native_symbols);
+}
+
+/* Forget the functions read from the files of native_objects, and
+   unmap the files, once the names that were needed are copied.  */
+
+static void
+forget_native_symbols (void)
+{
+  for (ptrdiff_t i = 0; i < native_objects_count; i++)
+    {
+      struct native_object *object = &native_objects[i];
+      if (object->contents)
+	munmap (object->contents, object->contents_size);
+      xfree (object->symbols);
+      object->symbols_read = false;
+      object->symbols = NULL;
+      object->nsymbols = 0;
+      object->contents = NULL;
+      object->contents_size = 0;
+    }
+}
+
+/* Return the name of the function that contains PC.  If it is not
+   known, put a name for the address in BUF, which has room for SIZE
+   bytes, and return BUF.  */
+
+static char const *
+native_frame_name (uintptr_t pc, char *buf, size_t size)
+{
+  struct native_object *object = NULL;
+  for (ptrdiff_t i = 0; i < native_objects_count; i++)
+    if (native_objects[i].start <= pc && pc < native_objects[i].end)
+      object = &native_objects[i];
+  if (!object)
+    {
+      snprintf (buf, size, "0x%"PRIxPTR, pc);
+      return buf;
+    }
+
+  if (!object->symbols_read)
+    read_native_symbols (object);
+
+  /* Find the last function that starts at or before PC.  */
+  ptrdiff_t lo = 0, hi = object->nsymbols;
+  while (lo < hi)
+    {
+      ptrdiff_t mid = lo + (hi - lo) / 2;
+      if (object->symbols[mid].start <= pc)
+	lo = mid + 1;
+      else
+	hi = mid;
+    }
+  if (0 < lo)
+    {
+      struct native_symbol *symbol = &object->symbols[lo - 1];
+      if (pc - symbol->start < symbol->size || symbol->size == 0)
+	return symbol->name;
+    }
+  snprintf (buf, size, "%s+0x%"PRIxPTR, object->name, pc - object->bias);
+  return buf;
+}
+
+/* The functions of the Lisp interpreter.  Native frames from the
+   first of these on are running Lisp code, which the Lisp frames of
+   the backtrace already show.  */
+static char const *const lisp_interpreter_functions[] =
+  {
+    "Ffuncall", "funcall_subr", "funcall_lambda", "apply_lambda",
+    "Fapply", "eval_sub", "Feval", "exec_byte_code"
+  };
+
+static bool
+lisp_interpreter_function_p (char const *name)
+{
+  for (int i = 0; i < ARRAYELTS (lisp_interpreter_functions); i++)
+    {
+      char const *function = lisp_interpreter_functions[i];
+      size_t len = strlen (function);
+      /* The compiler may have split the function into pieces with
+	 names like "Ffuncall.cold".  */
+      if (strncmp (name, function, len) == 0
+	  && (name[len] == '\0' || name[len] == '.'))
+	return true;
+    }
+  return false;
+}
+
+/* Return a copy of LOG where the first NATIVE_DEPTH elements of each
+   backtrace, which are program counters, are replaced by the names
+   of their functions, up to the first function of the interpreter.
+   Equal names are the same string, so that `function-equal' can
+   compare them.  Backtraces that become equal are merged.  */
+
+static Lisp_Object
+symbolize_log (log_t *log, int native_depth)
+{
+  Lisp_Object result = make_hash_table (hashtest_profiler, log->count,
+					DEFAULT_REHASH_SIZE,
+					DEFAULT_REHASH_THRESHOLD,
+					Qnil, false);
+  struct Lisp_Hash_Table *h = XHASH_TABLE (result);
+  Lisp_Object names = CALLN (Fmake_hash_table, QCtest, Qequal);
+
+  ptrdiff_t count = SPECPDL_INDEX ();
+  record_unwind_protect_void (forget_native_symbols);
+  dl_iterate_phdr (add_native_object, NULL);
+
+  for (ptrdiff_t i = 0; i < HASH_TABLE_SIZE (log); i++)
+    if (!NILP (HASH_HASH (log, i)))
+      {
+	Lisp_Object old = HASH_KEY (log, i);
+	Lisp_Object new = Fmake_vector (make_number (ASIZE (old)), Qnil);
+	ptrdiff_t n = 0;
+
+	for (int j = 0; j < native_depth && INTEGERP (AREF (old, j)); j++)
+	  {
+	    char buf[256];
+	    /* Every frame but the innermost one holds a return address,
+	       which may be just past the end of the calling function.  */
+	    uintptr_t pc = XINT (AREF (old, j)) - (j > 0);
+	    char const *name = native_frame_name (pc, buf, sizeof buf);
+	    if (lisp_interpreter_function_p (name))
+	      break;
+	    Lisp_Object string = build_string (name);
+	    Lisp_Object shared = Fgethash (string, names, Qnil);
+	    if (NILP (shared))
+	      Fputhash (string, string, names);
+	    else
+	      string = shared;
+	    ASET (new, n++, string);
+	  }
+	for (ptrdiff_t j = native_depth; j < ASIZE (old); j++)
+	  ASET (new, n++, AREF (old, j));
+
+	EMACS_UINT hash;
+	ptrdiff_t k = hash_lookup (h, new, &hash);
+	if (k >= 0)
+	  set_hash_value_slot (h, k,
+			       make_number (saturated_add
+					    (XINT (HASH_VALUE (h, k)),
+					     XINT (HASH_VALUE (log, i)))));
+	else
+	  hash_put (h, new, HASH_VALUE (log, i), hash);
+      }
+  return unbind_to (count, result);
+}
+
+#endif /* PROFILER_NATIVE_SUPPORT */
+
 DEFUN ("profiler-cpu-start", Fprofiler_cpu_start, Sprofiler_cpu_start,
        1, 1, 0,
        doc: /* Start or restart the cpu profiler.
@@ -340,8 +767,13 @@ See also `profiler-log-size' and `profiler-max-stack-depth'.  */)
   if (NILP (cpu_log))
     {
       cpu_gc_count = 0;
-      cpu_log = make_log (profiler_log_size,
-			  profiler_max_stack_depth);
+      /* The signal handler relies on this staying the same for as
+	 long as there is a log.  */
+#ifdef PROFILER_NATIVE_SUPPORT
+      cpu_native_depth = clip_to_bounds (0, profiler_native_stack_depth,
+					 NATIVE_STACK_DEPTH_MAX);
+#endif
+      cpu_log = make_cpu_log ();
     }
 
   int status = setup_cpu_timer (sampling_interval);
@@ -411,7 +843,8 @@ DEFUN ("profiler-cpu-log", Fprofiler_cpu_log, Sprofiler_cpu_log,
        doc: /* Return the current cpu profiler log.
 The log is a hash-table mapping backtraces to counters which represent
 the amount of time spent at those points.  Every backtrace is a vector
-of functions, where the last few elements may be nil.
+of functions, where the last few elements may be nil.  The functions
+written in C that `profiler-native-stack-depth' asks for are strings.
 Before returning, a new log is allocated for future samples.  */)
   (void)
 {
@@ -419,9 +852,11 @@ Before returning, a new log is allocated for future samples.  */)
   /* Here we're making the log visible to Elisp, so it's not safe any
      more for our use afterwards since we can't rely on its special
      pre-allocated keys anymore.  So we have to allocate a new one.  */
-  cpu_log = (profiler_cpu_running
-	     ? make_log (profiler_log_size, profiler_max_stack_depth)
-	     : Qnil);
+  cpu_log = profiler_cpu_running ? make_cpu_log () : Qnil;
+#ifdef PROFILER_NATIVE_SUPPORT
+  if (cpu_native_depth > 0 && !NILP (result))
+    result = symbolize_log (XHASH_TABLE (result), cpu_native_depth);
+#endif
   Fputhash (Fmake_vector (make_number (1), QAutomatic_GC),
 	    make_number (cpu_gc_count),
 	    result);
@@ -444,7 +879,493 @@ void
 malloc_probe (size_t size)
 {
   eassert (HASH_TABLE_P (memory_log));
-  record_backtrace (XHASH_TABLE (memory_log), min (size, MOST_POSITIVE_FIXNUM));
+  record_backtrace (XHASH_TABLE (memory_log), min (size, MOST_POSITIVE_FIXNUM),
+		    0);
+}
+
+/* Allocation profiler.  */
+
+/* True if the allocation profiler is running.  */
+bool profiler_allocation_running;
+
+/* The log of the allocation profiler, whose backtraces start with the
+   type of the object allocated, and the number of elements in them.  */
+static Lisp_Object allocation_log;
+static ptrdiff_t allocation_log_depth;
+
+/* A sample is taken each time this many more bytes of Lisp objects
+   have been allocated.  */
+static EMACS_INT allocation_interval;
+
+/* The number of bytes to allocate until the next sample.  */
+static EMACS_INT allocation_countdown;
+
+/* The bytes allocated since the log was started, estimated from the
+   samples, by type of object.  */
+static EMACS_INT allocated_bytes[Lisp_Float + 1];
+
+/* The objects that were sampled and were not yet found dead by the
+   garbage collector, which are not kept alive by being here.  Each
+   has the number of bytes allocated that it stands for, and whether
+   it survived a garbage collection, after which it counts as live.
+   Their backtraces are in allocation_sample_frames, where each takes
+   allocation_log_depth elements.  */
+struct allocation_sample
+{
+  Lisp_Object object;
+  EMACS_INT bytes;
+  bool survived_gc;
+};
+static struct allocation_sample *allocation_samples;
+static Lisp_Object *allocation_sample_frames;
+static ptrdiff_t allocation_samples_count, allocation_samples_size;
+
+/* Return the symbol that objects of TYPE are logged as.  */
+
+static Lisp_Object
+allocation_type (enum Lisp_Type type)
+{
+  switch (type)
+    {
+    case Lisp_Symbol: return Qsymbol;
+    case Lisp_Misc: return Qmisc;
+    case Lisp_String: return Qstring;
+    case Lisp_Vectorlike: return Qvector;
+    case Lisp_Cons: return Qcons;
+    case Lisp_Float: return Qfloat;
+    default: emacs_abort ();
+    }
+}
+
+/* Record that OBJECT, which has just been allocated, took SIZE bytes.
+   This must not allocate Lisp objects.  */
+
+void
+allocation_probe (Lisp_Object object, size_t size)
+{
+  allocation_countdown -= min (size, MOST_POSITIVE_FIXNUM);
+  if (allocation_countdown > 0)
+    return;
+
+  /* OBJECT stands for every interval that its bytes reach into.  */
+  EMACS_INT intervals = 1 + -allocation_countdown / allocation_interval;
+  EMACS_INT bytes = intervals * allocation_interval;
+  allocation_countdown += bytes;
+
+  enum Lisp_Type type = XTYPE (object);
+  allocated_bytes[type] = saturated_add (allocated_bytes[type], bytes);
+
+  log_t *log = XHASH_TABLE (allocation_log);
+  Lisp_Object backtrace = log_backtrace_vector (log);
+  ASET (backtrace, 0, allocation_type (type));
+  get_backtrace (backtrace, 1);
+  log_add (log, backtrace, bytes);
+
+  /* The log may reuse BACKTRACE for another one, so copy it.  */
+  if (allocation_samples_count == allocation_samples_size)
+    {
+      allocation_samples = xpalloc (allocation_samples,
+				    &allocation_samples_size, 1, -1,
+				    sizeof *allocation_samples);
+      allocation_sample_frames
+	= xnrealloc (allocation_sample_frames, allocation_samples_size,
+		     allocation_log_depth * word_size);
+    }
+  ptrdiff_t i = allocation_samples_count++;
+  allocation_samples[i].object = object;
+  allocation_samples[i].bytes = bytes;
+  allocation_samples[i].survived_gc = false;
+  memcpy (allocation_sample_frames + i * allocation_log_depth,
+	  XVECTOR (backtrace)->contents, allocation_log_depth * word_size);
+}
+
+/* Mark the backtraces of the sampled objects, but not the objects.  */
+
+void
+mark_allocation_samples (void)
+{
+  for (ptrdiff_t i = 0; i < allocation_samples_count * allocation_log_depth;
+       i++)
+    mark_object (allocation_sample_frames[i]);
+}
+
+/* Forget the sampled objects that the garbage collector is about to
+   free.  This is called when everything else is marked.  */
+
+void
+sweep_allocation_samples (void)
+{
+  ptrdiff_t live = 0;
+  for (ptrdiff_t i = 0; i < allocation_samples_count; i++)
+    if (survives_gc_p (allocation_samples[i].object))
+      {
+	allocation_samples[live] = allocation_samples[i];
+	allocation_samples[live].survived_gc = true;
+	memmove (allocation_sample_frames + live * allocation_log_depth,
+		 allocation_sample_frames + i * allocation_log_depth,
+		 allocation_log_depth * word_size);
+	live++;
+      }
+  allocation_samples_count = live;
+}
+
+DEFUN ("profiler-allocation-start", Fprofiler_allocation_start,
+       Sprofiler_allocation_start, 0, 1, 0,
+       doc: /* Start or restart the allocation profiler.
+It records the type and the call-stack of an object allocated after
+each INTERVAL bytes of Lisp objects, 65536 by default, and remembers
+the objects to tell which of them are still live.  Unlike the memory
+profiler, this sees conses, floats, strings, vectors, symbols and
+markers as they are allocated, rather than the blocks that hold them.
+See also `profiler-log-size' and `profiler-max-stack-depth'.  */)
+  (Lisp_Object interval)
+{
+  if (profiler_allocation_running)
+    error ("Allocation profiler is already running");
+  if (NILP (interval))
+    interval = make_number (65536);
+  CHECK_RANGED_INTEGER (interval, 1, MOST_POSITIVE_FIXNUM);
+
+  if (NILP (allocation_log))
+    {
+      /* The backtraces of the samples left from an earlier run may
+	 have another length.  */
+      allocation_samples_count = 0;
+      allocation_log_depth = clip_to_bounds (0, profiler_max_stack_depth,
+					     PTRDIFF_MAX / word_size - 1) + 1;
+      memset (allocated_bytes, 0, sizeof allocated_bytes);
+      allocation_log = make_log (profiler_log_size, allocation_log_depth);
+    }
+
+  allocation_interval = allocation_countdown = XINT (interval);
+  profiler_allocation_running = true;
+  return Qt;
+}
+
+DEFUN ("profiler-allocation-stop", Fprofiler_allocation_stop,
+       Sprofiler_allocation_stop, 0, 0, 0,
+       doc: /* Stop the allocation profiler.  The profiler log is not affected.
+Return non-nil if the profiler was running.  */)
+  (void)
+{
+  bool running = profiler_allocation_running;
+  profiler_allocation_running = false;
+  return running ? Qt : Qnil;
+}
+
+DEFUN ("profiler-allocation-running-p", Fprofiler_allocation_running_p,
+       Sprofiler_allocation_running_p, 0, 0, 0,
+       doc: /* Return non-nil if the allocation profiler is running.  */)
+  (void)
+{
+  return profiler_allocation_running ? Qt : Qnil;
+}
+
+DEFUN ("profiler-allocation-log", Fprofiler_allocation_log,
+       Sprofiler_allocation_log, 0, 0, 0,
+       doc: /* Return the current allocation profiler log.
+The log is a hash-table mapping backtraces to the number of bytes of
+Lisp objects allocated at those points, estimated from the samples.
+Every backtrace is a vector whose first element is the type of the
+objects, `cons', `float', `string', `vector', `symbol' or `misc', and
+whose other elements are functions, where the last few may be nil.
+Before returning, a new log is allocated for future samples.  */)
+  (void)
+{
+  Lisp_Object result = allocation_log;
+  /* Here we're making the log visible to Elisp, so it's not safe any
+     more for our use afterwards since we can't rely on its special
+     pre-allocated keys anymore.  So we have to allocate a new one.  */
+  allocation_log = (profiler_allocation_running
+		    ? make_log (profiler_log_size, allocation_log_depth)
+		    : Qnil);
+  memset (allocated_bytes, 0, sizeof allocated_bytes);
+  return result;
+}
+
+/* Set whether the allocation profiler is running to RUNNING.  */
+
+static void
+set_allocation_running (int running)
+{
+  profiler_allocation_running = running;
+}
+
+/* Stop sampling until the next unbind_to, for code that allocates while
+   it reads the samples, which allocation_probe may move.  */
+
+static void
+suspend_allocation_profiler (void)
+{
+  record_unwind_protect_int (set_allocation_running,
+			     profiler_allocation_running);
+  profiler_allocation_running = false;
+}
+
+DEFUN ("profiler-allocation-live-log", Fprofiler_allocation_live_log,
+       Sprofiler_allocation_live_log, 0, 0, 0,
+       doc: /* Return a log of the sampled objects that are still live.
+It is like the log of `profiler-allocation-log', but maps backtraces
+to the number of bytes that the objects allocated there stand for,
+counting only those that survived the last garbage collection.  */)
+  (void)
+{
+  ptrdiff_t count = SPECPDL_INDEX ();
+  suspend_allocation_profiler ();
+  Lisp_Object result = make_hash_table (hashtest_profiler,
+					DEFAULT_HASH_SIZE,
+					DEFAULT_REHASH_SIZE,
+					DEFAULT_REHASH_THRESHOLD,
+					Qnil, false);
+  struct Lisp_Hash_Table *h = XHASH_TABLE (result);
+
+  for (ptrdiff_t i = 0; i < allocation_samples_count; i++)
+    if (allocation_samples[i].survived_gc)
+      {
+	Lisp_Object backtrace
+	  = Fvector (allocation_log_depth,
+		     allocation_sample_frames + i * allocation_log_depth);
+	EMACS_INT bytes = allocation_samples[i].bytes;
+	EMACS_UINT hash;
+	ptrdiff_t j = hash_lookup (h, backtrace, &hash);
+	if (j >= 0)
+	  set_hash_value_slot (h, j,
+			       make_number (saturated_add
+					    (XINT (HASH_VALUE (h, j)),
+					     bytes)));
+	else
+	  hash_put (h, backtrace, make_number (bytes), hash);
+      }
+  return unbind_to (count, result);
+}
+
+DEFUN ("profiler-allocation-summary", Fprofiler_allocation_summary,
+       Sprofiler_allocation_summary, 0, 0, 0,
+       doc: /* Return the bytes allocated and live by type of object.
+The value is a list of elements (TYPE ALLOCATED LIVE), where TYPE is
+as in the backtraces of `profiler-allocation-log', ALLOCATED is the
+number of bytes allocated since that log was started, and LIVE is the
+number of bytes of the sampled objects that survived the last garbage
+collection, both estimated from the samples.  */)
+  (void)
+{
+  ptrdiff_t count = SPECPDL_INDEX ();
+  suspend_allocation_profiler ();
+  EMACS_INT live_bytes[ARRAYELTS (allocated_bytes)] = { 0 };
+  for (ptrdiff_t i = 0; i < allocation_samples_count; i++)
+    if (allocation_samples[i].survived_gc)
+      {
+	enum Lisp_Type type = XTYPE (allocation_samples[i].object);
+	live_bytes[type] = saturated_add (live_bytes[type],
+					  allocation_samples[i].bytes);
+      }
+
+  static enum Lisp_Type const types[] =
+    { Lisp_Cons, Lisp_Float, Lisp_String, Lisp_Vectorlike, Lisp_Symbol,
+      Lisp_Misc };
+  Lisp_Object result = Qnil;
+  for (int i = ARRAYELTS (types) - 1; 0 <= i; i--)
+    result = Fcons (list3 (allocation_type (types[i]),
+			   make_number (allocated_bytes[types[i]]),
+			   make_number (live_bytes[types[i]])),
+		    result);
+  return unbind_to (count, result);
+}
+
+/* Timing spans.  */
+
+/* True while timing spans are being recorded.  */
+bool profiler_spans_running;
+
+/* A call to a hook function, timer, process filter or sentinel.
+   SERIAL counts the spans begun since Emacs started, and is -1 in a
+   slot of the ring that holds no span.  DURATION is -1 until the span
+   ends.  */
+struct profiler_span
+{
+  EMACS_INT serial;
+  enum profiler_span_kind kind;
+  int depth;
+  Lisp_Object context, function;
+  struct timespec start;
+  EMACS_INT duration;
+};
+
+/* The ring of the last spans, where a span goes in the slot its serial
+   number modulo the size of the ring.  */
+static struct profiler_span *profiler_spans;
+static ptrdiff_t profiler_spans_size;
+static EMACS_INT profiler_spans_count;
+
+/* When the spans were started, which their start times are relative
+   to.  */
+static struct timespec profiler_spans_epoch;
+
+/* Return the number of nanoseconds in D, or 0 if it is negative.  */
+static EMACS_INT
+span_nanoseconds (struct timespec d)
+{
+  if (d.tv_sec < 0)
+    return 0;
+  return (min (MOST_POSITIVE_FIXNUM / TIMESPEC_RESOLUTION - 1, d.tv_sec)
+	  * TIMESPEC_RESOLUTION + d.tv_nsec);
+}
+
+/* Begin a span of KIND for a call to FUNCTION on behalf of CONTEXT,
+   which is the hook, timer or process.  Return the depth to give
+   profiler_span_end when the call is over, which callers arrange with
+   record_unwind_protect_int so that the span also ends on a nonlocal
+   exit.  Call this only when profiler_spans_running.
+
+   The running spans are kept per thread, in open_spans, so that the
+   spans of one thread do not appear to nest in those of another that
+   it switched from.  */
+int
+profiler_span_begin (enum profiler_span_kind kind, Lisp_Object context,
+		     Lisp_Object function)
+{
+  int depth = open_spans_depth++;
+  if (depth < SPAN_DEPTH_MAX)
+    {
+      EMACS_INT serial = profiler_spans_count++;
+      struct profiler_span *span
+	= &profiler_spans[serial % profiler_spans_size];
+      span->serial = serial;
+      span->kind = kind;
+      span->depth = depth;
+      span->context = context;
+      span->function = function;
+      span->duration = -1;
+      open_spans[depth] = serial;
+      span->start = current_timespec ();
+    }
+  return depth;
+}
+
+/* End the span that profiler_span_begin returned DEPTH for.  Spans are
+   ended even after the recording is stopped, but one that was
+   overwritten by later spans in the meantime is left alone.  */
+void
+profiler_span_end (int depth)
+{
+  open_spans_depth = depth;
+  if (depth < SPAN_DEPTH_MAX)
+    {
+      struct timespec end = current_timespec ();
+      EMACS_INT serial = open_spans[depth];
+      struct profiler_span *span
+	= &profiler_spans[serial % profiler_spans_size];
+      if (span->serial == serial)
+	span->duration = span_nanoseconds (timespec_sub (end, span->start));
+    }
+}
+
+void
+mark_profiler_spans (void)
+{
+  for (ptrdiff_t i = 0; i < profiler_spans_size; i++)
+    if (0 <= profiler_spans[i].serial)
+      {
+	mark_object (profiler_spans[i].context);
+	mark_object (profiler_spans[i].function);
+      }
+}
+
+DEFUN ("profiler-spans-start", Fprofiler_spans_start,
+       Sprofiler_spans_start, 0, 1, 0,
+       doc: /* Start recording timing spans.
+A span is recorded for each call of a hook function, timer, process
+filter and process sentinel, with the time it started and how long it
+took.  The last SIZE spans are kept, 65536 by default.  This does not
+interrupt Emacs like the cpu profiler, and costs a few tens of
+nanoseconds per call.  See `profiler-spans-log'.  */)
+  (Lisp_Object size)
+{
+  if (profiler_spans_running)
+    error ("Span recording is already running");
+  if (NILP (size))
+    size = make_number (65536);
+  CHECK_RANGED_INTEGER (size, 1,
+			min (PTRDIFF_MAX, SIZE_MAX) / sizeof *profiler_spans);
+
+  /* The spans of an earlier run are dropped, including those that
+     are still running.  */
+  if (profiler_spans_size != XINT (size))
+    {
+      profiler_spans_size = XINT (size);
+      profiler_spans = xnrealloc (profiler_spans, profiler_spans_size,
+				  sizeof *profiler_spans);
+    }
+  for (ptrdiff_t i = 0; i < profiler_spans_size; i++)
+    {
+      profiler_spans[i].serial = -1;
+      profiler_spans[i].context = profiler_spans[i].function = Qnil;
+    }
+
+  profiler_spans_epoch = current_timespec ();
+  profiler_spans_running = true;
+  return Qt;
+}
+
+DEFUN ("profiler-spans-stop", Fprofiler_spans_stop,
+       Sprofiler_spans_stop, 0, 0, 0,
+       doc: /* Stop recording timing spans.  The recorded spans are kept.
+Return non-nil if spans were being recorded.  */)
+  (void)
+{
+  bool running = profiler_spans_running;
+  profiler_spans_running = false;
+  return running ? Qt : Qnil;
+}
+
+DEFUN ("profiler-spans-running-p", Fprofiler_spans_running_p,
+       Sprofiler_spans_running_p, 0, 0, 0,
+       doc: /* Return non-nil if timing spans are being recorded.  */)
+  (void)
+{
+  return profiler_spans_running ? Qt : Qnil;
+}
+
+DEFUN ("profiler-spans-log", Fprofiler_spans_log,
+       Sprofiler_spans_log, 0, 0, 0,
+       doc: /* Return the timing spans that ended since the last call.
+The value is a list of the spans in the order they started, each of
+them a list (KIND CONTEXT FUNCTION START DURATION DEPTH).  KIND is
+`hook', `timer', `filter' or `sentinel'.  FUNCTION is the function
+called, and CONTEXT is the hook variable, the timer or the process it
+was called for.  START is the number of nanoseconds from the call of
+`profiler-spans-start' to the start of the span, and DURATION the
+number of nanoseconds it took.  DEPTH is the number of spans of the
+same thread that were running when it started, which contain it.
+The spans that are still running are returned by a later call, once
+they end.  */)
+  (void)
+{
+  Lisp_Object kinds[] = { Qhook, Qtimer, Qfilter, Qsentinel };
+  Lisp_Object result = Qnil;
+
+  for (EMACS_INT serial = profiler_spans_count;
+       0 < serial && profiler_spans_count - serial < profiler_spans_size; )
+    {
+      serial--;
+      struct profiler_span *span
+	= &profiler_spans[serial % profiler_spans_size];
+      if (span->serial == serial && 0 <= span->duration)
+	{
+	  Lisp_Object start
+	    = make_number (span_nanoseconds (timespec_sub
+					     (span->start,
+					      profiler_spans_epoch)));
+	  result = Fcons (listn (CONSTYPE_HEAP, 6, kinds[span->kind],
+				 span->context, span->function, start,
+				 make_number (span->duration),
+				 make_number (span->depth)),
+			  result);
+	  span->serial = -1;
+	  span->context = span->function = Qnil;
+	}
+    }
+  return result;
 }
 
 DEFUN ("function-equal", Ffunction_equal, Sfunction_equal, 2, 2, 0,
@@ -518,6 +1439,17 @@ syms_of_profiler (void)
 If the log gets full, some of the least-seen call-stacks will be evicted
 to make room for new entries.  */);
   profiler_log_size = 10000;
+  DEFVAR_INT ("profiler-native-stack-depth", profiler_native_stack_depth,
+	      doc: /* Number of native frames recorded by the cpu profiler.
+Each backtrace in the log then starts with the names of the C functions
+that were running, innermost first, up to the one that was called from
+Lisp and at most this many of them, followed by the Lisp functions.
+Frames outside the innermost one are found through frame pointers, so
+Emacs must be built with -fno-omit-frame-pointer to show them.
+This is only supported on x86-64 GNU/Linux, and takes effect when
+`profiler-cpu-start' starts a new log.  Zero, the default, means to
+record only Lisp functions.  */);
+  profiler_native_stack_depth = 0;
 
   DEFSYM (Qprofiler_backtrace_equal, "profiler-backtrace-equal");
 
@@ -541,4 +1473,25 @@ to make room for new entries.  */);
   profiler_memory_running = false;
   memory_log = Qnil;
   staticpro (&memory_log);
+
+  DEFSYM (Qmisc, "misc");
+  profiler_allocation_running = false;
+  allocation_log = Qnil;
+  staticpro (&allocation_log);
+  defsubr (&Sprofiler_allocation_start);
+  defsubr (&Sprofiler_allocation_stop);
+  defsubr (&Sprofiler_allocation_running_p);
+  defsubr (&Sprofiler_allocation_log);
+  defsubr (&Sprofiler_allocation_live_log);
+  defsubr (&Sprofiler_allocation_summary);
+
+  DEFSYM (Qhook, "hook");
+  DEFSYM (Qtimer, "timer");
+  DEFSYM (Qfilter, "filter");
+  DEFSYM (Qsentinel, "sentinel");
+  profiler_spans_running = false;
+  defsubr (&Sprofiler_spans_start);
+  defsubr (&Sprofiler_spans_stop);
+  defsubr (&Sprofiler_spans_running_p);
+  defsubr (&Sprofiler_spans_log);
 }
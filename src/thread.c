@@ -545,22 +545,16 @@ finalize_one_condvar (struct Lisp_CondVar *condvar)
 
 
 
-struct select_args
+struct unlocked_call
 {
-  select_func *func;
-  int max_fds;
-  fd_set *rfds;
-  fd_set *wfds;
-  fd_set *efds;
-  struct timespec *timeout;
-  sigset_t *sigmask;
-  int result;
+  void (*func) (void *);
+  void *arg;
 };
 
 static void
-really_call_select (void *arg)
+really_call_unlocked (void *arg)
 {
-  struct select_args *sa = arg;
+  struct unlocked_call *call = arg;
   struct thread_state *self = current_thread;
   sigset_t oldset;
 
@@ -569,11 +563,10 @@ really_call_select (void *arg)
   release_global_lock ();
   restore_signal_mask (&oldset);
 
-  sa->result = (sa->func) (sa->max_fds, sa->rfds, sa->wfds, sa->efds,
-			   sa->timeout, sa->sigmask);
+  call->func (call->arg);
 
   block_interrupt_signal (&oldset);
-  /* If we were interrupted by C-g while inside sa->func above, the
+  /* If we were interrupted by C-g while inside call->func above, the
      signal handler could have called maybe_reacquire_global_lock, in
      which case we are already holding the lock and shouldn't try
      taking it again, or else we will hang forever.  */
@@ -585,6 +578,61 @@ really_call_select (void *arg)
   restore_signal_mask (&oldset);
 }
 
+/* Call FUNC (ARG) without holding the global lock, so that other
+   threads can run Lisp while it blocks in a system call or computes.
+
+   FUNC must not look at or change Lisp objects, buffers, or anything
+   else that another thread may use while it runs, and must neither
+   signal nor quit.  In particular, the garbage collector may move
+   string data and buffer text meanwhile, so FUNC should work on
+   private copies.  */
+
+void
+thread_call_unlocked (void (*func) (void *), void *arg)
+{
+  struct unlocked_call call;
+
+  call.func = func;
+  call.arg = arg;
+  flush_stack_call_func (really_call_unlocked, &call);
+}
+
+/* Return true if some thread other than the current one is alive, so
+   that thread_call_unlocked may let it run.  Callers that need to
+   copy data before dropping the lock can skip that if not.  */
+
+bool
+other_threads_p (void)
+{
+  for (struct thread_state *iter = all_threads;
+       iter;
+       iter = iter->next_thread)
+    if (iter != current_thread && thread_alive_p (iter))
+      return true;
+  return false;
+}
+
+struct select_args
+{
+  select_func *func;
+  int max_fds;
+  fd_set *rfds;
+  fd_set *wfds;
+  fd_set *efds;
+  struct timespec *timeout;
+  sigset_t *sigmask;
+  int result;
+};
+
+static void
+call_select (void *arg)
+{
+  struct select_args *sa = arg;
+
+  sa->result = (sa->func) (sa->max_fds, sa->rfds, sa->wfds, sa->efds,
+			   sa->timeout, sa->sigmask);
+}
+
 int
 thread_select (select_func *func, int max_fds, fd_set *rfds,
 	       fd_set *wfds, fd_set *efds, struct timespec *timeout,
@@ -599,7 +647,7 @@ thread_select (select_func *func, int max_fds, fd_set *rfds,
   sa.efds = efds;
   sa.timeout = timeout;
   sa.sigmask = sigmask;
-  flush_stack_call_func (really_call_select, &sa);
+  thread_call_unlocked (call_select, &sa);
   return sa.result;
 }
 
@@ -33,6 +33,9 @@ along with GNU Emacs.  If not, see <https://www.gnu.org/licenses/>.  */
 #include "systime.h"		/* FIXME */
 #include "systhread.h"
 
+/* The most timing spans a thread records at once.  */
+enum { SPAN_DEPTH_MAX = 128 };
+
 struct thread_state
 {
   union vectorlike_header header;
@@ -169,6 +172,15 @@ struct thread_state
   sys_jmp_buf m_getcjmp;
 #define getcjmp (current_thread->m_getcjmp)
 
+  /* The serial numbers of the timing spans running in this thread,
+     outermost first, and how many are running.  Spans nested deeper
+     than SPAN_DEPTH_MAX are counted but not recorded.  See
+     profiler.c.  */
+  EMACS_INT m_open_spans[SPAN_DEPTH_MAX];
+#define open_spans (current_thread->m_open_spans)
+  int m_open_spans_depth;
+#define open_spans_depth (current_thread->m_open_spans_depth)
+
   /* The OS identifier for this thread.  */
   sys_thread_t thread_id;
 
@@ -298,6 +310,12 @@ extern void finalize_one_thread (struct thread_state *state);
 extern void finalize_one_mutex (struct Lisp_Mutex *);
 extern void finalize_one_condvar (struct Lisp_CondVar *);
 extern void maybe_reacquire_global_lock (void);
+/* Below this many bytes, copying the input of some work so as to do
+   it with thread_call_unlocked costs more than it gains.  */
+#define THREAD_UNLOCKED_MIN_BYTES 65536
+
+extern void thread_call_unlocked (void (*) (void *), void *);
+extern bool other_threads_p (void);
 
 extern void init_threads_once (void);
 extern void init_threads (void);
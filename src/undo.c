@@ -31,6 +31,13 @@ along with GNU Emacs.  If not, see <https://www.gnu.org/licenses/>.  */
    an undo-boundary.  */
 static Lisp_Object pending_boundary;
 
+/* Deletions of adjacent text, and replacements of nearby text, are
+   combined into one record only while the old text is no longer than
+   this.  Each combination copies the text,
+   so a larger limit would allocate more string data than the separate
+   records it saves.  */
+enum { UNDO_COMBINE_MAX = 32 };
+
 /* Prepare the undo info for recording a change. */
 static void
 prepare_record (void)
@@ -190,11 +197,109 @@ record_delete (ptrdiff_t beg, Lisp_Object string, bool record_markers)
   if (record_markers)
     record_marker_adjustments (beg, beg + SCHARS (string));
 
+  /* If this is following another deletion of text adjacent to it, in
+     the same direction, combine the two, so that deleting characters
+     one at a time leaves a single record.  Not when a marker
+     adjustment was recorded for either, since primitive-undo applies
+     those to the text of the deletion they precede.  */
+  if (CONSP (BVAR (current_buffer, undo_list)))
+    {
+      Lisp_Object elt, next;
+      elt = XCAR (BVAR (current_buffer, undo_list));
+      next = XCDR (BVAR (current_buffer, undo_list));
+      if (CONSP (elt)
+	  && STRINGP (XCAR (elt))
+	  && INTEGERP (XCDR (elt))
+	  && SCHARS (XCAR (elt)) + SCHARS (string) <= UNDO_COMBINE_MAX
+	  && ! (CONSP (next) && CONSP (XCAR (next))
+		&& MARKERP (XCAR (XCAR (next)))))
+	{
+	  EMACS_INT pos = XINT (XCDR (elt));
+
+	  /* Deleting forward, with point at the start of the text.  */
+	  if (0 < pos && 0 < XINT (sbeg) && pos == beg)
+	    {
+	      XSETCAR (elt, concat2 (XCAR (elt), string));
+	      return;
+	    }
+	  /* Deleting backward, with point at the end of the text.  */
+	  if (pos < 0 && XINT (sbeg) < 0 && -pos == beg + SCHARS (string))
+	    {
+	      XSETCAR (elt, concat2 (string, XCAR (elt)));
+	      XSETCDR (elt, sbeg);
+	      return;
+	    }
+	}
+    }
+
   bset_undo_list
     (current_buffer,
      Fcons (Fcons (string, sbeg), BVAR (current_buffer, undo_list)));
 }
 
+/* Return true if a marker of the current buffer is after FROM and
+   before TO.  */
+
+static bool
+markers_between (ptrdiff_t from, ptrdiff_t to)
+{
+  for (struct Lisp_Marker *m = BUF_MARKERS (current_buffer); m; m = m->next)
+    if (from < m->charpos && m->charpos < to)
+      return true;
+  return false;
+}
+
+/* Record that the characters in STRING at location FROM are about to
+   be replaced by INSCHARS characters.  This is recorded as the
+   insertion of those characters after STRING, followed by the
+   deletion of STRING, so that undo inserts before it deletes.
+
+   If the last replacement recorded is followed by unchanged text up
+   to FROM, the two and the text between them are recorded as one
+   replacement instead, as long as the old text stays short.  Not when
+   a marker is in the text between or in STRING, which undoing the
+   combined replacement would move.  */
+
+void
+record_replacement (ptrdiff_t from, Lisp_Object string, ptrdiff_t inschars)
+{
+  Lisp_Object undo_list = BVAR (current_buffer, undo_list);
+
+  if (CONSP (undo_list) && CONSP (XCDR (undo_list))
+      && MODIFF > SAVE_MODIFF)
+    {
+      Lisp_Object del = XCAR (undo_list), ins = XCAR (XCDR (undo_list));
+      if (CONSP (del) && STRINGP (XCAR (del)) && INTEGERP (XCDR (del))
+	  && CONSP (ins) && INTEGERP (XCAR (ins)) && INTEGERP (XCDR (ins)))
+	{
+	  EMACS_INT pos = eabs (XINT (XCDR (del)));
+	  EMACS_INT oldchars = SCHARS (XCAR (del));
+	  /* The replacement text of the last replacement ends at END.  */
+	  EMACS_INT end = pos + XINT (XCDR (ins)) - XINT (XCAR (ins));
+	  if (pos + oldchars == XINT (XCAR (ins))
+	      && end <= from
+	      && (oldchars + (from - end) + SCHARS (string)
+		  <= UNDO_COMBINE_MAX)
+	      && ! markers_between (pos, from + SCHARS (string)))
+	    {
+	      prepare_record ();
+	      Lisp_Object text
+		= concat3 (XCAR (del), make_buffer_string (end, from, true),
+			   string);
+	      EMACS_INT start = pos + SCHARS (text);
+	      /* The combined record keeps the direction of the first.  */
+	      XSETCAR (del, text);
+	      XSETCAR (ins, make_number (start));
+	      XSETCDR (ins, make_number (start + (from + inschars - pos)));
+	      return;
+	    }
+	}
+    }
+
+  record_insert (from + SCHARS (string), inschars);
+  record_delete (from, string, false);
+}
+
 /* Record that a replacement is about to take place,
    for LENGTH characters at location BEG.
    The replacement must not change the number of characters.  */
@@ -245,6 +350,32 @@ record_property_change (ptrdiff_t beg, ptrdiff_t length,
   if (MODIFF <= SAVE_MODIFF)
     record_first_change ();
 
+  /* If this is following a change of the same property from the same
+     value in adjacent text, extend that one.  Changing PROP in text
+     with several intervals records one change for each.  */
+  if (CONSP (BVAR (current_buffer, undo_list)))
+    {
+      Lisp_Object elt, tail;
+      elt = XCAR (BVAR (current_buffer, undo_list));
+      if (CONSP (elt) && NILP (XCAR (elt))
+	  && CONSP (tail = XCDR (elt)) && EQ (XCAR (tail), prop)
+	  && CONSP (tail = XCDR (tail)) && EQ (XCAR (tail), value)
+	  && CONSP (tail = XCDR (tail))
+	  && INTEGERP (XCAR (tail)) && INTEGERP (XCDR (tail)))
+	{
+	  if (XINT (XCDR (tail)) == beg)
+	    {
+	      XSETCDR (tail, make_number (beg + length));
+	      return;
+	    }
+	  if (XINT (XCAR (tail)) == beg + length)
+	    {
+	      XSETCAR (tail, make_number (beg));
+	      return;
+	    }
+	}
+    }
+
   XSETINT (lbeg, beg);
   XSETINT (lend, beg + length);
   entry = Fcons (Qnil, Fcons (prop, Fcons (value, Fcons (lbeg, lend))));
@@ -1187,7 +1187,7 @@ w32_compute_glyph_string_overhangs (struct glyph_string *s)
 
       for (i = 0; i < s->nchars; i++)
 	code[i] = s->char2b[i];
-      font->driver->text_extents (font, code, s->nchars, &metrics);
+      font_text_extents (font, code, s->nchars, &metrics);
       s->right_overhang = (metrics.rbearing > metrics.width
 			   ? metrics.rbearing - metrics.width : 0);
       s->left_overhang = metrics.lbearing < 0 ? -metrics.lbearing : 0;
@@ -4453,7 +4453,7 @@ specifies the window to scroll.  This takes precedence over
   w = XWINDOW (window);
 
   /* Don't screw up if window_scroll gets an error.  */
-  record_unwind_protect (save_excursion_restore, save_excursion_save ());
+  record_unwind_protect_excursion ();
 
   Fset_buffer (w->contents);
   SET_PT_BOTH (marker_position (w->pointm), marker_byte_position (w->pointm));
@@ -14657,6 +14657,10 @@ redisplay_internal (void)
     }
 #endif /* HAVE_WINDOW_SYSTEM */
 
+  /* Discard least recently used glyph-strings if the composition
+     cache grew too large.  */
+  composition_gstring_cache_compact ();
+
  end_of_redisplay:
 #ifdef HAVE_NS
   ns_set_doc_edited ();
@@ -26029,7 +26033,7 @@ get_per_char_metric (struct font *font, XChar2b *char2b)
   code = (XCHAR2B_BYTE1 (char2b) << 8) | XCHAR2B_BYTE2 (char2b);
   if (code == FONT_INVALID_CODE)
     return NULL;
-  font->driver->text_extents (font, &code, 1, &metrics);
+  font_text_extents (font, &code, 1, &metrics);
   return &metrics;
 }
 
@@ -27977,10 +27981,9 @@ produce_glyphless_glyph (struct it *it, bool for_no_font, Lisp_Object acronym)
       for (len = 0; str[len] && ASCII_CHAR_P (str[len]) && len < 6; len++)
 	code[len] = font->driver->encode_char (font, str[len]);
       upper_len = (len + 1) / 2;
-      font->driver->text_extents (font, code, upper_len,
-				  &metrics_upper);
-      font->driver->text_extents (font, code + upper_len, len - upper_len,
-				  &metrics_lower);
+      font_text_extents (font, code, upper_len, &metrics_upper);
+      font_text_extents (font, code + upper_len, len - upper_len,
+			 &metrics_lower);
 
 
 
@@ -1638,7 +1638,7 @@ x_compute_glyph_string_overhangs (struct glyph_string *s)
 
 	  for (i = 0; i < s->nchars; i++)
 	    code[i] = (s->char2b[i].byte1 << 8) | s->char2b[i].byte2;
-	  font->driver->text_extents (font, code, s->nchars, &metrics);
+	  font_text_extents (font, code, s->nchars, &metrics);
 	}
       else
 	{
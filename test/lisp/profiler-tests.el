@@ -0,0 +1,142 @@
+;;; profiler-tests.el --- Tests for profiler.el -*- lexical-binding: t -*-
+
+;; Copyright (C) 2018 Free Software Foundation, Inc.
+
+;; This file is part of GNU Emacs.
+
+;; GNU Emacs is free software: you can redistribute it and/or modify
+;; it under the terms of the GNU General Public License as published by
+;; the Free Software Foundation, either version 3 of the License, or
+;; (at your option) any later version.
+
+;; GNU Emacs is distributed in the hope that it will be useful,
+;; but WITHOUT ANY WARRANTY; without even the implied warranty of
+;; MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+;; GNU General Public License for more details.
+
+;; You should have received a copy of the GNU General Public License
+;; along with GNU Emacs.  If not, see <https://www.gnu.org/licenses/>.
+
+;;; Code:
+
+(require 'ert)
+(require 'profiler)
+
+(defun profiler-tests--log (&rest entries)
+  "Return a log with ENTRIES, which are (BACKTRACE . COUNT)."
+  (let ((log (make-hash-table :test 'equal)))
+    (dolist (entry entries)
+      (puthash (car entry) (cdr entry) log))
+    log))
+
+(defun profiler-tests--pprof-varints (string)
+  "Return the natural numbers encoded in STRING."
+  (let ((pos 0) numbers)
+    (while (< pos (length string))
+      (let ((n 0) (shift 0) byte)
+        (while (progn (setq byte (aref string pos)
+                            pos (1+ pos)
+                            n (logior n (ash (logand byte 127) shift))
+                            shift (+ shift 7))
+                      (>= byte 128)))
+        (push n numbers)))
+    (nreverse numbers)))
+
+(defun profiler-tests--pprof-fields (string)
+  "Return the fields of the protocol buffer message STRING.
+The value is a list of (FIELD . VALUE), where VALUE is a number or a
+string."
+  (let ((pos 0) fields)
+    (cl-flet ((varint ()
+                (let ((n 0) (shift 0) byte)
+                  (while (progn (setq byte (aref string pos)
+                                      pos (1+ pos)
+                                      n (logior n (ash (logand byte 127)
+                                                       shift))
+                                      shift (+ shift 7))
+                                (>= byte 128)))
+                  n)))
+      (while (< pos (length string))
+        (let ((key (varint)))
+          (push (cons (ash key -3)
+                      (if (= (logand key 7) 2)
+                          (let ((len (varint)))
+                            (setq pos (+ pos len))
+                            (substring string (- pos len) pos))
+                        (varint)))
+                fields))))
+    (nreverse fields)))
+
+(defun profiler-tests--field-values (field fields)
+  (delq nil (mapcar (lambda (f) (and (eq (car f) field) (cdr f))) fields)))
+
+(ert-deftest profiler-tests-collapsed ()
+  (let ((log (profiler-tests--log '([b a nil] . 3)
+                                  '([c a nil] . 2)
+                                  '(["x;y" b a] . 1)
+                                  '([a nil nil] . 0))))
+    (should (equal (profiler-log-to-collapsed log)
+                   "a;b 3\na;b;x_y 1\na;c 2\n"))))
+
+(ert-deftest profiler-tests-pprof-varint ()
+  (should (equal (profiler-pprof-varint 0) "\0"))
+  (should (equal (profiler-pprof-varint 127) "\177"))
+  (should (equal (profiler-pprof-varint 300) "\254\002"))
+  (should (equal (profiler-tests--pprof-varints
+                  (mapconcat #'profiler-pprof-varint
+                             '(1 128 16384 123456789) ""))
+                 '(1 128 16384 123456789))))
+
+(ert-deftest profiler-tests-pprof ()
+  (let* ((log (profiler-tests--log '([b a nil] . 3)
+                                   '(["Fé" a nil] . 2)
+                                   '([a nil nil] . 0)))
+         (pprof (profiler-log-to-pprof log 'cpu 1000))
+         (fields (profiler-tests--pprof-fields pprof))
+         (strings (profiler-tests--field-values 6 fields))
+         (names (make-hash-table)))
+    (should-not (multibyte-string-p pprof))
+    (should (equal (car strings) ""))
+    (should (equal (profiler-tests--field-values 12 fields) '(1000)))
+    (dolist (function (profiler-tests--field-values 5 fields))
+      (let ((function (profiler-tests--pprof-fields function)))
+        (puthash (cdr (assq 1 function))
+                 (decode-coding-string (nth (cdr (assq 2 function)) strings)
+                                       'utf-8)
+                 names)))
+    (should (= (hash-table-count names) 3))
+    (should (= (length (profiler-tests--field-values 4 fields)) 3))
+    (let (samples)
+      (dolist (sample (profiler-tests--field-values 2 fields))
+        (let ((sample (profiler-tests--pprof-fields sample)))
+          (push (cons (mapcar (lambda (id) (gethash id names))
+                              (profiler-tests--pprof-varints
+                               (cdr (assq 1 sample))))
+                      (profiler-tests--pprof-varints (cdr (assq 2 sample))))
+                samples)))
+      (should (equal (sort samples (lambda (a b) (string< (caar a) (caar b))))
+                     '((("Fé" "a") 2 2000) (("b" "a") 3 3000)))))))
+
+(ert-deftest profiler-tests-trace-events ()
+  (let* ((spans '((hook post-command-hook outer 1000 5000 0)
+                  (hook inner-hook (lambda () nil) 2500 500 1)))
+         (json (json-read-from-string
+                (profiler-spans-to-trace-events spans)))
+         (events (cdr (assq 'traceEvents json))))
+    (should (= (length events) 2))
+    (let ((outer (aref events 0))
+          (inner (aref events 1)))
+      (should (equal (cdr (assq 'name outer)) "outer"))
+      (should (equal (cdr (assq 'cat outer)) "hook"))
+      (should (equal (cdr (assq 'ph outer)) "X"))
+      (should (= (cdr (assq 'ts outer)) 1.0))
+      (should (= (cdr (assq 'dur outer)) 5.0))
+      (should (equal (cdr (assq 'hook (cdr (assq 'args outer))))
+                     "post-command-hook"))
+      (should (string-prefix-p "#<lambda" (cdr (assq 'name inner))))
+      (should (= (cdr (assq 'ts inner)) 2.5))
+      (should (= (cdr (assq 'depth (cdr (assq 'args inner)))) 1))
+      (should (equal (cdr (assq 'pid inner)) (cdr (assq 'pid outer)))))))
+
+(provide 'profiler-tests)
+;;; profiler-tests.el ends here
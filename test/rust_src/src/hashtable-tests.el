@@ -0,0 +1,141 @@
+;;; hashtable-tests.el --- Tests for hashtable.rs
+
+;;; Code:
+
+(require 'ert)
+
+(defun hashtable-tests--check (test keys)
+  "Put, find and remove KEYS in a fresh hash table using TEST."
+  (let ((table (make-hash-table :test test))
+        (n 0))
+    (dolist (key keys)
+      (puthash key n table)
+      (setq n (1+ n)))
+    (should (= (hash-table-count table) (length keys)))
+    (setq n 0)
+    (dolist (key keys)
+      (should (eql (gethash key table) n))
+      (setq n (1+ n)))
+    ;; Remove every other key, and check that the others are still
+    ;; found past the holes this leaves in the index.
+    (let ((tail keys))
+      (while tail
+        (remhash (car tail) table)
+        (setq tail (cddr tail))))
+    (setq n 0)
+    (dolist (key keys)
+      (should (eql (gethash key table 'none)
+                   (if (zerop (% n 2)) 'none n)))
+      (setq n (1+ n)))
+    (should (= (hash-table-count table) (/ (length keys) 2)))
+    ;; The freed entries are used again.
+    (dolist (key keys)
+      (puthash key t table))
+    (should (= (hash-table-count table) (length keys)))
+    (dolist (key keys)
+      (should (eq (gethash key table) t)))))
+
+(ert-deftest hashtable-tests-eq ()
+  (hashtable-tests--check 'eq (number-sequence 0 9999))
+  (hashtable-tests--check 'eq (mapcar (lambda (n) (list n))
+                                      (number-sequence 0 999))))
+
+(ert-deftest hashtable-tests-eql ()
+  (hashtable-tests--check 'eql (mapcar (lambda (n) (* n 0.5))
+                                       (number-sequence 0 4999))))
+
+(ert-deftest hashtable-tests-equal ()
+  (hashtable-tests--check 'equal (mapcar #'number-to-string
+                                         (number-sequence 0 9999)))
+  ;; Many keys with the same hash code.
+  (hashtable-tests--check 'equal (mapcar (lambda (n)
+                                           (make-list 10 (make-list n 0)))
+                                         (number-sequence 0 199))))
+
+(ert-deftest hashtable-tests-weak ()
+  (let ((table (make-hash-table :test 'eq :weakness 'key))
+        (kept (mapcar #'list (number-sequence 0 99))))
+    (dotimes (i 1000)
+      (puthash (list i) i table))
+    (dolist (key kept)
+      (puthash key t table))
+    (garbage-collect)
+    (dolist (key kept)
+      (should (eq (gethash key table) t)))
+    (should (<= (length kept) (hash-table-count table)))
+    (maphash (lambda (key value)
+               (should (eq (gethash key table) value)))
+             table)))
+
+(ert-deftest hashtable-tests-incremental-resize ()
+  (let ((hash-table-incremental-resize 1))
+    (hashtable-tests--check 'eq (number-sequence 0 9999))
+    (hashtable-tests--check 'equal (mapcar #'number-to-string
+                                           (number-sequence 0 9999)))
+    ;; Copy and clear a table while it is being resized.
+    (let ((table (make-hash-table :test 'eql :size 100)))
+      (dotimes (i 101)
+        (puthash i i table))
+      (let ((copy (copy-hash-table table)))
+        (remhash 0 table)
+        (dotimes (i 101)
+          (should (eql (gethash i copy) i))))
+      (clrhash table)
+      (should-not (gethash 50 table))
+      (puthash 50 t table)
+      (should (eq (gethash 50 table) t)))))
+
+(ert-deftest hashtable-tests-copy ()
+  (let ((table (make-hash-table :test 'equal)))
+    (dotimes (i 1000)
+      (puthash (format "%d" i) i table))
+    (let ((copy (copy-hash-table table)))
+      (remhash "0" table)
+      (should (eql (gethash "0" copy) 0))
+      (puthash "new" 'new copy)
+      (should-not (gethash "new" table))
+      (dotimes (i 1000)
+        (should (eql (gethash (format "%d" i) copy) i))))))
+
+(ert-deftest hashtable-tests-benchmark ()
+  :tags '(:expensive-test)
+  (dolist (test '(eq equal))
+    (dolist (n (if (eq test 'eq)
+                   '(1000 10000 100000 1000000 10000000)
+                 '(1000 10000 100000 1000000)))
+      (let ((keys (if (eq test 'eq)
+                      (number-sequence 1 n)
+                    (mapcar #'number-to-string (number-sequence 1 n))))
+            (table (make-hash-table :test test)))
+        (message "%s, %d entries: puthash %.3fs, gethash %.3fs"
+                 test n
+                 (car (benchmark-run 1
+                        (dolist (key keys) (puthash key key table))))
+                 (car (benchmark-run 1
+                        (dolist (key keys) (gethash key table)))))))))
+
+;; Print how many `puthash' calls took about each power of two
+;; microseconds, with and without incremental resizing.
+(ert-deftest hashtable-tests-resize-latency-benchmark ()
+  :tags '(:expensive-test)
+  (dolist (incremental '(nil 1000))
+    (let ((hash-table-incremental-resize incremental)
+          (table (make-hash-table :test 'eq))
+          (histogram (make-vector 32 0))
+          (worst 0))
+      (dotimes (i 4000000)
+        (let* ((start (float-time))
+               (_ (puthash i i table))
+               (usecs (* 1e6 (- (float-time) start)))
+               (bucket (min 31 (max 0 (ceiling (log (max usecs 1) 2))))))
+          (aset histogram bucket (1+ (aref histogram bucket)))
+          (setq worst (max worst usecs))))
+      (message "incremental resize %s: worst puthash %.0fus"
+               incremental worst)
+      (dotimes (bucket 32)
+        (unless (zerop (aref histogram bucket))
+          (message "  <= %8dus: %d" (expt 2 bucket)
+                   (aref histogram bucket)))))))
+
+(provide 'rust-hashtable-tests)
+;;; hashtable-tests.el ends here
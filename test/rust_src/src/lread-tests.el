@@ -224,4 +224,283 @@ literals (Bug#20852)."
     (should (eq (unintern "b" obarray) t))
     (should (equal obarray [0]))))
 
+;; Files that `load' reads directly, rather than through
+;; `load-source-file-function', are read from memory.
+(defvar lread-tests--read)
+
+(ert-deftest lread-tests-load-from-memory ()
+  (let ((file (make-temp-file "lread-tests" nil ".el"))
+        (value (list (make-string 10000 ?a)
+                     "a\"b\\c\nd\te"
+                     "ünïcödé and ascii"
+                     (string 0 1 127)
+                     (intern (make-string 500 ?s))
+                     (intern "a b")
+                     (intern "x(y)z")
+                     (intern "ünï")
+                     1.5 -17 [vec "tor"])))
+    (unwind-protect
+        (progn
+          (let ((coding-system-for-write 'utf-8-unix))
+            (with-temp-file file
+              (prin1 `(setq lread-tests--read ',value) (current-buffer))))
+          (let ((load-source-file-function nil)
+                (lread-tests--read nil))
+            (load file nil t t)
+            (should (equal lread-tests--read value))))
+      (delete-file file))))
+
+(ert-deftest lread-tests-load-dynamic ()
+  (let* ((file (make-temp-file "lread-tests" nil ".el"))
+         (elc (concat file "c")))
+    (unwind-protect
+        (progn
+          (with-temp-file file
+            (insert ";; -*- lexical-binding: t; byte-compile-dynamic: t -*-\n"
+                    "(defun lread-tests--dynamic-1 ()\n"
+                    "  \"First docstring, kept in the file.\"\n"
+                    "  (list 1 \"one\"))\n"
+                    "(defun lread-tests--dynamic-2 ()\n"
+                    "  \"Second docstring, also kept in the file.\"\n"
+                    "  (list 2 \"two\"))\n"))
+          (let ((byte-compile-dest-file-function (lambda (_) elc)))
+            (should (byte-compile-file file)))
+          (dolist (force '(nil t))
+            (let ((load-force-doc-strings force))
+              (load elc nil t t))
+            (should (equal (documentation 'lread-tests--dynamic-1)
+                           "First docstring, kept in the file."))
+            (should (equal (documentation 'lread-tests--dynamic-2)
+                           "Second docstring, also kept in the file."))
+            (should (equal (lread-tests--dynamic-1) '(1 "one")))
+            (should (equal (lread-tests--dynamic-2) '(2 "two")))))
+      (delete-file file)
+      (delete-file elc))))
+
+;; Read, without evaluating, every compiled file in the lisp directory.
+(ert-deftest lread-tests-load-benchmark ()
+  :tags '(:expensive-test)
+  (let ((files (directory-files-recursively
+                (expand-file-name "lisp" source-directory) "\\.elc\\'"))
+        (load-read-function (lambda (stream) (read stream) nil))
+        (bytes 0))
+    (dolist (file files)
+      (setq bytes (+ bytes (file-attribute-size (file-attributes file)))))
+    (message "Read %d files, %d bytes, in %.3fs"
+             (length files) bytes
+             (car (benchmark-run 1
+                    (dolist (file files)
+                      (load file nil t t)))))))
+
+;; Directories are only indexed once their modification time is a
+;; few seconds old, so push it back after each change.
+(defun lread-tests--age-directory (dir seconds)
+  (set-file-times dir (time-subtract nil seconds)))
+
+(ert-deftest lread-tests-load-path-index ()
+  (let ((dir (make-temp-file "lread-tests" t))
+        (load-path-use-index t))
+    (unwind-protect
+        (let ((path (list dir (expand-file-name "missing" dir))))
+          (write-region "" nil (expand-file-name "a.el" dir) nil 'silent)
+          (lread-tests--age-directory dir 100)
+          (should (equal (locate-file "a" path '(".elc" ".el"))
+                         (expand-file-name "a.el" dir)))
+          (should-not (locate-file "b" path '(".elc" ".el")))
+          ;; A new file is found as soon as it exists.
+          (write-region "" nil (expand-file-name "b.el" dir) nil 'silent)
+          (should (locate-file "b" path '(".elc" ".el")))
+          (lread-tests--age-directory dir 50)
+          (should (locate-file "b" path '(".elc" ".el")))
+          ;; So is a deleted file's absence.
+          (delete-file (expand-file-name "a.el" dir))
+          (lread-tests--age-directory dir 25)
+          (should-not (locate-file "a" path '(".elc" ".el")))
+          (should (locate-file "b" path '(".elc" ".el"))))
+      (delete-directory dir t))))
+
+;; Count the system calls made by a separate Emacs that requires some
+;; libraries with many directories in `load-path', with and without
+;; the directory index.
+(ert-deftest lread-tests-load-path-index-benchmark ()
+  :tags '(:expensive-test)
+  (skip-unless (executable-find "strace"))
+  (let ((dirs (make-temp-file "lread-tests" t))
+        (output (make-temp-file "lread-tests")))
+    (unwind-protect
+        (let ((path (mapcar (lambda (i)
+                              (let ((dir (expand-file-name
+                                          (format "%d" i) dirs)))
+                                (make-directory dir)
+                                (lread-tests--age-directory dir 100)
+                                dir))
+                            (number-sequence 1 300))))
+          (dolist (index '(nil t))
+            (call-process
+             "strace" nil nil nil "-f" "-c" "-o" output
+             (expand-file-name invocation-name invocation-directory)
+             "-Q" "--batch" "--eval"
+             (format "%S"
+                     `(let ((load-path-use-index ,index))
+                        (setq load-path (append ',path load-path))
+                        (dolist (feature '(cl-lib subr-x seq map pcase
+                                           ert dired org))
+                          (require feature)))))
+            (with-temp-buffer
+              (insert-file-contents output)
+              ;; The total line has the time, seconds, microseconds
+              ;; per call, calls, errors and "total".
+              (when (re-search-forward "^.* total$" nil t)
+                (let ((fields (split-string (match-string 0))))
+                  (message "load-path-use-index %s: %s system calls, %s errors"
+                           index (nth 3 fields)
+                           (if (= (length fields) 6) (nth 4 fields) 0)))))))
+      (delete-directory dirs t)
+      (delete-file output))))
+
+;; Binary compiled files.
+(defvar lread-tests--binary-var)
+(defvar lread-tests--binary-shared)
+
+(defun lread-tests--compile-binary (file prefix n binary)
+  "Write N functions named PREFIX-I and a few variables to FILE.
+Compile FILE, in binary form if BINARY is non-nil, and return the name
+of the compiled file."
+  (let ((elc (concat file "c")))
+    (with-temp-file file
+      (insert (format ";; -*- lexical-binding: t; byte-compile-binary: %S -*-\n"
+                      binary)
+              "(defvar lread-tests--binary-var\n"
+              "  '(1.5 -3 \"ünï\" [a \"b\"] #s(r 1))\n"
+              "  \"A variable.\")\n"
+              "(defvar lread-tests--binary-shared\n"
+              "  '(#1=#:s #1# #2=\"str\" #2#))\n"
+              "(defmacro lread-tests--binary-macro (x)\n"
+              "  \"A macro.\"\n"
+              "  `(list ,x ,x))\n")
+      (dotimes (i n)
+        (insert (format "(defun %s-%d (x)\n  %S\n  (list x %d %S (lread-tests--binary-macro x)))\n"
+                        prefix i (format "Function %d." i) i
+                        (format "ünï %d" i)))))
+    (let ((byte-compile-dest-file-function (lambda (_) elc)))
+      (should (byte-compile-file file)))
+    elc))
+
+(defun lread-tests--check-binary (prefix n)
+  (should (equal lread-tests--binary-var '(1.5 -3 "ünï" [a "b"] #s(r 1))))
+  (should (equal (documentation-property 'lread-tests--binary-var
+                                         'variable-documentation)
+                 "A variable."))
+  (let ((shared lread-tests--binary-shared))
+    (should (eq (nth 0 shared) (nth 1 shared)))
+    (should-not (intern-soft (nth 0 shared)))
+    (should (eq (nth 2 shared) (nth 3 shared))))
+  (dotimes (i n)
+    (let ((fun (intern (format "%s-%d" prefix i))))
+      (should (equal (documentation fun) (format "Function %d." i)))
+      (should (equal (funcall fun 'x) (list 'x i (format "ünï %d" i) '(x x)))))))
+
+(ert-deftest lread-tests-load-binary ()
+  (let* ((file (make-temp-file "lread-tests" nil ".el"))
+         (elc (lread-tests--compile-binary file "lread-tests--binary" 3 t))
+         (converted (make-temp-file "lread-tests" nil ".elc"))
+         (bad (make-temp-file "lread-tests" nil ".elc")))
+    (unwind-protect
+        (progn
+          (with-temp-buffer
+            (set-buffer-multibyte nil)
+            (insert-file-contents-literally elc nil 0 5)
+            (should (equal (buffer-string) ";ELC\177")))
+          (load elc nil t t)
+          ;; Function bodies stay in the file until the first call.
+          (should (consp (aref (symbol-function 'lread-tests--binary-0) 1)))
+          (should (equal (macroexpand '(lread-tests--binary-macro 1))
+                         '(list 1 1)))
+          (lread-tests--check-binary "lread-tests--binary" 3)
+          (should (stringp (aref (symbol-function 'lread-tests--binary-0) 1)))
+          ;; A compiled file can also be converted afterwards.
+          (lread-tests--compile-binary file "lread-tests--binary-text" 2 nil)
+          (should (equal (write-binary-compiled-file elc converted) converted))
+          (load converted nil t t)
+          (lread-tests--check-binary "lread-tests--binary-text" 2)
+          ;; A truncated file is an error.
+          (with-temp-buffer
+            (set-buffer-multibyte nil)
+            (insert-file-contents-literally converted)
+            (delete-region (- (point-max) 10) (point-max))
+            (write-region nil nil bad nil 'silent))
+          (should-error (load bad nil t t)))
+      (delete-file file)
+      (delete-file elc)
+      (delete-file converted)
+      (delete-file bad))))
+
+(ert-deftest lread-tests-load-binary-read-function ()
+  "Binary compiled files are read with `load-read-function'."
+  (let* ((file (make-temp-file "lread-tests" nil ".el"))
+         (elc (lread-tests--compile-binary file "lread-tests--binary-read" 2 t))
+         (forms nil)
+         (load-read-function (lambda (stream)
+                               (let ((form (read stream)))
+                                 (push form forms)
+                                 form))))
+    (unwind-protect
+        (progn
+          (load elc nil t t)
+          (should (assq 'defvar (mapcar #'car-safe forms)))
+          (lread-tests--check-binary "lread-tests--binary-read" 2)
+          (let ((history (cdr (assoc (file-truename elc) load-history))))
+            (should (member '(defun . lread-tests--binary-read-1) history))
+            (should (memq 'lread-tests--binary-var history))))
+      (delete-file file)
+      (delete-file elc))))
+
+(ert-deftest lread-tests-load-binary-replaced ()
+  "Functions whose binary compiled file was replaced are not fetched."
+  (let* ((file (make-temp-file "lread-tests" nil ".el"))
+         (elc (lread-tests--compile-binary file "lread-tests--binary-old" 2 t)))
+    (unwind-protect
+        (progn
+          (load elc nil t t)
+          (should (consp (aref (symbol-function 'lread-tests--binary-old-1) 1)))
+          (lread-tests--compile-binary file "lread-tests--binary-new" 3 t)
+          (should-error (lread-tests--binary-old-1 0))
+          (should (consp (aref (symbol-function 'lread-tests--binary-old-1) 1))))
+      (delete-file file)
+      (delete-file elc))))
+
+;; Compare loading a file with many functions in text and binary form.
+(ert-deftest lread-tests-load-binary-benchmark ()
+  :tags '(:expensive-test)
+  (let* ((n 5000)
+         (file (make-temp-file "lread-tests" nil ".el"))
+         (elc (lread-tests--compile-binary file "lread-tests--bench" n nil))
+         (binary (make-temp-file "lread-tests" nil ".elc"))
+         (chars nil))
+    (unwind-protect
+        (progn
+          (write-binary-compiled-file elc binary)
+          ;; Load each file once first, so that neither load pays for
+          ;; making the symbols.
+          (load elc nil t t)
+          (load binary nil t t)
+          (dolist (f (list elc binary))
+            (garbage-collect)
+            (let* ((before (nth 4 (memory-use-counts)))
+                   (time (car (benchmark-run 1 (load f nil t t))))
+                   (used (- (nth 4 (memory-use-counts)) before)))
+              (message "%s: %d bytes, loaded in %.3fs, %d string chars"
+                       (if (eq f elc) "text" "binary")
+                       (file-attribute-size (file-attributes f)) time used)
+              (push used chars)))
+          ;; The binary file leaves byte code and constants unread.
+          (should (< (nth 0 chars) (/ (nth 1 chars) 2)))
+          (message "first calls %.3fs"
+                   (car (benchmark-run 1
+                          (lread-tests--check-binary "lread-tests--bench"
+                                                     n)))))
+      (delete-file file)
+      (delete-file elc)
+      (delete-file binary))))
+
 ;;; lread-tests.el ends here
@@ -31,3 +31,80 @@
   (should-error
    (mapatoms (lambda (s)) 123)
    :type 'wrong-type-argument))
+
+(defun obarray-tests--names (n)
+  (let ((names nil))
+    (dotimes (i n)
+      (push (format "obarray-tests--%d" i) names))
+    names))
+
+(ert-deftest obarray-tests-intern-many ()
+  ;; Enough symbols that the global obarray has to find room for them.
+  (let* ((names (obarray-tests--names 50000))
+         (syms (mapcar #'intern names))
+         (count 0))
+    (unwind-protect
+        (progn
+          (should (equal (mapcar #'intern-soft names) syms))
+          (should (equal (mapcar #'intern names) syms))
+          (mapatoms (lambda (s)
+                      (when (string-prefix-p "obarray-tests--" (symbol-name s))
+                        (setq count (1+ count)))))
+          (should (= count 50000)))
+      (mapc #'unintern syms))
+    (should-not (delq nil (mapcar #'intern-soft names)))
+    ;; Interning a name again after uninterning it makes a new symbol.
+    (let ((sym (intern (car names))))
+      (unwind-protect
+          (progn
+            (should-not (eq sym (car syms)))
+            (should (eq (intern-soft (car names)) sym)))
+        (unintern sym)))))
+
+(ert-deftest obarray-tests-unintern-keeps-others ()
+  (let ((syms (mapcar #'intern (obarray-tests--names 2000))))
+    (unwind-protect
+        (progn
+          (dolist (sym syms)
+            (when (zerop (% (length (symbol-name sym)) 2))
+              (unintern sym)))
+          (dolist (sym syms)
+            (should (eq (intern-soft (symbol-name sym))
+                        (and (/= 0 (% (length (symbol-name sym)) 2)) sym)))))
+      (mapc #'unintern syms))))
+
+(ert-deftest obarray-tests-rebuild-index ()
+  ;; The index is built again from the obarray, which has more symbols
+  ;; than its smallest size can hold, as in a dumped Emacs.
+  (let* ((names (obarray-tests--names 40000))
+         (syms (mapcar #'intern names)))
+    (unwind-protect
+        (progn
+          (internal--obarray-reset-index)
+          (should-not (intern-soft "obarray-tests--missing"))
+          (should (equal (mapcar #'intern-soft names) syms))
+          ;; And it grows as more are interned after that.
+          (internal--obarray-reset-index)
+          (let* ((more (mapcar (lambda (name) (concat name "-more")) names))
+                 (more-syms (mapcar #'intern more)))
+            (unwind-protect
+                (progn
+                  (should (equal (mapcar #'intern-soft more) more-syms))
+                  (should (equal (mapcar #'intern-soft names) syms))
+                  (should-not (intern-soft "obarray-tests--missing")))
+              (mapc #'unintern more-syms))))
+      (mapc #'unintern syms))))
+
+(ert-deftest obarray-tests-intern-benchmark ()
+  :tags '(:expensive-test)
+  (let ((names (obarray-tests--names 1000000))
+        syms)
+    (unwind-protect
+        (progn
+          (message "intern 1000000 new symbols: %.3fs"
+                   (car (benchmark-run 1
+                          (setq syms (mapcar #'intern names)))))
+          (message "intern-soft 1000000 symbols: %.3fs"
+                   (car (benchmark-run 1
+                          (mapc #'intern-soft names)))))
+      (mapc #'unintern syms))))
@@ -1,3 +1,85 @@
 (ert-deftest vector-tests-make ()
   (let ((v (make-vector 10 "asdfghjklqwertyuiopzxcvbnm")))
     (should (= 10 (length v)))))
+
+(defun vector-tests--random-pairs (n keys)
+  "Return a list of N conses of random keys below KEYS and their indices."
+  (let (list)
+    (dotimes (i n)
+      (push (cons (random keys) (- n i 1)) list))
+    list))
+
+(defun vector-tests--check-sorted (seq)
+  "Check that SEQ is sorted by key, and by index among equal keys."
+  (let ((prev nil))
+    (mapc (lambda (pair)
+            (when prev
+              (should (or (< (car prev) (car pair))
+                          (and (= (car prev) (car pair))
+                               (< (cdr prev) (cdr pair))))))
+            (setq prev pair))
+          seq)))
+
+(ert-deftest vector-tests-sort-stable ()
+  (dolist (n '(0 1 2 3 31 32 33 64 65 100 1000 10000))
+    (dolist (keys (list 2 10 (max n 1)))
+      (let ((list (vector-tests--random-pairs n keys))
+            (less (lambda (a b) (< (car a) (car b)))))
+        (vector-tests--check-sorted (sort (vconcat list) less))
+        (let ((sorted (sort (copy-sequence list) less)))
+          (should (= (length sorted) n))
+          (vector-tests--check-sorted sorted))
+        ;; Runs in order and in reverse order, with equal keys.
+        (let ((runs (append (sort (copy-sequence list) less)
+                            (nreverse (sort (copy-sequence list) less)))))
+          (setq runs (let ((i -1))
+                       (mapcar (lambda (pair)
+                                 (cons (car pair) (setq i (1+ i))))
+                               runs)))
+          (vector-tests--check-sorted (sort runs less)))))))
+
+(defvar vector-tests--calls 0)
+
+(defun vector-tests--less (a b)
+  (setq vector-tests--calls (1+ vector-tests--calls))
+  (< a b))
+
+(ert-deftest vector-tests-sort-builtin-predicates ()
+  (let ((numbers (list 3 1.5 -2 7 0 1.5 2)))
+    (should (equal (sort (copy-sequence numbers) '<) '(-2 0 1.5 1.5 2 3 7)))
+    (should (equal (sort (copy-sequence numbers) #'>) '(7 3 2 1.5 1.5 0 -2)))
+    (should (equal (sort (vconcat numbers) '<) [-2 0 1.5 1.5 2 3 7])))
+  (should (equal (sort (list "b" "a" 'c "ab") 'string<) '("a" "ab" "b" c)))
+  (should (equal (sort (list "b" "a" "ab") #'string-lessp) '("a" "ab" "b")))
+  (with-temp-buffer
+    (insert "hello")
+    (let ((marker (copy-marker 3)))
+      (should (equal (sort (list 4 marker 1) '<) (list 1 marker 4)))))
+  (should-error (sort (list 1 'a 2) '<) :type 'wrong-type-argument)
+  (should-error (sort (list "a" 1) 'string<) :type 'wrong-type-argument)
+  ;; Other predicates are called, even if they are defined with `<'.
+  (setq vector-tests--calls 0)
+  (should (equal (sort (list 3 1 2) 'vector-tests--less) '(1 2 3)))
+  (should (> vector-tests--calls 0)))
+
+(ert-deftest vector-tests-sort-benchmark ()
+  :tags '(:expensive-test)
+  (let* ((n 1000000)
+         (numbers (let (list) (dotimes (_ n) (push (random n) list)) list))
+         (inputs `((random . ,numbers)
+                   (presorted . ,(number-sequence 1 n))
+                   (reverse . ,(number-sequence n 1 -1)))))
+    (dolist (input inputs)
+      (dolist (pred (list '< (lambda (a b) (< a b))))
+        (dolist (type '(list vector))
+          (let ((seq (if (eq type 'list)
+                         (copy-sequence (cdr input))
+                       (vconcat (cdr input)))))
+            (message "sort %s %s of %d, %s: %.3fs"
+                     (car input) type n
+                     (if (symbolp pred) pred 'lambda)
+                     (car (benchmark-run 1 (sort seq pred)))))))))
+  (let ((strings (mapcar (lambda (_) (number-to-string (random)))
+                         (make-list 100000 nil))))
+    (message "sort 100000 strings with string<: %.3fs"
+             (car (benchmark-run 1 (sort strings 'string<))))))
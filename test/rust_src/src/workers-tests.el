@@ -0,0 +1,92 @@
+;;; workers-tests.el --- Tests for workers.rs
+
+;;; Code:
+
+(require 'ert)
+
+(ert-deftest workers-tests-secure-hash ()
+  (let ((string (make-string 100000 ?a)))
+    (dolist (algorithm (secure-hash-algorithms))
+      (let ((future (worker-secure-hash algorithm string)))
+        (should (worker-future-p future))
+        (should (equal (worker-future-value future)
+                       (secure-hash algorithm string)))
+        (should (worker-future-done-p future)))))
+  (should-error (worker-secure-hash 'no-such-hash "a")))
+
+(ert-deftest workers-tests-copies-input ()
+  (let* ((string (make-string 1000 ?a))
+         (expected (secure-hash 'sha256 string))
+         (future (worker-secure-hash 'sha256 string)))
+    (aset string 0 ?b)
+    (garbage-collect)
+    (should (equal (worker-future-value future) expected))))
+
+(ert-deftest workers-tests-base64 ()
+  (dolist (string '("" "a" "abc" "hello, world"))
+    (let ((encoded (worker-future-value (worker-base64-encode string))))
+      (should (equal encoded (base64-encode-string string)))
+      (should (equal (worker-future-value (worker-base64-decode encoded))
+                     string))))
+  (let ((long (make-string 200 ?x)))
+    (should (equal (worker-future-value (worker-base64-encode long t))
+                   (base64-encode-string long t))))
+  (should-error (worker-future-value (worker-base64-encode "é中")))
+  (should-error (worker-future-value (worker-base64-decode "!!!!"))))
+
+(ert-deftest workers-tests-zlib-decompress ()
+  (dolist (compressed
+           '("\170\234\313\110\315\311\311\327\121\50\317\57\312\111\341\2\0\41\347\4\223"
+             "\37\213\10\0\0\0\0\0\2\3\313\110\315\311\311\327\121\50\317\57\312\111\341\2\0\123\164\44\364\15\0\0\0"))
+    (should (equal (worker-future-value (worker-zlib-decompress compressed))
+                   "hello, world\n")))
+  (should-error (worker-future-value (worker-zlib-decompress "")))
+  (should-error (worker-zlib-decompress "é")))
+
+(ert-deftest workers-tests-timeout ()
+  (let ((future (worker-secure-hash 'sha512 (make-string 1000 ?a))))
+    (should (or (null (worker-future-value future 0))
+                (worker-future-done-p future)))
+    (should (stringp (worker-future-value future 60)))))
+
+(ert-deftest workers-tests-then ()
+  (let* ((calls nil)
+         (future (worker-secure-hash 'md5 "abc"))
+         (callback (lambda (f)
+                     (push (worker-future-value f) calls))))
+    (should (eq (worker-future-then future callback) future))
+    (worker-future-value future)
+    ;; A callback added after the task is done is called too.
+    (worker-future-then future callback)
+    (dotimes (_ 100)
+      (when (< (length calls) 2)
+        (accept-process-output nil 0.05)))
+    (should (equal calls (list (md5 "abc") (md5 "abc"))))))
+
+(ert-deftest workers-tests-many ()
+  (let* ((strings (mapcar #'number-to-string (number-sequence 1 500)))
+         (futures (mapcar (lambda (s) (worker-secure-hash 'sha1 s)) strings)))
+    (garbage-collect)
+    (while strings
+      (should (equal (worker-future-value (car futures))
+                     (sha1 (car strings))))
+      (setq strings (cdr strings)
+            futures (cdr futures)))))
+
+(ert-deftest workers-tests-benchmark ()
+  :tags '(:expensive-test)
+  (let ((strings (mapcar (lambda (c) (make-string (* 16 1024 1024) c))
+                         (number-sequence ?a ?h))))
+    (message "secure-hash, %d strings of 16MB: %.3fs in turn, %.3fs in workers"
+             (length strings)
+             (car (benchmark-run 1
+                    (dolist (string strings)
+                      (secure-hash 'sha256 string))))
+             (car (benchmark-run 1
+                    (mapc #'worker-future-value
+                          (mapcar (lambda (string)
+                                    (worker-secure-hash 'sha256 string))
+                                  strings)))))))
+
+(provide 'rust-workers-tests)
+;;; workers-tests.el ends here
@@ -37,3 +37,89 @@
         (split-string-and-unquote (buffer-string)))
     (should (equal initial-shell "nil"))
     (should-not (equal initial-shell shell))))
+
+(defun callproc-tests--sh (command)
+  "Return what the shell prints for COMMAND, with and without `posix_spawn'.
+Check that both ways of starting it give the same output."
+  (let ((outputs
+         (mapcar (lambda (spawn)
+                   (let ((process-use-posix-spawn spawn))
+                     (with-temp-buffer
+                       (should (eq (call-process "/bin/sh" nil t nil
+                                                 "-c" command)
+                                   0))
+                       (buffer-string))))
+                 '(t nil))))
+    (should (equal (car outputs) (cadr outputs)))
+    (car outputs)))
+
+(ert-deftest call-process-environment ()
+  (skip-unless (file-executable-p "/bin/sh"))
+  (let ((process-environment (cons "CALLPROC_TEST=1" process-environment)))
+    (should (equal (callproc-tests--sh "echo $CALLPROC_TEST") "1\n"))
+    ;; The environment that is passed down follows changes to the
+    ;; list, and to its elements.
+    (setenv "CALLPROC_TEST" "2")
+    (should (equal (callproc-tests--sh "echo $CALLPROC_TEST") "2\n"))
+    (setcar process-environment "CALLPROC_TEST=3")
+    (should (equal (callproc-tests--sh "echo $CALLPROC_TEST") "3\n"))
+    (push "CALLPROC_TEST=4" process-environment)
+    (should (equal (callproc-tests--sh "echo $CALLPROC_TEST") "4\n"))
+    (push "CALLPROC_TEST" process-environment)
+    (should (equal (callproc-tests--sh "echo ${CALLPROC_TEST-unset}")
+                   "unset\n"))))
+
+(ert-deftest call-process-pwd ()
+  (skip-unless (file-executable-p "/bin/sh"))
+  (let ((default-directory "/")
+        (process-environment (cons "PWD=/nowhere" process-environment)))
+    (should (equal (callproc-tests--sh "pwd; echo $PWD") "/\n/\n")))
+  (let ((default-directory (file-name-as-directory
+                            (file-truename temporary-file-directory)))
+        (process-environment (cons "PWD" process-environment)))
+    (should (equal (callproc-tests--sh "pwd; echo ${PWD-unset}")
+                   (concat (directory-file-name default-directory)
+                           "\nunset\n")))))
+
+(ert-deftest make-process-environment ()
+  (skip-unless (file-executable-p "/bin/sh"))
+  (dolist (spawn '(t nil))
+    (let* ((process-use-posix-spawn spawn)
+           (process-environment (cons "CALLPROC_TEST=async"
+                                      process-environment))
+           (default-directory "/")
+           (proc (make-process :name "callproc-test"
+                               :command '("/bin/sh" "-c"
+                                          "echo $CALLPROC_TEST; pwd")
+                               :buffer (generate-new-buffer "callproc-test")
+                               :connection-type 'pipe)))
+      (unwind-protect
+          (progn
+            (while (process-live-p proc)
+              (accept-process-output proc 0.1))
+            (should (eq (process-exit-status proc) 0))
+            (with-current-buffer (process-buffer proc)
+              (should (equal (buffer-string) "async\n/\n"))))
+        (kill-buffer (process-buffer proc))))))
+
+(ert-deftest call-process-benchmark ()
+  :tags '(:expensive-test)
+  (skip-unless (executable-find "true"))
+  (let ((true (executable-find "true")))
+    (dolist (spawn '(t nil))
+      (let ((process-use-posix-spawn spawn))
+        (message "posix_spawn %s: 1000 call-process %.3fs, 1000 make-process %.3fs"
+                 spawn
+                 (car (benchmark-run 1
+                        (dotimes (_ 1000)
+                          (call-process true))))
+                 (car (benchmark-run 1
+                        (let (procs)
+                          (dotimes (_ 1000)
+                            (push (make-process :name "true"
+                                                :command (list true)
+                                                :connection-type 'pipe)
+                                  procs))
+                          (dolist (proc procs)
+                            (while (process-live-p proc)
+                              (accept-process-output proc 0.01)))))))))))
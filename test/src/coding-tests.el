@@ -291,6 +291,136 @@
 		     ascii nil 'utf-8-unix "À")))
     (coding-tests-remove-files)))
 
+(ert-deftest ert-test-coding-utf-8-word-boundaries ()
+  ;; The UTF-8 scanners look at whole words of ASCII bytes; make sure
+  ;; non-ASCII characters, CRs and invalid bytes are found wherever
+  ;; they fall relative to a word.
+  (dotimes (prefix 17)
+    (let ((head (make-string prefix ?a)))
+      (dolist (tail '("é" "あ" "😀" "\r\n" "\r"))
+        (let* ((text (concat head tail "xyzzy0123456789"))
+               (bytes (encode-coding-string text 'utf-8-unix)))
+          (should (equal (decode-coding-string bytes 'utf-8-unix) text))
+          (with-temp-buffer
+            (set-buffer-multibyte nil)
+            (insert bytes)
+            (decode-coding-region (point-min) (point-max) 'utf-8-unix)
+            (should (equal (buffer-string) text)))))
+      (let ((bytes (concat head "\300\300" (make-string 16 ?b))))
+        (should (equal (decode-coding-string bytes 'utf-8-unix)
+                       (concat head
+                               (string (unibyte-char-to-multibyte ?\300)
+                                       (unibyte-char-to-multibyte ?\300))
+                               (make-string 16 ?b))))))))
+
+(ert-deftest ert-test-coding-utf-8-insert-file-char-count ()
+  (unwind-protect
+      (let* ((contents (mapconcat (lambda (n) (format "%d λ→∀ 😀 line\n" n))
+                                  (number-sequence 1 500) ""))
+             (file (coding-tests-gen-file "utf-8-count.txt" contents
+                                          'utf-8-unix)))
+        (with-temp-buffer
+          (let ((coding-system-for-read 'utf-8-unix))
+            (insert-file-contents file))
+          (should (= (buffer-size) (length contents)))
+          (should (equal (buffer-string) contents))))
+    (coding-tests-remove-files)))
+
+(ert-deftest ert-test-coding-utf-8-encode-identity ()
+  ;; Text that is already valid UTF-8 is encoded as is.
+  (let ((str "abc λ→∀ 😀 def"))
+    (should (equal (encode-coding-string str 'utf-8-unix)
+                   (string-as-unibyte str))))
+  ;; Raw bytes still need converting back to single bytes.
+  (let ((str (concat "a" (string (unibyte-char-to-multibyte #xff)) "b")))
+    (should (equal (encode-coding-string str 'utf-8-unix) "a\377b")))
+  ;; So do line ends when the EOL type is not Unix.
+  (should (equal (encode-coding-string "a\nb" 'utf-8-dos) "a\r\nb")))
+
+(ert-deftest ert-test-coding-utf-8-write-region-identity ()
+  (unwind-protect
+      (let ((contents (mapconcat (lambda (n) (format "%d λ→∀ 😀 line\n" n))
+                                 (number-sequence 1 500) ""))
+            (file (expand-file-name "utf-8-write.txt" coding-tests-workdir)))
+        (or (file-directory-p coding-tests-workdir)
+            (mkdir coding-tests-workdir t))
+        (with-temp-buffer
+          (insert contents)
+          ;; Put the gap in the middle of the text written.
+          (goto-char (/ (point-max) 2))
+          (insert "x")
+          (delete-char -1)
+          (let ((coding-system-for-write 'utf-8-unix))
+            (write-region nil nil file nil 'silent)))
+        (with-temp-buffer
+          (set-buffer-multibyte nil)
+          (insert-file-contents-literally file)
+          (should (equal (buffer-string) (encode-coding-string contents
+                                                               'utf-8)))))
+    (coding-tests-remove-files)))
+
+(ert-deftest ert-test-coding-utf-8-write-region-benchmark ()
+  :tags '(:expensive-test)
+  (let ((file (make-temp-file "coding-tests-write")))
+    (unwind-protect
+        (with-temp-buffer
+          (dotimes (i 200000)
+            (insert (format "%d λ→∀ 😀 some more ASCII text on this line\n" i)))
+          (let ((coding-system-for-write 'utf-8-unix))
+            (message "write-region %d bytes: %.3fs" (buffer-size)
+                     (car (benchmark-run 1
+                            (write-region nil nil file nil 'silent))))))
+      (delete-file file))))
+
+(defun coding-tests-insert-large-utf-8 (threads contents)
+  "Insert CONTENTS from a file decoding with THREADS threads."
+  (unwind-protect
+      (let ((file (coding-tests-gen-file "utf-8-large.txt" contents
+                                         'no-conversion)))
+        (with-temp-buffer
+          (let ((coding-system-for-read 'utf-8)
+                (coding-decode-threads threads))
+            (insert-file-contents file))
+          (list (buffer-string) last-coding-system-used)))
+    (coding-tests-remove-files)))
+
+(ert-deftest ert-test-coding-utf-8-decode-threads ()
+  ;; Several megabytes with CR LF and multibyte sequences everywhere,
+  ;; so that some of them straddle the pieces checked by each thread.
+  (let* ((line "λ→∀ 😀 text\r\n")
+         (contents (encode-coding-string
+                    (apply #'concat (make-list 200000 line)) 'utf-8)))
+    (should (equal (coding-tests-insert-large-utf-8 4 contents)
+                   (coding-tests-insert-large-utf-8 1 contents)))
+    (should (eq (nth 1 (coding-tests-insert-large-utf-8 4 contents))
+                'utf-8-dos))
+    ;; An invalid byte anywhere makes the whole text be decoded the
+    ;; slow way, in both cases.
+    (aset contents (/ (length contents) 3) #xff)
+    (should (equal (coding-tests-insert-large-utf-8 4 contents)
+                   (coding-tests-insert-large-utf-8 1 contents)))))
+
+(ert-deftest ert-test-coding-utf-8-decode-threads-benchmark ()
+  :tags '(:expensive-test)
+  (let ((file (make-temp-file "coding-tests-decode")))
+    (unwind-protect
+        (progn
+          (with-temp-buffer
+            (dotimes (i 2000000)
+              (insert (format "%d λ→∀ 😀 some more ASCII text on this line\n"
+                              i)))
+            (let ((coding-system-for-write 'utf-8-unix))
+              (write-region nil nil file nil 'silent)))
+          (dolist (threads '(1 2 4 8))
+            (with-temp-buffer
+              (let ((coding-system-for-read 'utf-8)
+                    (coding-decode-threads threads))
+                (message "insert-file-contents with %d threads: %.3fs"
+                         threads
+                         (car (benchmark-run 1
+                                (insert-file-contents file))))))))
+      (delete-file file))))
+
 
 ;;; The following is for benchmark testing of the new optimized
 ;;; decoder, not for regression testing.
@@ -0,0 +1,85 @@
+;;; composite-tests.el --- Tests for composite.c
+
+;; Copyright (C) 2018 Free Software Foundation, Inc.
+
+;; This program is free software; you can redistribute it and/or modify
+;; it under the terms of the GNU General Public License as published by
+;; the Free Software Foundation, either version 3 of the License, or
+;; (at your option) any later version.
+
+;; This program is distributed in the hope that it will be useful,
+;; but WITHOUT ANY WARRANTY; without even the implied warranty of
+;; MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+;; GNU General Public License for more details.
+
+;; You should have received a copy of the GNU General Public License
+;; along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+;;; Code:
+
+(require 'ert)
+
+(defun composite-tests--stat (name)
+  (cdr (assq name (composition-cache-statistics))))
+
+(ert-deftest composition-cache-statistics ()
+  (let ((stats (composition-cache-statistics)))
+    (dolist (name '(hits misses evictions entries bytes))
+      (should (natnump (cdr (assq name stats)))))))
+
+(ert-deftest composition-cache-counts-misses ()
+  ;; A glyph-string that was never shaped is not in the cache.
+  (let ((misses (composite-tests--stat 'misses))
+        (gstring (composition-get-gstring 0 2 nil "ab")))
+    (should (null (aref gstring 1)))
+    (should (= (composite-tests--stat 'misses) (1+ misses)))))
+
+(ert-deftest composition-cache-clear ()
+  (clear-composition-cache)
+  (should (= (composite-tests--stat 'entries) 0))
+  (should (= (composite-tests--stat 'bytes) 0)))
+
+(defun composite-tests--gstring (pos)
+  "Return the glyph-string of the automatic composition at POS."
+  (nth 2 (find-composition-internal pos nil nil t)))
+
+(defun composite-tests--glyphs (gstring)
+  "Return a copy of the glyphs of GSTRING."
+  (mapcar (lambda (glyph) (and glyph (copy-sequence glyph)))
+          (cddr (append gstring nil))))
+
+(ert-deftest composition-cache-evict ()
+  "Glyph-strings no longer displayed are evicted and shaped again."
+  (skip-unless (not noninteractive))
+  (let ((composition-cache-limit 1)
+        (buffer (generate-new-buffer "composite-tests")))
+    (unwind-protect
+        (save-window-excursion
+          (clear-composition-cache)
+          (switch-to-buffer buffer)
+          (dotimes (_ 10)
+            (insert "e\u0301 a\u0308 o\u0302 u\u0303\n"))
+          (redisplay t)
+          (let ((gstring (composite-tests--gstring 1)))
+            (skip-unless gstring)
+            ;; The displayed glyph-strings stay, although the cache is
+            ;; over the limit.
+            (should (natnump (aref gstring 1)))
+            (should (< 0 (composite-tests--stat 'entries)))
+            (let ((glyphs (composite-tests--glyphs gstring))
+                  (evictions (composite-tests--stat 'evictions))
+                  (misses (composite-tests--stat 'misses)))
+              (switch-to-buffer (get-buffer-create "*scratch*"))
+              (redisplay t)
+              (should (< evictions (composite-tests--stat 'evictions)))
+              (should (null (aref gstring 1)))
+              (switch-to-buffer buffer)
+              (redisplay t)
+              (should (< misses (composite-tests--stat 'misses)))
+              (let ((new (composite-tests--gstring 1)))
+                (should (natnump (aref new 1)))
+                (should (equal (composite-tests--glyphs new) glyphs))))))
+      (kill-buffer buffer))))
+
+(provide 'composite-tests)
+;;; composite-tests.el ends here
@@ -88,5 +88,55 @@ M-s		next-matching-history-element
   (should (string= (substitute-command-keys "\\=") "\\="))
   )
 
+(defun doc-tests--compile-dynamic (file n doc)
+  "Write N lazily loaded functions with doc strings DOC to FILE.
+Compile FILE and return the name of the compiled file."
+  (let ((elc (concat file "c")))
+    (with-temp-file file
+      (insert ";; -*- lexical-binding: t; byte-compile-dynamic: t -*-\n")
+      (dotimes (i n)
+        (insert (format "(defun doc-tests--lazy-%d (x)\n  %S\n  (list x %d %S))\n"
+                        i (format "%s %d." doc i) i doc))))
+    (let ((byte-compile-dest-file-function (lambda (_) elc)))
+      (should (byte-compile-file file)))
+    elc))
+
+(defun doc-tests--check-dynamic (n doc)
+  (dotimes (i n)
+    (let ((fun (intern (format "doc-tests--lazy-%d" i))))
+      (should (equal (documentation fun) (format "%s %d." doc i)))
+      (should (equal (funcall fun 'x) (list 'x i doc))))))
+
+(ert-deftest doc-tests-dynamic-definitions ()
+  (let* ((file (make-temp-file "doc-tests" nil ".el"))
+         (elc (concat file "c")))
+    (unwind-protect
+        (progn
+          (load (doc-tests--compile-dynamic file 20 "Old") nil t t)
+          (doc-tests--check-dynamic 20 "Old")
+          ;; The contents read for the old file must not be used once
+          ;; it has changed.
+          (load (doc-tests--compile-dynamic file 30 "Newer, longer doc")
+                nil t t)
+          (doc-tests--check-dynamic 30 "Newer, longer doc"))
+      (delete-file file)
+      (delete-file elc))))
+
+(ert-deftest doc-tests-dynamic-definitions-benchmark ()
+  :tags '(:expensive-test)
+  (let* ((file (make-temp-file "doc-tests" nil ".el"))
+         (elc (concat file "c"))
+         (n 5000))
+    (unwind-protect
+        (progn
+          (doc-tests--compile-dynamic file n "Doc")
+          (message "load %.3fs"
+                   (car (benchmark-run 1 (load elc nil t t))))
+          (message "first calls and doc strings %.3fs"
+                   (car (benchmark-run 1
+                          (doc-tests--check-dynamic n "Doc")))))
+      (delete-file file)
+      (delete-file elc))))
+
 (provide 'doc-tests)
 ;;; doc-tests.el ends here
@@ -104,4 +104,170 @@ crash/abort/malloc assert failure on the next test."
         (signal-hook-function #'ignore))
     (should-error (eval-tests--exceed-specbind-limit))))
 
+(defun eval-tests--callee (x)
+  (list 'old x))
+
+(defalias 'eval-tests--alias 'eval-tests--callee)
+
+(defun eval-tests--call-callee (n)
+  "Call `eval-tests--callee' and `eval-tests--alias' N times."
+  (let (result)
+    (dotimes (i n)
+      (setq result (list (eval-tests--callee i) (eval-tests--alias i))))
+    result))
+
+(ert-deftest eval-tests-call-cache-redefinition ()
+  "Check that compiled calls see new definitions of the functions they call."
+  (let ((caller (byte-compile 'eval-tests--call-callee))
+        (old (symbol-function 'eval-tests--callee)))
+    (unwind-protect
+        (progn
+          (should (equal (funcall caller 100) '((old 99) (old 99))))
+          (fset 'eval-tests--callee (lambda (x) (list 'new x)))
+          (should (equal (funcall caller 100) '((new 99) (new 99))))
+          (fset 'eval-tests--callee #'car)
+          (should-error (funcall caller 1) :type 'wrong-type-argument)
+          (fset 'eval-tests--callee (byte-compile (lambda (x) (* x 2))))
+          (should (equal (funcall caller 3) '(4 4)))
+          ;; The definition survives garbage collection.
+          (garbage-collect)
+          (should (equal (funcall caller 3) '(4 4)))
+          (fmakunbound 'eval-tests--callee)
+          (should-error (funcall caller 1) :type 'void-function))
+      (fset 'eval-tests--callee old))))
+
+(defun eval-tests--fib (n)
+  (if (< n 2) n (+ (eval-tests--fib (- n 1)) (eval-tests--fib (- n 2)))))
+
+(ert-deftest eval-tests-call-benchmark ()
+  :tags '(:expensive-test)
+  (require 'cl-lib)
+  (byte-compile 'eval-tests--fib)
+  (message "fib 30: %.3fs"
+           (car (benchmark-run 1 (eval-tests--fib 30))))
+  (let ((list (number-sequence 1 100000)))
+    (message "cl-lib sequence functions: %.3fs"
+             (car (benchmark-run 10
+                    (cl-reduce #'+ (cl-remove-if #'cl-oddp list))
+                    (cl-position 99999 list)
+                    (cl-count-if #'cl-evenp list)
+                    (cl-mapcar #'cons list list))))))
+
+;; Compiled with `byte-compile' below, so that the bindings are undone
+;; by the unbind instructions.
+(defvar eval-tests--plain 'global)
+(defvar eval-tests--watched 'global)
+(defvar-local eval-tests--local 'default)
+
+(defun eval-tests--bind (list)
+  "Return the values of some variables while binding them in LIST."
+  (let (result)
+    (dolist (x list)
+      (let ((eval-tests--plain x)
+            (eval-tests--watched x)
+            (eval-tests--local x))
+        (push (list eval-tests--plain eval-tests--watched eval-tests--local)
+              result)))
+    result))
+
+(ert-deftest eval-tests-unbind ()
+  "Check that compiled code undoes each kind of `let' binding."
+  (let ((bind (byte-compile 'eval-tests--bind))
+        (watched nil))
+    (add-variable-watcher 'eval-tests--watched
+                          (lambda (_ value op _)
+                            (push (cons op value) watched)))
+    (unwind-protect
+        (with-temp-buffer
+          (setq eval-tests--local 'local)
+          (should (equal (funcall bind '(1 2)) '((2 2 2) (1 1 1))))
+          (should (eq eval-tests--plain 'global))
+          (should (eq eval-tests--watched 'global))
+          (should (eq eval-tests--local 'local))
+          (should (eq (default-value 'eval-tests--local) 'default))
+          (should (equal (nreverse watched)
+                         '((let . 1) (unlet . global)
+                           (let . 2) (unlet . global)))))
+      (remove-variable-watcher 'eval-tests--watched
+                               (car (get-variable-watchers
+                                     'eval-tests--watched))))))
+
+(ert-deftest eval-tests-save-excursion ()
+  (with-temp-buffer
+    (insert "hello world")
+    (goto-char 3)
+    (let ((buffer (current-buffer)))
+      (with-temp-buffer
+        (save-excursion
+          (set-buffer buffer)
+          (goto-char (point-max))
+          (insert "!"))
+        (should-not (eq (current-buffer) buffer)))
+      (save-excursion
+        (goto-char (point-min))
+        (insert ">"))
+      ;; Point follows the text it was in.
+      (should (= (point) 4))
+      (should (equal (buffer-string) ">hello world!"))
+      ;; The same on a nonlocal exit, and from compiled code.
+      (funcall (byte-compile
+                (lambda ()
+                  (catch 'done
+                    (save-excursion
+                      (goto-char (point-max))
+                      (throw 'done nil))))))
+      (should (= (point) 4))
+      ;; A buffer killed in the excursion is not made current again.
+      (let ((other (generate-new-buffer " *eval-tests*")))
+        (save-excursion
+          (set-buffer other)
+          (save-excursion
+            (kill-buffer other)))
+        (should (eq (current-buffer) buffer))))))
+;; Also compiled, so that the buffer is restored by the unbind
+;; instructions.
+(defun eval-tests--save-current-buffer (buffer other)
+  (list (save-current-buffer
+          (set-buffer buffer)
+          (current-buffer))
+        (current-buffer)
+        (catch 'done
+          (save-current-buffer
+            (set-buffer buffer)
+            (throw 'done (current-buffer))))
+        (current-buffer)
+        (save-current-buffer
+          (set-buffer other)
+          (kill-buffer other))
+        (current-buffer)))
+
+(ert-deftest eval-tests-save-current-buffer ()
+  (let ((fun (byte-compile 'eval-tests--save-current-buffer))
+        (buffer (generate-new-buffer " *eval-tests*"))
+        (other (generate-new-buffer " *eval-tests*")))
+    (unwind-protect
+        (with-temp-buffer
+          (let ((here (current-buffer)))
+            (should (equal (funcall fun buffer other)
+                           (list buffer here buffer here t here)))
+            (should-not (buffer-live-p other))))
+      (kill-buffer buffer))))
+
+(defun eval-tests--binding-loop (n)
+  (let ((count 0))
+    (dotimes (_ n)
+      (let ((inhibit-read-only t)
+            (case-fold-search nil))
+        (save-excursion
+          (with-current-buffer (current-buffer)
+            (setq count (1+ count))))))
+    count))
+
+(ert-deftest eval-tests-binding-benchmark ()
+  :tags '(:expensive-test)
+  (byte-compile 'eval-tests--binding-loop)
+  (with-temp-buffer
+    (message "let, save-excursion and with-current-buffer: %.3fs"
+             (car (benchmark-run 1 (eval-tests--binding-loop 3000000))))))
+
 ;;; eval-tests.el ends here
@@ -405,4 +405,62 @@
   (should-error (nconc (cyc1 1) 'tail) :type 'circular-list)
   (should-error (nconc (cyc2 1 2) 'tail) :type 'circular-list))
 
+(ert-deftest fns-tests-sxhash-string ()
+  ;; Strings of every length up to a few chunks, so that all the
+  ;; tails are hashed.
+  (dotimes (n 80)
+    (let ((str (make-string n ?a)))
+      (should (= (sxhash-equal str) (sxhash-equal (copy-sequence str))))
+      (when (> n 0)
+        (let ((other (copy-sequence str)))
+          (aset other (1- n) ?b)
+          (should-not (= (sxhash-equal str) (sxhash-equal other)))))))
+  (should (= (sxhash-equal "λ→∀") (sxhash-equal (string ?λ ?→ ?∀))))
+  ;; Text properties are not part of the hash.
+  (should (= (sxhash-equal (propertize "abc" 'face 'bold))
+             (sxhash-equal "abc"))))
+
+(ert-deftest fns-tests-sxhash-bool-vector ()
+  (let ((a (make-bool-vector 1000 nil))
+        (b (make-bool-vector 1000 nil)))
+    (should (= (sxhash-equal a) (sxhash-equal b)))
+    ;; Bits past the first few words count too.
+    (aset b 999 t)
+    (should-not (= (sxhash-equal a) (sxhash-equal b)))
+    (aset a 999 t)
+    (should (= (sxhash-equal a) (sxhash-equal b)))
+    (should-not (= (sxhash-equal (make-bool-vector 10 nil))
+                   (sxhash-equal (make-bool-vector 11 nil))))))
+
+(ert-deftest fns-tests-sxhash-string-benchmark ()
+  :tags '(:expensive-test)
+  (let* ((n 1000000)
+         (paths (mapcar (lambda (i)
+                          (format "/home/user/src/project/lisp/module-%d/file-%d.el"
+                                  (/ i 100) i))
+                        (number-sequence 1 n)))
+         (hashes (make-hash-table :test 'eql :size n))
+         (buckets (make-hash-table :test 'eql :size n))
+         (collisions 0)
+         (bucket-collisions 0))
+    (message "sxhash-equal on %d file names: %.3fs" n
+             (car (benchmark-run 1 (mapc #'sxhash-equal paths))))
+    (dolist (path paths)
+      (let ((hash (sxhash-equal path)))
+        (if (gethash hash hashes)
+            (setq collisions (1+ collisions))
+          (puthash hash t hashes))
+        ;; Collisions in a table of 2^20 buckets; about n/e of them
+        ;; are expected from an ideal hash.
+        (let ((bucket (logand hash (1- (ash 1 20)))))
+          (if (gethash bucket buckets)
+              (setq bucket-collisions (1+ bucket-collisions))
+            (puthash bucket t buckets)))))
+    (message "full hash collisions: %d, bucket collisions: %d (ideal %d)"
+             collisions bucket-collisions
+             (round (- n (* (ash 1 20) (- 1 (exp (/ (- n) (float (ash 1 20)))))))))
+    (let ((long (make-string 100000000 ?x)))
+      (message "sxhash-equal on a 100MB string: %.3fs"
+               (car (benchmark-run 1 (sxhash-equal long)))))))
+
 (provide 'fns-tests)
@@ -159,6 +159,62 @@ expected font properties from parsing NAME.")
 	(insert "\n"))))
   (goto-char (point-min)))
 
+(defconst font-tests--glyph-string
+  (concat "The quick brown fox jumps over the lazy dog"
+          ;; Glyphs in other blocks of the metrics cache.
+          (apply #'string (number-sequence #x100 #x17f))
+          (apply #'string (number-sequence #x391 #x3a9)))
+  "Text whose glyphs the metrics cache tests measure.")
+
+(defun font-tests--open-font (entity size)
+  "Open a font like ENTITY of SIZE pixels, looking it up afresh."
+  (let ((spec (font-spec :family (font-get entity :family)
+                         :weight (font-get entity :weight)
+                         :slant (font-get entity :slant)
+                         :width (font-get entity :width)
+                         :registry (font-get entity :registry))))
+    (open-font (car (list-fonts spec)) size)))
+
+(defun font-tests--glyph-metrics (font)
+  "Return the code and metrics of each glyph of the test text in FONT."
+  (mapcar (lambda (glyph) (and glyph (append (substring glyph 3 9) nil)))
+          (font-get-glyphs font 0 (length font-tests--glyph-string)
+                           font-tests--glyph-string)))
+
+(ert-deftest font-glyph-metrics-cache ()
+  "Glyph metrics from the cache are those that the font reports."
+  (skip-unless (display-graphic-p))
+  (let ((entity (car (list-fonts (font-spec :registry 'iso10646-1)))))
+    (skip-unless entity)
+    (let* ((font (font-tests--open-font entity 12))
+           (metrics (font-tests--glyph-metrics font)))
+      (should (car metrics))
+      ;; The second time, the metrics come from the cache.
+      (should (equal (font-tests--glyph-metrics font) metrics))
+      ;; A font of another size does not see them.
+      (should-not (equal (font-tests--glyph-metrics
+                          (font-tests--open-font entity 24))
+                         metrics))
+      ;; Closing the fonts drops their caches, and the glyphs are
+      ;; measured again.
+      (clear-font-cache)
+      (should (equal (font-tests--glyph-metrics
+                      (font-tests--open-font entity 12))
+                     metrics)))))
+
+(ert-deftest font-text-extents-layout-benchmark ()
+  "Lay out a large buffer; most glyph metrics come from the cache."
+  :tags '(:expensive-test)
+  (skip-unless (display-graphic-p))
+  (with-temp-buffer
+    (dotimes (i 20000)
+      (insert (format "%05d (defun foo () \"λ → ∀ x ∈ ℕ\") ;; ok\n" i)))
+    (switch-to-buffer (current-buffer))
+    (message "Layout of %d lines: %.3fs"
+             (count-lines (point-min) (point-max))
+             (car (benchmark-run 3
+                    (window-text-pixel-size nil (point-min) (point-max)))))))
+
 ;; Local Variables:
 ;; no-byte-compile: t
 ;; End:
@@ -32,5 +32,41 @@
                         (read-event nil nil 2))
                  ?\C-b)))
 
+;; Nothing is queued in batch mode, so only check the form of the
+;; statistics and that they can be reset.
+(ert-deftest keyboard-input-event-queue-statistics ()
+  (let ((stats (input-event-queue-statistics)))
+    (dolist (name '(stored coalesced dropped read max-length))
+      (should (natnump (cdr (assq name stats)))))
+    (dolist (name '(mean-latency max-latency))
+      (should (floatp (cdr (assq name stats))))))
+  (input-event-queue-statistics t)
+  (let ((stats (input-event-queue-statistics)))
+    (should (= (cdr (assq 'stored stats)) 0))
+    (should (= (cdr (assq 'max-latency stats)) 0.0))))
+
+;; User signals are stored in the queue when input is next checked,
+;; so signals sent to Emacs itself can test the merging of redundant
+;; events.
+(defun keyboard-tests--queue-signals (signals)
+  "Send SIGNALS to Emacs, queue them and return the queue statistics."
+  (discard-input)
+  (input-event-queue-statistics t)
+  (let ((debug-on-event nil))
+    (dolist (signal signals)
+      (signal-process (emacs-pid) signal))
+    (input-pending-p))
+  (prog1 (input-event-queue-statistics t)
+    (discard-input)))
+
+(ert-deftest keyboard-input-event-coalesce ()
+  (skip-unless (not (memq system-type '(windows-nt ms-dos))))
+  (let ((stats (keyboard-tests--queue-signals '(sigusr1 sigusr1 sigusr1))))
+    (should (= (cdr (assq 'stored stats)) 1))
+    (should (= (cdr (assq 'coalesced stats)) 2)))
+  (let ((stats (keyboard-tests--queue-signals '(sigusr1 sigusr2))))
+    (should (= (cdr (assq 'stored stats)) 2))
+    (should (= (cdr (assq 'coalesced stats)) 0))))
+
 (provide 'keyboard-tests)
 ;;; keyboard-tests.el ends here
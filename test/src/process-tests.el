@@ -185,5 +185,57 @@
               (should-not (process-query-on-exit-flag process))))
         (kill-process process)))))
 
+(defun process-tests--call-async (program &rest args)
+  "Run PROGRAM with ARGS using `call-process-async' and wait for it.
+Return a cons of the exit status and the output."
+  (with-temp-buffer
+    (let* ((status 'none)
+           (proc (apply #'call-process-async program (current-buffer)
+                        (lambda (s) (setq status s))
+                        args)))
+      (should (processp proc))
+      (while (eq status 'none)
+        (accept-process-output nil 0.1))
+      (should-not (memq proc (process-list)))
+      (cons status (buffer-string)))))
+
+(ert-deftest call-process-async ()
+  (skip-unless (file-executable-p "/bin/sh"))
+  (should (equal (process-tests--call-async "/bin/sh" "-c" "echo out; echo err >&2")
+                 '(0 . "out\nerr\n")))
+  (should (equal (process-tests--call-async "/bin/sh" "-c" "exit 3")
+                 '(3 . "")))
+  (should (stringp (car (process-tests--call-async "/bin/sh" "-c"
+                                                   "kill -9 $$"))))
+  ;; The standard input is empty.
+  (should (equal (process-tests--call-async "/bin/sh" "-c" "cat")
+                 '(0 . "")))
+  ;; Large output arrives whole, and decoded as for `call-process'.
+  (let ((command "i=0; while [ $i -lt 20000 ]; do echo \"line $i\"; i=$((i+1)); done"))
+    (should (equal (process-tests--call-async "/bin/sh" "-c" command)
+                   (cons 0 (with-temp-buffer
+                             (call-process "/bin/sh" nil t nil "-c" command)
+                             (buffer-string)))))))
+
+(ert-deftest call-process-async-no-buffer ()
+  (skip-unless (file-executable-p "/bin/sh"))
+  (let ((status 'none))
+    (call-process-async "/bin/sh" nil (lambda (s) (setq status s))
+                        "-c" "echo discarded")
+    (while (eq status 'none)
+      (accept-process-output nil 0.1))
+    (should (eq status 0))))
+
+(ert-deftest call-process-async-benchmark ()
+  :tags '(:expensive-test)
+  (skip-unless (executable-find "seq"))
+  (dolist (n '(10000 100000 1000000))
+    (message "seq %d: call-process %.3fs, call-process-async %.3fs" n
+             (car (benchmark-run 1
+                    (with-temp-buffer
+                      (call-process "seq" nil t nil (number-to-string n)))))
+             (car (benchmark-run 1
+                    (process-tests--call-async "seq" (number-to-string n)))))))
+
 (provide 'process-tests)
 ;; process-tests.el ends here.
@@ -0,0 +1,278 @@
+;;; profiler-tests.el --- Tests for profiler.c -*- lexical-binding: t -*-
+
+;; Copyright (C) 2018 Free Software Foundation, Inc.
+
+;; This file is part of GNU Emacs.
+
+;; GNU Emacs is free software: you can redistribute it and/or modify
+;; it under the terms of the GNU General Public License as published by
+;; the Free Software Foundation, either version 3 of the License, or
+;; (at your option) any later version.
+
+;; GNU Emacs is distributed in the hope that it will be useful,
+;; but WITHOUT ANY WARRANTY; without even the implied warranty of
+;; MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+;; GNU General Public License for more details.
+
+;; You should have received a copy of the GNU General Public License
+;; along with GNU Emacs.  If not, see <https://www.gnu.org/licenses/>.
+
+;;; Code:
+
+(require 'ert)
+(require 'cl-lib)
+
+(defun profiler-tests--cpu-log (native-depth)
+  "Profile some work with NATIVE-DEPTH native frames and return the log."
+  (let ((profiler-native-stack-depth native-depth))
+    (profiler-cpu-start 100000)
+    (unwind-protect
+        (let ((end (+ (float-time) 0.5)))
+          (while (< (float-time) end)
+            (sort (mapcar #'number-to-string (number-sequence 1 1000))
+                  #'string<)))
+      (profiler-cpu-stop))
+    (profiler-cpu-log)))
+
+(ert-deftest profiler-cpu-native-frames ()
+  (skip-unless (fboundp 'profiler-cpu-start))
+  (let ((log (profiler-tests--cpu-log 8))
+        (names (make-hash-table :test 'equal))
+        (total 0))
+    (maphash
+     (lambda (backtrace count)
+       (setq total (+ total count))
+       (unless (equal backtrace [Automatic\ GC])
+         (should (= (length backtrace) (+ profiler-max-stack-depth 8)))
+         (let ((lisp nil))
+           (dotimes (i (length backtrace))
+             (let ((entry (aref backtrace i)))
+               (cond
+                ((stringp entry)
+                 ;; Native frames come first, and stop at the
+                 ;; interpreter.
+                 (should-not lisp)
+                 (should-not (member entry '("Ffuncall" "eval_sub"
+                                             "exec_byte_code")))
+                 ;; Equal names are the same string.
+                 (should (eq (or (gethash entry names)
+                                 (puthash entry entry names))
+                             entry)))
+                (entry (setq lisp t))))))))
+     log)
+    (should (< 0 total))
+    (when (string-match "x86_64.*-linux-gnu" system-configuration)
+      (should (< 0 (hash-table-count names))))))
+
+(ert-deftest profiler-cpu-no-native-frames ()
+  (skip-unless (fboundp 'profiler-cpu-start))
+  (maphash (lambda (backtrace _count)
+             (should-not (cl-some #'stringp backtrace)))
+           (profiler-tests--cpu-log 0)))
+
+(defvar profiler-tests--kept nil)
+
+(defun profiler-tests--garbage ()
+  (dotimes (_ 20000)
+    (make-list 10 nil)))
+
+(defun profiler-tests--keep ()
+  (setq profiler-tests--kept
+        (mapcar (lambda (_) (make-string 100 ?a)) (make-list 1000 nil))))
+
+(defun profiler-tests--bytes (log type function)
+  "Return the bytes of TYPE allocated in FUNCTION according to LOG."
+  (let ((bytes 0))
+    (maphash (lambda (backtrace count)
+               (when (and (eq (aref backtrace 0) type)
+                          (cl-find function backtrace))
+                 (setq bytes (+ bytes count))))
+             log)
+    bytes))
+
+(ert-deftest profiler-allocation ()
+  (should-not (profiler-allocation-running-p))
+  (should-not (profiler-allocation-stop))
+  (ignore (profiler-allocation-log))
+  (should (profiler-allocation-start 1024))
+  (should-error (profiler-allocation-start))
+  (should (profiler-allocation-running-p))
+  (unwind-protect
+      (progn
+        (profiler-tests--garbage)
+        (profiler-tests--keep)
+        (garbage-collect))
+    (should (profiler-allocation-stop)))
+  (let* ((summary (profiler-allocation-summary))
+         (live (profiler-allocation-live-log))
+         (log (profiler-allocation-log))
+         (cons-bytes (* 20000 10 (nth 1 (assq 'conses (garbage-collect))))))
+    (should (= (length summary) 6))
+    ;; Each sample stands for 1024 bytes, so the estimate is close, or
+    ;; larger if running the loop conses too.
+    (let ((garbage (profiler-tests--bytes log 'cons 'profiler-tests--garbage)))
+      (should (< (* 0.9 cons-bytes) garbage))
+      (should (<= garbage (nth 1 (assq 'cons summary)))))
+    (should (< (profiler-tests--bytes live 'cons 'profiler-tests--garbage)
+               (* 0.1 cons-bytes)))
+    (should (< 0 (profiler-tests--bytes log 'string 'profiler-tests--keep)))
+    (should (< 0 (profiler-tests--bytes live 'string 'profiler-tests--keep)))
+    (should (< 0 (nth 2 (assq 'string summary))))
+    (should (<= (nth 2 (assq 'cons summary)) (nth 1 (assq 'cons summary)))))
+  (setq profiler-tests--kept nil))
+
+;; Reading the samples allocates, which must not sample more objects
+;; into the arrays being read.
+(ert-deftest profiler-allocation-live-log-while-running ()
+  (should (profiler-allocation-start 1))
+  (unwind-protect
+      (progn
+        (profiler-tests--keep)
+        (garbage-collect)
+        (dotimes (_ 3)
+          (should (< 0 (hash-table-count (profiler-allocation-live-log))))
+          (should (= (length (profiler-allocation-summary)) 6)))
+        (should (profiler-allocation-running-p)))
+    (profiler-allocation-stop))
+  (ignore (profiler-allocation-log))
+  (setq profiler-tests--kept nil))
+
+;; Timing spans.
+
+(defvar profiler-tests--hook nil)
+(defvar profiler-tests--inner-hook nil)
+
+(defun profiler-tests--outer ()
+  (run-hooks 'profiler-tests--inner-hook))
+
+(defun profiler-tests--inner ()
+  (sleep-for 0.01))
+
+(defun profiler-tests--throw ()
+  (throw 'profiler-tests--done nil))
+
+(defun profiler-tests--span (function spans)
+  "Return the first span of SPANS that calls FUNCTION."
+  (cl-find function spans :key (lambda (span) (nth 2 span))))
+
+(ert-deftest profiler-spans ()
+  (should-not (profiler-spans-running-p))
+  (ignore (profiler-spans-log))
+  (let ((profiler-tests--hook '(profiler-tests--outer))
+        (profiler-tests--inner-hook '(profiler-tests--inner
+                                      profiler-tests--throw))
+        (timer-ran nil))
+    (should (profiler-spans-start 100))
+    (should-error (profiler-spans-start))
+    (unwind-protect
+        (progn
+          (catch 'profiler-tests--done
+            (run-hooks 'profiler-tests--hook))
+          (run-at-time 0 nil (lambda () (setq timer-ran t)))
+          (while (not timer-ran)
+            (accept-process-output nil 0.01)))
+      (should (profiler-spans-stop)))
+    (let* ((spans (profiler-spans-log))
+           (outer (profiler-tests--span 'profiler-tests--outer spans))
+           (inner (profiler-tests--span 'profiler-tests--inner spans))
+           (throw (profiler-tests--span 'profiler-tests--throw spans))
+           (timer (assq 'timer spans)))
+      (should (equal (butlast outer 3)
+                     '(hook profiler-tests--hook profiler-tests--outer)))
+      (should (equal (butlast inner 3)
+                     '(hook profiler-tests--inner-hook
+                            profiler-tests--inner)))
+      ;; The inner spans are within the outer one, even the one that
+      ;; was ended by `throw'.
+      (should (= (nth 5 inner) (1+ (nth 5 outer))))
+      (should (= (nth 5 throw) (nth 5 inner)))
+      (should (<= 5000000 (nth 4 inner)))
+      (should (<= (nth 3 outer) (nth 3 inner)))
+      (should (<= (+ (nth 3 throw) (nth 4 throw))
+                  (+ (nth 3 outer) (nth 4 outer))))
+      (should (timerp (nth 1 timer)))
+      (should (functionp (nth 2 timer)))
+      (should (equal spans (sort (copy-sequence spans)
+                                 (lambda (a b) (< (nth 3 a) (nth 3 b)))))))
+    ;; Spans are only returned once, and not recorded once stopped.
+    (run-hooks 'profiler-tests--hook)
+    (should-not (profiler-spans-log))))
+
+(ert-deftest profiler-spans-ring ()
+  (let ((profiler-tests--hook '(ignore)))
+    (profiler-spans-start 10)
+    (unwind-protect
+        (dotimes (_ 100)
+          (run-hooks 'profiler-tests--hook))
+      (profiler-spans-stop))
+    (should (= (length (profiler-spans-log)) 10))))
+
+(ert-deftest profiler-spans-hook-functions ()
+  (let ((profiler-tests--hook '(ignore)))
+    (profiler-spans-start 10)
+    (unwind-protect
+        (progn
+          (run-hook-with-args 'profiler-tests--hook 1)
+          (run-hook-with-args-until-success 'profiler-tests--hook 1)
+          (run-hook-with-args-until-failure 'profiler-tests--hook 1)
+          (run-hook-wrapped 'profiler-tests--hook #'funcall))
+      (profiler-spans-stop))
+    (should (equal (mapcar (lambda (span) (butlast span 3))
+                           (profiler-spans-log))
+                   (make-list 4 '(hook profiler-tests--hook ignore))))))
+
+(ert-deftest profiler-spans-process ()
+  (skip-unless (executable-find "echo"))
+  (let* ((output nil)
+         (done nil)
+         (sentinel (lambda (_proc _event) (setq done t)))
+         (process (make-process :name "profiler-tests"
+                                :command '("echo" "hello")
+                                :filter (lambda (_proc string)
+                                          (push string output))
+                                :sentinel sentinel)))
+    (profiler-spans-start)
+    (unwind-protect
+        (while (not done)
+          (accept-process-output process 0.1))
+      (profiler-spans-stop))
+    (let ((spans (profiler-spans-log)))
+      (should output)
+      (should (eq (nth 1 (assq 'filter spans)) process))
+      (should (eq (nth 1 (assq 'sentinel spans)) process))
+      (should (eq (nth 2 (assq 'sentinel spans)) sentinel)))))
+
+;; Check how much recording spans slows down running hooks, which is
+;; the worst case since the functions do nothing.  Beginning and ending
+;; a span takes two clock reads and a specpdl entry, about 100ns, so
+;; allow ten times that for noise.
+(defun profiler-tests--hook-work ()
+  "Do about as much work as a typical hook function.
+Like a function of `post-command-hook', it looks at some text."
+  (with-temp-buffer
+    (insert "(defun profiler-tests--hook-work () (forward-line 1))")
+    (goto-char (point-min))
+    (re-search-forward "(\\(defun\\) \\([^ ]+\\)" nil t)
+    (match-string 2)))
+
+(ert-deftest profiler-spans-benchmark ()
+  "Report the overhead of spans for a hook of typical functions.
+The timings are only reported, since they depend on the machine."
+  :tags '(:expensive-test)
+  (let ((profiler-tests--hook (make-list 10 #'profiler-tests--hook-work))
+        (n 100000))
+    (garbage-collect)
+    (let ((off (car (benchmark-run n (run-hooks 'profiler-tests--hook)))))
+      (profiler-spans-start)
+      (unwind-protect
+          (let ((on (car (benchmark-run n
+                           (run-hooks 'profiler-tests--hook)))))
+            (message (concat "run-hooks, %d calls of 10 functions: %.3fs,"
+                             " %.3fs with spans, %.1f%% overhead")
+                     n off on (/ (* 100 (- on off)) off))
+            (should (= (length (profiler-spans-log)) 65536)))
+        (profiler-spans-stop)
+        (ignore (profiler-spans-log))))))
+
+(provide 'profiler-tests)
+;;; profiler-tests.el ends here
@@ -326,4 +326,90 @@
     (should (= (length (all-threads)) 1))
     (should (equal (thread-last-error) '(error "Die, die, die!")))))
 
+(defvar threads-test-churn nil)
+
+(defun threads-test--churn ()
+  "Allocate and collect garbage until `threads-test-churn' is nil."
+  (while threads-test-churn
+    (dotimes (_ 100)
+      (make-string 1000 ?x))
+    (garbage-collect)
+    (thread-yield)))
+
+(defmacro threads-test--with-churn (&rest body)
+  "Run BODY while another thread allocates and collects garbage."
+  (declare (indent 0))
+  `(let ((thread (progn (setq threads-test-churn t)
+                        (make-thread #'threads-test--churn))))
+     (unwind-protect
+         (progn ,@body)
+       (setq threads-test-churn nil)
+       (thread-join thread))))
+
+(ert-deftest threads-test-unlocked-secure-hash ()
+  "Hashing without the global lock gives the same results."
+  (skip-unless (fboundp 'make-thread))
+  (let* ((string (apply #'concat (mapcar #'number-to-string
+                                         (number-sequence 1 100000))))
+         (expected (mapcar (lambda (alg) (secure-hash alg string))
+                           (secure-hash-algorithms))))
+    (threads-test--with-churn
+      (should (equal (mapcar (lambda (alg) (secure-hash alg string))
+                             (secure-hash-algorithms))
+                     expected))
+      (with-temp-buffer
+        (insert string)
+        (should (equal (secure-hash 'sha256 (current-buffer))
+                       (secure-hash 'sha256 string)))))))
+
+(ert-deftest threads-test-unlocked-directory-files ()
+  "Directories read without the global lock give the same names."
+  (skip-unless (fboundp 'make-thread))
+  (let ((expected (directory-files data-directory)))
+    (threads-test--with-churn
+      (should (equal (directory-files data-directory) expected))
+      (should (equal (thread-join (make-thread
+                                   (lambda ()
+                                     (directory-files data-directory))))
+                     expected)))))
+
+(ert-deftest threads-test-unlocked-json-parse ()
+  "JSON parsed without the global lock gives the same objects."
+  (skip-unless (and (fboundp 'make-thread) (fboundp 'json-parse-string)))
+  (let* ((string (concat "[" (mapconcat #'number-to-string
+                                        (number-sequence 1 50000) ",")
+                         "]"))
+         (expected (json-parse-string string)))
+    (threads-test--with-churn
+      (should (equal (json-parse-string string) expected)))))
+
+(ert-deftest threads-test-unlocked-benchmark ()
+  "Check that the main thread stays responsive while another hashes."
+  :tags '(:expensive-test)
+  (skip-unless (fboundp 'make-thread))
+  (let* ((files (directory-files-recursively source-directory "\\.c\\'"))
+         (contents (mapcar (lambda (file)
+                             (with-temp-buffer
+                               (insert-file-contents-literally file)
+                               (buffer-string)))
+                           files))
+         (done nil)
+         (worker (make-thread
+                  (lambda ()
+                    (dotimes (_ 10)
+                      (dolist (string contents)
+                        (secure-hash 'sha512 string)))
+                    (setq done t))))
+         (ticks 0)
+         (worst 0.0)
+         (start (float-time)))
+    (while (not done)
+      (let ((before (float-time)))
+        (sleep-for 0.001)
+        (setq worst (max worst (- (float-time) before)))
+        (setq ticks (1+ ticks))))
+    (thread-join worker)
+    (message "Hashed %d files 10 times in %.3fs; main thread ran %d times, longest wait %.3fs"
+             (length files) (- (float-time) start) ticks worst)))
+
 ;;; threads.el ends here
@@ -466,5 +466,176 @@ Demonstrates bug 25599."
     (undo-boundary)
     (undo)))
 
+(ert-deftest undo-test-combine-deletions ()
+  "Test that adjacent deletions are combined into one record."
+  (with-temp-buffer
+    (buffer-enable-undo)
+    (let ((undo-inhibit-record-point t))
+      (insert "abcdefgh")
+      (undo-boundary)
+      (goto-char 3)
+      (dotimes (_ 3) (delete-char 1))
+      (should (equal (car buffer-undo-list) '("cde" . 3)))
+      (undo-boundary)
+      (goto-char (point-max))
+      (dotimes (_ 2) (delete-char -1))
+      (should (equal (car buffer-undo-list) '("gh" . -4)))
+      (should (string= (buffer-string) "abf"))
+      (undo-boundary)
+      (undo)
+      (should (string= (buffer-string) "abfgh"))
+      (should (= (point) 6))
+      (undo-more 1)
+      (should (string= (buffer-string) "abcdefgh"))
+      (should (= (point) 3)))))
+
+(ert-deftest undo-test-combine-deletions-markers ()
+  "Test that deletions with marker adjustments are not combined."
+  (with-temp-buffer
+    (buffer-enable-undo)
+    (insert "abcdef")
+    (let ((marker (copy-marker 4)))
+      (undo-boundary)
+      (goto-char 3)
+      (dotimes (_ 3) (delete-char 1))
+      (should (= marker 3))
+      (undo-boundary)
+      (undo)
+      (should (string= (buffer-string) "abcdef"))
+      (should (= marker 4)))))
+
+(ert-deftest undo-test-combine-property-changes ()
+  "Test that changes of a property in adjacent text are combined."
+  (with-temp-buffer
+    (buffer-enable-undo)
+    (insert "aaaaaaaa")
+    (put-text-property 3 5 'other t)
+    (put-text-property 5 7 'other 2)
+    (undo-boundary)
+    (put-text-property 1 9 'face 'bold)
+    (should (equal (car buffer-undo-list) '(nil face nil 1 . 9)))
+    (undo-boundary)
+    (undo)
+    (should-not (next-single-property-change 1 'face))
+    (should (eq (get-text-property 3 'other) t))))
+
+(ert-deftest undo-test-combine-replacements ()
+  "Test that nearby replacements are combined into one record."
+  (with-temp-buffer
+    (buffer-enable-undo)
+    (let ((undo-inhibit-record-point t))
+      (insert "a-b-c-d")
+      (undo-boundary)
+      (goto-char (point-min))
+      (while (re-search-forward "[a-d]" nil t)
+        (replace-match "xy"))
+      (should (string= (buffer-string) "xy-xy-xy-xy"))
+      (should (equal (car buffer-undo-list) '("a-b-c-d" . -1)))
+      (should (equal (cadr buffer-undo-list) '(8 . 19)))
+      (undo-boundary)
+      (undo)
+      (should (string= (buffer-string) "a-b-c-d")))))
+
+(ert-deftest undo-test-combine-replacements-markers ()
+  "Test that replacements around a marker are not combined."
+  (with-temp-buffer
+    (buffer-enable-undo)
+    (insert "a-b-c-d")
+    (let ((marker (copy-marker 2)))
+      (undo-boundary)
+      (goto-char (point-min))
+      (while (re-search-forward "[a-d]" nil t)
+        (replace-match "xy"))
+      (should (= marker 3))
+      (undo-boundary)
+      (undo)
+      (should (string= (buffer-string) "a-b-c-d"))
+      (should (= marker 2)))))
+
+(ert-deftest undo-test-cancel-change-group-combined ()
+  "Test that canceling a group reverts deletions next to an earlier one.
+They must not be combined with the record before the group (bug#33341)."
+  (with-temp-buffer
+    (buffer-enable-undo)
+    (let ((undo-inhibit-record-point t))
+      (insert "abcdef")
+      (undo-boundary)
+      (goto-char 2)
+      (delete-char 1)
+      (should (equal (car buffer-undo-list) '("b" . 2)))
+      (should-error
+       (atomic-change-group
+         (delete-char 1)
+         (delete-char 1)
+         (error "Cancel")))
+      (should (string= (buffer-string) "acdef"))
+      (should (equal (car buffer-undo-list) '("b" . 2)))
+      (undo-boundary)
+      (undo)
+      (should (string= (buffer-string) "abcdef")))))
+
+(defun undo-test--measure (body)
+  "Call BODY and return what it allocated and the undo records.
+The value is a list of the number of conses and of string bytes
+allocated, and the length of `buffer-undo-list'."
+  (let ((before (memory-use-counts)))
+    (funcall body)
+    (let ((after (memory-use-counts)))
+      (list (- (nth 0 after) (nth 0 before))
+            (- (nth 4 after) (nth 4 before))
+            (length buffer-undo-list)))))
+
+(ert-deftest undo-test-memory-benchmark ()
+  "Check the undo records for large editing operations.
+Deleting 100000 characters one at a time, or changing a property
+over 200000 intervals, made a record for each before adjacent
+records were combined.  Replacing 100000 matches made a deletion and
+an insertion record for each before nearby replacements were
+combined."
+  :tags '(:expensive-test)
+  (let ((n 100000))
+    (dolist (test
+             `(("delete-char forward"
+                ignore
+                ,(lambda ()
+                   (goto-char (point-min))
+                   (dotimes (_ n) (delete-char 1)))
+                ,(+ (/ n 32) 3))
+               ("delete-char backward"
+                ignore
+                ,(lambda ()
+                   (goto-char (point-max))
+                   (dotimes (_ n) (delete-char -1)))
+                ,(+ (/ n 32) 3))
+               ("put-text-property"
+                ,(lambda ()
+                   (let ((pos 1))
+                     (while (< pos (point-max))
+                       (put-text-property pos (1+ pos) 'n pos)
+                       (setq pos (+ pos 2)))))
+                ,(lambda ()
+                   (put-text-property (point-min) (point-max) 'face 'bold))
+                3)
+               ("replace-regexp"
+                ignore
+                ,(lambda ()
+                   (goto-char (point-min))
+                   (while (re-search-forward "b" nil t)
+                     (replace-match "cc")))
+                ;; Each record replaces "b", then "a" and another
+                ;; "b" 15 times.
+                ,(+ (* 2 (ceiling n 16)) 3))))
+      (pcase-let ((`(,name ,setup ,body ,max-records) test))
+        (with-temp-buffer
+          (dotimes (_ n) (insert "ab"))
+          (funcall setup)
+          (buffer-enable-undo)
+          (undo-boundary)
+          (pcase-let ((`(,conses ,string-bytes ,records)
+                       (undo-test--measure body)))
+            (message "%s: %d conses, %d string bytes, %d undo records"
+                     name conses string-bytes records)
+            (should (<= records max-records))))))))
+
 (provide 'undo-tests)
 ;;; undo-tests.el ends here